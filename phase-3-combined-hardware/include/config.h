@@ -71,8 +71,14 @@
 // ============================================================================
 #define READING_INTERVAL 100         // Weight reading interval
 #define DISPLAY_INTERVAL 500         // Display update interval
-#define MQTT_INTERVAL 2000           // MQTT publish interval
-#define WIFI_CHECK_INTERVAL 30000    // WiFi connection check interval
+#define MQTT_INTERVAL 2000           // Minimum interval between MQTT reports
+// WiFi reconnects are event driven with backoff (wifi_link.h), not polled
 #define SERIAL_BAUD_RATE 115200      // Serial communication speed
 
+// ============================================================================
+// Report-by-Exception Configuration
+// ============================================================================
+#define REPORT_WEIGHT_DEADBAND 0.05       // Weight drift reported without a count change (kg)
+#define REPORT_HEARTBEAT_INTERVAL 300000  // Publish at least every 5 minutes
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -21,11 +21,19 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <PubSubClient.h>
-#include <ArduinoJson.h>
+#include <wifi_link.h>
+#include <mqtt_link.h>
+#include <device_clock.h>
+#include <json_template.h>
+#include <report_policy.h>
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <oled_screen.h>
+#include <oled_panel.h>
+#include <oled_task.h>
+#include <stage_timer.h>
+#include <event_trace.h>
 #include <HX711.h>
 
 // ============================================================================
@@ -42,12 +50,54 @@ const int MQTT_PORT = 1883;
 const char* MQTT_CLIENT_ID = "smart_palette_001";
 const char* MQTT_USERNAME = "your_mqtt_username";  // Optional
 const char* MQTT_PASSWORD = "your_mqtt_password";  // Optional
+#define MQTT_BUFFER_SIZE 512        // PubSubClient packet buffer; the status JSON exceeds the 256 default
 
 // MQTT Topics
 const char* TOPIC_WEIGHT = "palette/weight";
 const char* TOPIC_BOTTLES = "palette/bottles";
 const char* TOPIC_STATUS = "palette/status";
 const char* TOPIC_SYSTEM = "palette/system";
+const char* TOPIC_DIAGNOSTICS = "palette/diagnostics";  // Stage timing, -DSTAGE_TIMING=1 builds
+
+// MQTT Payloads - laid out once and patched in place (json_template.h)
+enum StatusJsonField {
+    STATUS_JSON_TIMESTAMP, STATUS_JSON_WEIGHT_TOTAL, STATUS_JSON_WEIGHT_CELL1, STATUS_JSON_WEIGHT_CELL2,
+    STATUS_JSON_BOTTLE_COUNT, STATUS_JSON_IS_STABLE, STATUS_JSON_STATUS, STATUS_JSON_LAST_ACTION,
+    STATUS_JSON_REASON, STATUS_JSON_SUPPRESSED, STATUS_JSON_EPOCH_MS, STATUS_JSON_BOOT,
+    STATUS_JSON_SEQUENCE
+};
+static constexpr JsonField status_schema[] = {
+    { "timestamp", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "weight_total", JSON_NUMBER, 8 },
+    { "weight_cell1", JSON_NUMBER, 8 },
+    { "weight_cell2", JSON_NUMBER, 8 },
+    { "bottle_count", JSON_NUMBER, 5 },
+    { "is_stable", JSON_BOOL, JSON_BOOL_WIDTH },
+    { "status", JSON_STRING, JSON_STRING_WIDTH(16) },
+    { "last_action", JSON_STRING, JSON_STRING_WIDTH(32) },
+    { "reason", JSON_STRING, JSON_STRING_WIDTH(9) },
+    { "suppressed", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "epoch_ms", JSON_NUMBER, JSON_EPOCH_MS_WIDTH },
+    { "boot", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "sequence", JSON_NUMBER, JSON_UINT32_WIDTH },
+};
+
+enum SystemJsonField {
+    SYSTEM_JSON_TIMESTAMP, SYSTEM_JSON_MESSAGE, SYSTEM_JSON_UPTIME, SYSTEM_JSON_FREE_HEAP,
+    SYSTEM_JSON_HEAP_MIN, SYSTEM_JSON_HEAP_MAX_BLOCK, SYSTEM_JSON_EPOCH_MS, SYSTEM_JSON_BOOT,
+    SYSTEM_JSON_SEQUENCE
+};
+static constexpr JsonField system_schema[] = {
+    { "timestamp", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "message", JSON_STRING, JSON_STRING_WIDTH(48) },
+    { "uptime", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "free_heap", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "heap_min", JSON_NUMBER, JSON_UINT32_WIDTH },        // Lowest free heap since boot
+    { "heap_max_block", JSON_NUMBER, JSON_UINT32_WIDTH },  // Largest allocatable block
+    { "epoch_ms", JSON_NUMBER, JSON_EPOCH_MS_WIDTH },
+    { "boot", JSON_NUMBER, JSON_UINT32_WIDTH },
+    { "sequence", JSON_NUMBER, JSON_UINT32_WIDTH },
+};
 
 // Display Configuration
 #define SCREEN_WIDTH 128
@@ -56,6 +106,7 @@ const char* TOPIC_SYSTEM = "palette/system";
 #define SCREEN_ADDRESS 0x3C
 #define DISPLAY_SDA_PIN 21
 #define DISPLAY_SCL_PIN 22
+#define DISPLAY_I2C_CLOCK 400000    // 1000000 works on short wiring to the module
 
 // Load Cell Configuration
 #define HX711_1_DOUT_PIN 4
@@ -72,9 +123,16 @@ const char* TOPIC_SYSTEM = "palette/system";
 
 // Timing Configuration
 #define READING_INTERVAL 100        // Weight reading interval (ms)
-#define DISPLAY_INTERVAL 500        // Display update interval (ms)
-#define MQTT_INTERVAL 2000          // MQTT publish interval (ms)
-#define WIFI_CHECK_INTERVAL 30000   // WiFi connection check interval (ms)
+#define DISPLAY_INTERVAL 100        // Display refresh (ms); only changed bytes are sent
+#define MQTT_INTERVAL 2000          // Minimum interval between MQTT reports (ms)
+#define STAGE_REPORT_INTERVAL 60000 // Stage timing histograms on TOPIC_DIAGNOSTICS (ms)
+#define HEALTH_REPORT_INTERVAL 300000 // System message with the heap figures (ms)
+#define HEAP_LOW_BLOCK 8192         // Warn when the largest free block shrinks below this (bytes)
+
+// Report-by-exception - publish when the bottle count or status changes or
+// the weight drifts past the deadband, otherwise only a heartbeat
+#define REPORT_WEIGHT_DEADBAND 0.05        // Weight drift reported without a count change (kg)
+#define REPORT_HEARTBEAT_INTERVAL 300000   // Publish at least every 5 minutes (ms)
 
 // Calibration Values (Update these after calibration!)
 // Load Cell 1
@@ -89,9 +147,60 @@ long TARE_OFFSET_2 = 0;
 // GLOBAL OBJECTS
 // ============================================================================
 HX711 scale1, scale2;
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
-WiFiClient wifiClient;
-PubSubClient mqttClient(wifiClient);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, DISPLAY_I2C_CLOCK, DISPLAY_I2C_CLOCK);
+OledScreen screen(&display);
+
+// OLED screens - fixed layouts of text fields (oled_screen.h); a refresh
+// redraws only the fields whose text changed and sends only the changed
+// bytes to the panel (oled_panel.h)
+enum MainScreenField {
+    MAIN_SCREEN_TITLE, MAIN_SCREEN_CELLS, MAIN_SCREEN_TOTAL_LABEL, MAIN_SCREEN_TOTAL,
+    MAIN_SCREEN_BOTTLES, MAIN_SCREEN_LINKS, MAIN_SCREEN_STATUS
+};
+static constexpr OledField main_screen[] = {
+    { 0, 0, 1, 21, "Smart Palette v2.0" },
+    { 0, 12, 1, 21, NULL },                 // Both cells
+    { 0, 22, 1, 6, "Total:" },
+    { 40, 22, 2, 7, NULL },                 // Filtered weight, large
+    { 0, 40, 1, 21, NULL },
+    { 0, 50, 1, 21, NULL },                 // WiFi and MQTT state
+    { 0, 58, 1, 19, NULL },                 // Leaves room for the status dot
+};
+enum StartupScreenField {
+    STARTUP_SCREEN_TITLE, STARTUP_SCREEN_RULE, STARTUP_SCREEN_PHASE, STARTUP_SCREEN_MQTT,
+    STARTUP_SCREEN_INITIALIZING, STARTUP_SCREEN_LOAD_CELLS
+};
+static constexpr OledField startup_screen[] = {
+    { 0, 0, 1, 21, "Smart Palette v2.0" },
+    { 0, 8, 1, 21, "==================" },
+    { 0, 16, 1, 21, "Phase 2: Dual Cells" },
+    { 0, 24, 1, 21, "+ MQTT Integration" },
+    { 0, 40, 1, 21, "Initializing..." },
+    { 0, 48, 1, 21, NULL },                 // "Load cells: OK" once they answer
+};
+static constexpr OledField load_cell_error_screen[] = {
+    { 0, 0, 1, 21, "LOAD CELL ERROR!" },
+    { 0, 8, 1, 21, "Check connections:" },
+    { 0, 16, 1, 21, "HX711_1: D4,D5" },
+    { 0, 24, 1, 21, "HX711_2: D18,D19" },
+};
+
+// What the display task draws (oled_task.h): the loop fills this and posts
+// a copy, the task renders its own copy
+enum DisplayScreen { DISPLAY_STARTUP, DISPLAY_MAIN, DISPLAY_LOAD_CELL_ERROR };
+enum DisplayStatus { DISPLAY_STATUS_MEASURE, DISPLAY_STATUS_READY, DISPLAY_STATUS_ADDED, DISPLAY_STATUS_REMOVED };
+struct DisplayState {
+    DisplayScreen screen;
+    DisplayStatus status;
+    bool load_cells_ok;
+    bool wifi_connected;
+    bool mqtt_connected;
+    float weight1;
+    float weight2;
+    float filtered_weight;
+    int bottle_count;
+};
+DisplayState display_state;
 
 // ============================================================================
 // MEASUREMENT VARIABLES
@@ -103,22 +212,42 @@ int bottle_count = 0;
 int previous_bottle_count = 0;
 bool is_stable = false;
 bool system_ready = false;
-bool wifi_connected = false;
-bool mqtt_connected = false;
+bool wifi_connected = false;    // Mirrors of the WiFi link and network
+bool mqtt_connected = false;    // task state, updated once per loop
+bool mqtt_announced = false;    // Startup message sent on the first connect
 
 // Timing variables
 unsigned long last_reading_time = 0;
 unsigned long last_display_time = 0;
-unsigned long last_mqtt_time = 0;
-unsigned long last_wifi_check = 0;
+unsigned long last_health_time = 0;
+#if STAGE_TIMING
+unsigned long last_diagnostics_time = 0;
+#endif
+
+// Report-by-exception state and counters
+ReportPolicy report_policy;
 
 // Moving average filters
 float weight_readings[FILTER_SAMPLES];
 int reading_index = 0;
 
-// Status tracking
-String system_status = "INITIALIZING";
-String last_action = "System started";
+// Status tracking - the order is the status code the report policy compares
+enum SystemStatus {
+    SYSTEM_INITIALIZING, SYSTEM_READY, SYSTEM_MEASURING, SYSTEM_STABLE, SYSTEM_EMPTY,
+    SYSTEM_BOTTLES_ADDED, SYSTEM_BOTTLES_REMOVED, SYSTEM_HARDWARE_ERROR
+};
+static const char* const system_status_names[] = {
+    "INITIALIZING", "READY", "MEASURING", "STABLE", "EMPTY",
+    "BOTTLES_ADDED", "BOTTLES_REMOVED", "HARDWARE_ERROR"
+};
+SystemStatus system_status = SYSTEM_INITIALIZING;
+char last_action[32] = "System started";   // Width of the last_action JSON field
+
+// MQTT payload buffers
+static char status_json[JSON_TEMPLATE_SIZE(status_schema)];
+static char system_json[JSON_TEMPLATE_SIZE(system_schema)];
+JsonTemplate status_payload(status_schema, status_json, sizeof(status_json));
+JsonTemplate system_payload(system_schema, system_json, sizeof(system_json));
 
 // ============================================================================
 // FUNCTION DECLARATIONS
@@ -130,7 +259,14 @@ void initializeWiFi();
 void initializeMQTT();
 void readWeights();
 void updateDisplay();
-void publishMQTTData();
+void renderDisplay(const void* snapshot);
+bool publishMQTTData(ReportReason reason);
+void reportMQTTData();
+void publishSystemMessage(const char* message);
+void reportHealth();
+#if STAGE_TIMING
+void publishDiagnostics(unsigned long window_ms);
+#endif
 void handleMQTTConnection();
 void handleWiFiConnection();
 void calibrateLoadCells();
@@ -140,7 +276,7 @@ void showSystemInfo();
 void printHelp();
 bool checkLoadCellConnections();
 void handleSerialCommands();
-String getSystemStatus();
+SystemStatus getSystemStatus();
 
 // ============================================================================
 // SETUP FUNCTION
@@ -157,13 +293,22 @@ void setup() {
     Serial.println("Features: WiFi + MQTT + Real-time Updates");
     Serial.println("========================================");
     
+#if EVENT_TRACE
+    // In PSRAM when the module has it (BOARD_HAS_PSRAM), before anything is traced
+    eventTraceBegin();
+#endif
+    
     // Initialize hardware
     initializeHardware();
     
-    // Initialize WiFi
+    // Start WiFi (it connects in the background), then the wall clock
+    // (SNTP) and boot counter
     initializeWiFi();
+    deviceClockBegin();
     
     // Initialize MQTT
+    reportPolicyBegin(&report_policy, (int32_t)(REPORT_WEIGHT_DEADBAND * 1000.0f),
+                      REPORT_HEARTBEAT_INTERVAL, MQTT_INTERVAL);
     initializeMQTT();
     
     // Initialize filter array
@@ -172,8 +317,8 @@ void setup() {
     }
     
     system_ready = true;
-    system_status = "READY";
-    last_action = "System ready for operation";
+    system_status = SYSTEM_READY;
+    snprintf(last_action, sizeof(last_action), "System ready for operation");
     
     Serial.println("Phase 2 initialization complete!");
     Serial.println("========================================");
@@ -187,6 +332,7 @@ void setup() {
 // MAIN LOOP
 // ============================================================================
 void loop() {
+    STAGE_TIMER("loop");
     unsigned long current_time = millis();
     
     // Handle serial commands
@@ -194,17 +340,11 @@ void loop() {
         handleSerialCommands();
     }
     
-    // Handle WiFi connection
-    if (current_time - last_wifi_check >= WIFI_CHECK_INTERVAL) {
-        handleWiFiConnection();
-        last_wifi_check = current_time;
-    }
-    
-    // Handle MQTT connection
-    if (wifi_connected) {
-        handleMQTTConnection();
-        mqttClient.loop();
-    }
+    // WiFi reconnects on its own events (wifi_link.h) and MQTT runs on the
+    // network task (mqtt_link.h); only their state is picked up here, so
+    // nothing in this loop waits on the network
+    handleWiFiConnection();
+    handleMQTTConnection();
     
     // Read weights at regular intervals
     if (current_time - last_reading_time >= READING_INTERVAL) {
@@ -218,11 +358,25 @@ void loop() {
         last_display_time = current_time;
     }
     
-    // Publish MQTT data at regular intervals
-    if (current_time - last_mqtt_time >= MQTT_INTERVAL && mqtt_connected) {
-        publishMQTTData();
-        last_mqtt_time = current_time;
+    // Publish MQTT data when something changed (or for the heartbeat)
+    if (mqtt_connected) {
+        reportMQTTData();
+    }
+    
+    // Heap figures on TOPIC_SYSTEM, to catch fragmentation long before an
+    // allocation fails
+    if (current_time - last_health_time >= HEALTH_REPORT_INTERVAL) {
+        reportHealth();
+        last_health_time = current_time;
     }
+    
+#if STAGE_TIMING
+    // Where the loop's time goes, next to the system messages
+    if (current_time - last_diagnostics_time >= STAGE_REPORT_INTERVAL) {
+        publishDiagnostics(current_time - last_diagnostics_time);
+        last_diagnostics_time = current_time;
+    }
+#endif
 }
 
 // ============================================================================
@@ -246,9 +400,11 @@ void initializeHardware() {
 void initializeDisplay() {
     Serial.print("Initializing OLED display... ");
     
+    uint8_t address = SCREEN_ADDRESS;
     if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
         Serial.print("failed at 0x3C, trying 0x3D... ");
-        if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3D)) {
+        address = 0x3D;
+        if (!display.begin(SSD1306_SWITCHCAPVCC, address)) {
             Serial.println("FAILED!");
             Serial.println("ERROR: OLED display not found!");
             while (true) delay(1000);
@@ -258,20 +414,13 @@ void initializeDisplay() {
     } else {
         Serial.println("SUCCESS at 0x3C!");
     }
-    
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
+    // From here on only the display task touches the display
+    oledPanelBegin(&display, &Wire, address, DISPLAY_I2C_CLOCK);
+    oledTaskBegin(&screen, sizeof(DisplayState), renderDisplay);
     
     // Show startup screen
-    display.setCursor(0, 0);
-    display.println("Smart Palette v2.0");
-    display.println("==================");
-    display.println("Phase 2: Dual Cells");
-    display.println("+ MQTT Integration");
-    display.println("");
-    display.println("Initializing...");
-    display.display();
+    display_state.screen = DISPLAY_STARTUP;
+    oledTaskPost(&display_state);
 }
 
 void initializeLoadCells() {
@@ -305,65 +454,38 @@ void initializeLoadCells() {
         Serial.println("ERROR: Load cell system not properly connected!");
         Serial.println("Check all HX711 and load cell connections");
         while (true) {
-            display.clearDisplay();
-            display.setCursor(0, 0);
-            display.println("LOAD CELL ERROR!");
-            display.println("Check connections:");
-            display.println("HX711_1: D4,D5");
-            display.println("HX711_2: D18,D19");
-            display.display();
+            display_state.screen = DISPLAY_LOAD_CELL_ERROR;
+            oledTaskPost(&display_state);
             delay(1000);
         }
     }
     
     Serial.println("Dual load cell system ready!");
-    display.println("Load cells: OK");
-    display.display();
+    display_state.load_cells_ok = true;
+    oledTaskPost(&display_state);
 }
 
 void initializeWiFi() {
-    Serial.printf("Connecting to WiFi: %s", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        wifi_connected = true;
-        Serial.println(" SUCCESS!");
-        Serial.printf("IP Address: %s\n", WiFi.localIP().toString().c_str());
-        Serial.printf("Signal Strength: %d dBm\n", WiFi.RSSI());
-    } else {
-        wifi_connected = false;
-        Serial.println(" FAILED!");
+    // Returns at once; the first sample does not wait for the access point
+    if (!wifiLinkBegin(WIFI_SSID, WIFI_PASSWORD)) {
         Serial.println("Continuing without WiFi...");
     }
 }
 
 void initializeMQTT() {
-    if (!wifi_connected) {
-        Serial.println("Skipping MQTT initialization - no WiFi");
-        return;
-    }
-    
-    Serial.printf("Connecting to MQTT broker: %s:%d\n", MQTT_SERVER, MQTT_PORT);
-    mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
-    
-    // Try to connect
-    if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD)) {
-        mqtt_connected = true;
-        Serial.println("MQTT connected successfully!");
-        
-        // Publish system startup message
-        publishSystemMessage("Smart Palette Phase 2 started");
-        
-    } else {
-        mqtt_connected = false;
-        Serial.printf("MQTT connection failed! Error code: %d\n", mqttClient.state());
+    // The network task keeps retrying in the background, so a broker (or
+    // WiFi) that is down at boot no longer disables MQTT until a restart
+    Serial.printf("Starting MQTT link to %s:%d\n", MQTT_SERVER, MQTT_PORT);
+    
+    MqttLinkConfig config = {};
+    config.host = MQTT_SERVER;
+    config.port = MQTT_PORT;
+    config.client_id = MQTT_CLIENT_ID;
+    config.username = MQTT_USERNAME;
+    config.password = MQTT_PASSWORD;
+    config.buffer_size = MQTT_BUFFER_SIZE;
+    
+    if (!mqttLinkBegin(&config)) {
         Serial.println("Continuing without MQTT...");
     }
 }
@@ -372,14 +494,18 @@ void initializeMQTT() {
 // WEIGHT READING AND PROCESSING
 // ============================================================================
 void readWeights() {
+    STAGE_TIMER("read_weights");
     if (!checkLoadCellConnections()) {
         Serial.println("WARNING: Load cell connection lost!");
         return;
     }
     
     // Read from both load cells
-    weight1 = scale1.get_units(1);
-    weight2 = scale2.get_units(1);
+    {
+        TRACE_SCOPE("hx711_read");
+        weight1 = scale1.get_units(1);
+        weight2 = scale2.get_units(1);
+    }
     
     // Handle negative weights
     if (weight1 < 0) weight1 = 0.0;
@@ -423,19 +549,19 @@ void readWeights() {
     if (bottle_count != previous_bottle_count && is_stable) {
         int change = bottle_count - previous_bottle_count;
         if (change > 0) {
-            last_action = String("Added ") + change + " bottles";
-            system_status = "BOTTLES_ADDED";
+            snprintf(last_action, sizeof(last_action), "Added %d bottles", change);
+            system_status = SYSTEM_BOTTLES_ADDED;
         } else if (change < 0) {
-            last_action = String("Removed ") + abs(change) + " bottles";
-            system_status = "BOTTLES_REMOVED";
+            snprintf(last_action, sizeof(last_action), "Removed %d bottles", abs(change));
+            system_status = SYSTEM_BOTTLES_REMOVED;
         }
         
         Serial.printf("Bottle count changed: %d -> %d (%+d)\n", 
                      previous_bottle_count, bottle_count, change);
     } else if (is_stable) {
-        system_status = "STABLE";
+        system_status = SYSTEM_STABLE;
     } else {
-        system_status = "MEASURING";
+        system_status = SYSTEM_MEASURING;
     }
     
     // Ensure weight doesn't exceed maximum
@@ -448,145 +574,239 @@ void readWeights() {
 // ============================================================================
 // DISPLAY UPDATE
 // ============================================================================
+// Posts the current readings to the display task; never waits on I2C
 void updateDisplay() {
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
+    STAGE_TIMER("display_post");
+    display_state.screen = DISPLAY_MAIN;
+    display_state.weight1 = weight1;
+    display_state.weight2 = weight2;
+    display_state.filtered_weight = filtered_weight;
+    display_state.bottle_count = bottle_count;
+    display_state.wifi_connected = wifi_connected;
+    display_state.mqtt_connected = mqtt_connected;
+    switch (system_status) {
+        case SYSTEM_STABLE: display_state.status = DISPLAY_STATUS_READY; break;
+        case SYSTEM_BOTTLES_ADDED: display_state.status = DISPLAY_STATUS_ADDED; break;
+        case SYSTEM_BOTTLES_REMOVED: display_state.status = DISPLAY_STATUS_REMOVED; break;
+        default: display_state.status = DISPLAY_STATUS_MEASURE; break;
+    }
+    oledTaskPost(&display_state);
+}
+
+// Display task: sets the fields of the screen a snapshot asks for; the
+// task then draws what changed and sends only the changed bytes
+void renderDisplay(const void* snapshot) {
+    const DisplayState* state = (const DisplayState*)snapshot;
+    if (state->screen == DISPLAY_STARTUP) {
+        screen.show(startup_screen);
+        screen.setText(STARTUP_SCREEN_LOAD_CELLS, state->load_cells_ok ? "Load cells: OK" : "");
+        return;
+    }
+    if (state->screen == DISPLAY_LOAD_CELL_ERROR) {
+        screen.show(load_cell_error_screen);
+        return;
+    }
     
-    // Title bar
-    display.setCursor(0, 0);
-    display.println("Smart Palette v2.0");
-    display.drawLine(0, 10, SCREEN_WIDTH, 10, SSD1306_WHITE);
+    // Title rule drawn once per screen switch
+    if (screen.show(main_screen)) {
+        screen.render();
+        display.drawLine(0, 10, SCREEN_WIDTH, 10, SSD1306_WHITE);
+    }
     
     // Weight display (dual cells)
-    display.setCursor(0, 12);
-    display.printf("Cell1: %.2fkg Cell2: %.2fkg", weight1, weight2);
+    screen.printf(MAIN_SCREEN_CELLS, "C1:%.2fkg C2:%.2fkg", state->weight1, state->weight2);
     
     // Total weight (large font)
-    display.setCursor(0, 22);
-    display.print("Total:");
-    display.setTextSize(2);
-    display.setCursor(50, 22);
-    display.printf("%.2f kg", filtered_weight);
+    screen.printf(MAIN_SCREEN_TOTAL, "%.2fkg", state->filtered_weight);
     
     // Bottle count
-    display.setTextSize(1);
-    display.setCursor(0, 40);
-    display.printf("Bottles: %d units", bottle_count);
+    screen.printf(MAIN_SCREEN_BOTTLES, "Bottles: %d units", state->bottle_count);
     
     // Connection status
-    display.setCursor(0, 50);
-    display.print("WiFi:");
-    display.print(wifi_connected ? "OK" : "X");
-    display.print(" MQTT:");
-    display.print(mqtt_connected ? "OK" : "X");
-    
-    // System status
-    display.setCursor(0, 58);
-    display.print("Status: ");
-    if (system_status == "STABLE") {
-        display.print("Ready");
-        display.fillCircle(120, 61, 2, SSD1306_WHITE);
-    } else if (system_status == "BOTTLES_ADDED") {
-        display.print("Added");
-        display.fillCircle(120, 61, 2, SSD1306_WHITE);
-    } else if (system_status == "BOTTLES_REMOVED") {
-        display.print("Removed");
-        display.drawCircle(120, 61, 2, SSD1306_WHITE);
-    } else {
-        display.print("Measure");
-        display.drawPixel(120, 61, SSD1306_WHITE);
+    screen.printf(MAIN_SCREEN_LINKS, "WiFi:%s MQTT:%s", state->wifi_connected ? "OK" : "X",
+                  state->mqtt_connected ? "OK" : "X");
+    
+    // System status, with a dot that changes shape per state
+    display.fillRect(117, 58, 7, 6, SSD1306_BLACK);
+    switch (state->status) {
+        case DISPLAY_STATUS_READY:
+            screen.setText(MAIN_SCREEN_STATUS, "Status: Ready");
+            display.fillCircle(120, 61, 2, SSD1306_WHITE);
+            break;
+        case DISPLAY_STATUS_ADDED:
+            screen.setText(MAIN_SCREEN_STATUS, "Status: Added");
+            display.fillCircle(120, 61, 2, SSD1306_WHITE);
+            break;
+        case DISPLAY_STATUS_REMOVED:
+            screen.setText(MAIN_SCREEN_STATUS, "Status: Removed");
+            display.drawCircle(120, 61, 2, SSD1306_WHITE);
+            break;
+        case DISPLAY_STATUS_MEASURE:
+            screen.setText(MAIN_SCREEN_STATUS, "Status: Measure");
+            display.drawPixel(120, 61, SSD1306_WHITE);
+            break;
     }
-    
-    display.display();
 }
 
 // ============================================================================
 // MQTT FUNCTIONS
 // ============================================================================
-void publishMQTTData() {
-    if (!mqtt_connected) return;
+const char* systemStatusName(SystemStatus status) {
+    return system_status_names[status];
+}
+
+void reportMQTTData() {
+    STAGE_TIMER("report");
+    ReportSample sample;
+    sample.weight = (int32_t)(filtered_weight * 1000.0f);  // grams
+    sample.count = bottle_count;
+    sample.status = (uint8_t)system_status;
+    sample.nfc_state = 0;
+    
+    unsigned long now = millis();
+    ReportReason reason = reportCheck(&report_policy, &sample, now);
+    if (reason != REPORT_NONE && publishMQTTData(reason)) {
+        reportSent(&report_policy, &sample, reason, now);
+    }
+}
+
+bool publishMQTTData(ReportReason reason) {
+    if (!mqtt_connected) return false;
+    
+    static uint32_t status_sequence = 0;
+    uint32_t now = millis();
+    
+    // Patch the JSON payload in place
+    status_payload.setUnsigned(STATUS_JSON_TIMESTAMP, now);
+    status_payload.setFloat(STATUS_JSON_WEIGHT_TOTAL, filtered_weight, 3);
+    status_payload.setFloat(STATUS_JSON_WEIGHT_CELL1, weight1, 3);
+    status_payload.setFloat(STATUS_JSON_WEIGHT_CELL2, weight2, 3);
+    status_payload.setInt(STATUS_JSON_BOTTLE_COUNT, bottle_count);
+    status_payload.setBool(STATUS_JSON_IS_STABLE, is_stable);
+    status_payload.setString(STATUS_JSON_STATUS, systemStatusName(system_status));
+    status_payload.setString(STATUS_JSON_LAST_ACTION, last_action);
+    status_payload.setString(STATUS_JSON_REASON, reportReasonName(reason));
+    status_payload.setUnsigned(STATUS_JSON_SUPPRESSED, report_policy.suppressed);
+    status_payload.setUnsigned(STATUS_JSON_EPOCH_MS, deviceClockEpochMs(now));
+    status_payload.setUnsigned(STATUS_JSON_BOOT, deviceClockBootCount());
+    status_payload.setUnsigned(STATUS_JSON_SEQUENCE, ++status_sequence);
+    
+    // Plain-text side topics, formatted without the heap
+    char weight_text[16];
+    char bottles_text[8];
+    jsonFormatDecimal(weight_text, sizeof(weight_text), filtered_weight, 3);
+    snprintf(bottles_text, sizeof(bottles_text), "%d", bottle_count);
+    
+    // Hand the retained topics to the network task
+    mqttLinkPublish(TOPIC_WEIGHT, weight_text, MQTT_TELEMETRY, true);
+    mqttLinkPublish(TOPIC_BOTTLES, bottles_text, MQTT_TELEMETRY, true);
+    if (!mqttLinkPublish(TOPIC_STATUS, status_payload.c_str(), MQTT_TELEMETRY, true)) {
+        return false;
+    }
     
-    // Create JSON payload
-    StaticJsonDocument<300> doc;
-    doc["timestamp"] = millis();
-    doc["weight_total"] = filtered_weight;
-    doc["weight_cell1"] = weight1;
-    doc["weight_cell2"] = weight2;
-    doc["bottle_count"] = bottle_count;
-    doc["is_stable"] = is_stable;
-    doc["status"] = system_status;
-    doc["last_action"] = last_action;
-    
-    char buffer[300];
-    serializeJson(doc, buffer);
-    
-    // Publish to different topics
-    mqttClient.publish(TOPIC_WEIGHT, String(filtered_weight, 3).c_str(), true);
-    mqttClient.publish(TOPIC_BOTTLES, String(bottle_count).c_str(), true);
-    mqttClient.publish(TOPIC_STATUS, buffer, true);
-    
-    Serial.printf("MQTT Published - Weight: %.3f kg, Bottles: %d, Status: %s\n", 
-                 filtered_weight, bottle_count, system_status.c_str());
+    Serial.printf("MQTT Published (%s, %lu suppressed) - Weight: %.3f kg, Bottles: %d, Status: %s\n", 
+                 reportReasonName(reason), (unsigned long)report_policy.suppressed,
+                 filtered_weight, bottle_count, systemStatusName(system_status));
+    return true;
 }
 
-void publishSystemMessage(String message) {
+void publishSystemMessage(const char* message) {
     if (!mqtt_connected) return;
     
-    StaticJsonDocument<200> doc;
-    doc["timestamp"] = millis();
-    doc["message"] = message;
-    doc["uptime"] = millis() / 1000;
-    doc["free_heap"] = ESP.getFreeHeap();
-    
-    char buffer[200];
-    serializeJson(doc, buffer);
+    static uint32_t system_sequence = 0;
+    uint32_t now = millis();
+    
+    system_payload.setUnsigned(SYSTEM_JSON_TIMESTAMP, now);
+    system_payload.setString(SYSTEM_JSON_MESSAGE, message);
+    system_payload.setUnsigned(SYSTEM_JSON_UPTIME, now / 1000);
+    system_payload.setUnsigned(SYSTEM_JSON_FREE_HEAP, ESP.getFreeHeap());
+    system_payload.setUnsigned(SYSTEM_JSON_HEAP_MIN, ESP.getMinFreeHeap());
+    system_payload.setUnsigned(SYSTEM_JSON_HEAP_MAX_BLOCK, ESP.getMaxAllocHeap());
+    system_payload.setUnsigned(SYSTEM_JSON_EPOCH_MS, deviceClockEpochMs(now));
+    system_payload.setUnsigned(SYSTEM_JSON_BOOT, deviceClockBootCount());
+    system_payload.setUnsigned(SYSTEM_JSON_SEQUENCE, ++system_sequence);
+    
+    mqttLinkPublish(TOPIC_SYSTEM, system_payload.c_str(), MQTT_TELEMETRY);
+    Serial.printf("System message published: %s\n", message);
+}
+
+void reportHealth() {
+    uint32_t heap_max_block = ESP.getMaxAllocHeap();
+    if (heap_max_block < HEAP_LOW_BLOCK) {
+        Serial.printf("WARNING: Heap fragmented - largest free block %lu of %lu bytes free\n",
+                     (unsigned long)heap_max_block, (unsigned long)ESP.getFreeHeap());
+    }
+    publishSystemMessage("Health report");
+}
+
+#if STAGE_TIMING
+// Stage histograms since the last report, durations in us:
+// {"timestamp":..,"uptime":..,"boot":..,"window_s":..,
+//  "stages":{"name":[count,min,p50,p99,max],...}}
+void publishDiagnostics(unsigned long window_ms) {
+    static char diagnostics[MQTT_OUTBOX_MAX_PAYLOAD];
+    uint32_t now = millis();
+    int length = snprintf(diagnostics, sizeof(diagnostics),
+                          "{\"timestamp\":%lu,\"uptime\":%lu,\"boot\":%lu,\"window_s\":%lu,\"stages\":",
+                          (unsigned long)now, (unsigned long)(now / 1000),
+                          (unsigned long)deviceClockBootCount(), window_ms / 1000);
+    length += stageTimerFormatJson(diagnostics + length, sizeof(diagnostics) - length - 1);
+    diagnostics[length++] = '}';
+    diagnostics[length] = '\0';
+    stageTimerReset();
     
-    mqttClient.publish(TOPIC_SYSTEM, buffer);
-    Serial.printf("System message published: %s\n", message.c_str());
+    if (mqtt_connected) {
+        mqttLinkPublish(TOPIC_DIAGNOSTICS, (const uint8_t*)diagnostics, length, MQTT_TELEMETRY);
+    }
 }
+#endif
 
 void handleMQTTConnection() {
-    if (!wifi_connected) return;
+    bool connected = mqttLinkConnected();
+    if (connected == mqtt_connected) return;
     
-    if (!mqttClient.connected()) {
-        mqtt_connected = false;
-        Serial.println("MQTT connection lost. Attempting to reconnect...");
-        
-        if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD)) {
-            mqtt_connected = true;
-            Serial.println("MQTT reconnected!");
-            publishSystemMessage("MQTT reconnected");
-        } else {
-            Serial.printf("MQTT reconnection failed. Error: %d\n", mqttClient.state());
-        }
-    } else {
-        mqtt_connected = true;
+    mqtt_connected = connected;
+    if (!connected) {
+        Serial.println("MQTT connection lost - reconnecting in the background");
+        return;
     }
+    
+    Serial.println("MQTT connected!");
+    publishSystemMessage(mqtt_announced ? "MQTT reconnected" : "Smart Palette Phase 2 started");
+    mqtt_announced = true;
 }
 
 void handleWiFiConnection() {
-    if (WiFi.status() != WL_CONNECTED) {
-        wifi_connected = false;
-        mqtt_connected = false;
-        Serial.println("WiFi connection lost. Attempting to reconnect...");
-        WiFi.reconnect();
-        
-        delay(5000);
-        
-        if (WiFi.status() == WL_CONNECTED) {
-            wifi_connected = true;
-            Serial.println("WiFi reconnected!");
-            Serial.printf("IP Address: %s\n", WiFi.localIP().toString().c_str());
+    bool connected = wifiLinkConnected();
+    if (connected == wifi_connected) return;
+    
+    wifi_connected = connected;
+    WifiLinkStats link = wifiLinkStats();
+    if (connected) {
+        IPAddress ip = WiFi.localIP();  // Octets: toString() would allocate on every reconnect
+        Serial.printf("WiFi connected! IP Address: %u.%u.%u.%u, Signal Strength: %d dBm\n",
+                     ip[0], ip[1], ip[2], ip[3], WiFi.RSSI());
+        if (link.connects > 1) {
+            Serial.printf("Outage lasted %lu ms (%lu reconnects so far)\n",
+                         (unsigned long)link.last_down_ms, (unsigned long)(link.connects - 1));
         }
     } else {
-        wifi_connected = true;
+        Serial.printf("WiFi connection lost (reason %u). Reconnecting in the background...\n",
+                     link.last_reason);
     }
 }
 
 // ============================================================================
 // SERIAL COMMAND HANDLING
 // ============================================================================
+#if EVENT_TRACE
+static bool printTraceLine(const char* line, void* context) {
+    (void)context;
+    Serial.println(line);
+    return true;
+}
+#endif
+
 void handleSerialCommands() {
     char command = Serial.read();
     while (Serial.available()) Serial.read(); // Clear input buffer
@@ -619,6 +839,17 @@ void handleSerialCommands() {
                 Serial.printf("IP: %s, RSSI: %d dBm\n", 
                              WiFi.localIP().toString().c_str(), WiFi.RSSI());
             }
+            {
+                WifiLinkStats link = wifiLinkStats();
+                Serial.printf("Link: %s, %lu connects, %lu drops, %lu/%lu attempts failed, last reason %u\n",
+                             wifiLinkStateName(link.state), (unsigned long)link.connects,
+                             (unsigned long)link.disconnects, (unsigned long)link.failures,
+                             (unsigned long)link.attempts, link.last_reason);
+                Serial.printf("Downtime: %lu ms now, last %lu ms, longest %lu ms, total %lu ms (first connect %lu ms)\n",
+                             (unsigned long)link.down_ms, (unsigned long)link.last_down_ms,
+                             (unsigned long)link.longest_down_ms, (unsigned long)link.total_down_ms,
+                             (unsigned long)link.first_connect_ms);
+            }
             break;
             
         case 'm':
@@ -627,7 +858,23 @@ void handleSerialCommands() {
             if (mqtt_connected) {
                 Serial.printf("Server: %s:%d\n", MQTT_SERVER, MQTT_PORT);
             }
+            {
+                MqttLinkStats link = mqttLinkStats();
+                Serial.printf("Outbox: %u waiting (peak %u), %lu sent, %lu overwritten, %lu rejected\n",
+                             link.depth, link.high_water, (unsigned long)link.sent,
+                             (unsigned long)link.overwritten, (unsigned long)link.rejected);
+                Serial.printf("Connects: %lu (%lu failed)\n",
+                             (unsigned long)link.connects, (unsigned long)link.connect_failures);
+            }
+            break;
+            
+#if EVENT_TRACE
+        case 'd':
+        case 'D':
+            // For tools/trace_to_chrome in the real-time firmware
+            eventTraceDump(printTraceLine, NULL, 0);
             break;
+#endif
             
         case 'h':
         case 'H':
@@ -797,11 +1044,14 @@ void showSystemInfo() {
         Serial.printf(" (%s:%d)", MQTT_SERVER, MQTT_PORT);
     }
     Serial.println();
+    Serial.printf("MQTT Reports: %lu sent (%lu heartbeats), %lu suppressed\n",
+                 (unsigned long)report_policy.published, (unsigned long)report_policy.heartbeats,
+                 (unsigned long)report_policy.suppressed);
     Serial.println("----------------------------------------");
     Serial.printf("Current Weights: %.3f + %.3f = %.3f kg\n", weight1, weight2, filtered_weight);
     Serial.printf("Bottle Count: %d\n", bottle_count);
-    Serial.printf("System Status: %s\n", system_status.c_str());
-    Serial.printf("Last Action: %s\n", last_action.c_str());
+    Serial.printf("System Status: %s\n", systemStatusName(system_status));
+    Serial.printf("Last Action: %s\n", last_action);
     Serial.println("========================================");
 }
 
@@ -813,6 +1063,9 @@ void printHelp() {
     Serial.println("'w' or 'W' - Show WiFi connection status");
     Serial.println("'m' or 'M' - Show MQTT connection status");
     Serial.println("'i' or 'I' - Show complete system information");
+#if EVENT_TRACE
+    Serial.println("'d' or 'D' - Dump the event trace");
+#endif
     Serial.println("'h' or 'H' - Show this help menu");
 }
 
@@ -823,10 +1076,10 @@ bool checkLoadCellConnections() {
     return (scale1.is_ready() && scale2.is_ready());
 }
 
-String getSystemStatus() {
-    if (!system_ready) return "INITIALIZING";
-    if (!checkLoadCellConnections()) return "HARDWARE_ERROR";
-    if (!is_stable) return "MEASURING";
-    if (bottle_count == 0) return "EMPTY";
-    return "READY";
+SystemStatus getSystemStatus() {
+    if (!system_ready) return SYSTEM_INITIALIZING;
+    if (!checkLoadCellConnections()) return SYSTEM_HARDWARE_ERROR;
+    if (!is_stable) return SYSTEM_MEASURING;
+    if (bottle_count == 0) return SYSTEM_EMPTY;
+    return SYSTEM_READY;
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+/*
+  hm033_parser.h - Framed UART decoder for the HM-033 NFC reader
+  Bytes are fed one at a time from the UART receive callback; payload bytes
+  are written straight into a slot of a small frame queue, so a completed
+  UID is handed to loop() without copying or per-byte delays.
+
+  Frame layout (HM-033 card report):
+    [HEADER] [LEN] [CARD TYPE] [UID x (LEN - 1)] [CHECKSUM]
+  CHECKSUM = XOR of LEN, CARD TYPE and every UID byte.
+*/
+
+#ifndef HM033_PARSER_H
+#define HM033_PARSER_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// HM-033 Protocol Configuration - adjust if your module revision differs
+// ============================================================================
+#define HM033_FRAME_HEADER 0x02        // Start of card report frame
+#define HM033_MIN_UID_LENGTH 4         // Single size UID
+#define HM033_MAX_UID_LENGTH 10        // Triple size UID
+#define HM033_INTERBYTE_TIMEOUT 20     // ms of silence that abandons a partial frame
+#define HM033_FRAME_QUEUE 4            // Completed frames waiting for loop()
+
+enum HM033ParseState {
+  HM033_WAIT_HEADER,
+  HM033_READ_LENGTH,
+  HM033_READ_CARD_TYPE,
+  HM033_READ_UID,
+  HM033_READ_CHECKSUM
+};
+
+struct HM033Frame {
+  uint8_t card_type;
+  uint8_t uid_length;
+  uint8_t uid[HM033_MAX_UID_LENGTH];
+};
+
+struct HM033Parser {
+  HM033ParseState state;
+  uint8_t checksum;
+  uint8_t received;                    // UID bytes written into target so far
+  unsigned long last_byte_time;
+  HM033Frame* target;                  // Queue slot (or scratch) being filled
+  HM033Frame frames[HM033_FRAME_QUEUE];
+  HM033Frame scratch;                  // Absorbs frames while the queue is full
+  volatile uint8_t head;               // Written by the UART callback only
+  volatile uint8_t tail;               // Written by loop() only
+
+  // Diagnostics
+  uint32_t frames_ok;
+  uint32_t checksum_errors;
+  uint32_t length_errors;
+  uint32_t timeouts;
+  uint32_t overruns;
+};
+
+void hm033Reset(HM033Parser* parser);
+
+// Feeds one received byte; returns true when it completed a valid frame
+bool hm033Feed(HM033Parser* parser, uint8_t value, unsigned long now);
+
+// Oldest completed frame, or NULL; release it with hm033Pop() when done
+const HM033Frame* hm033Peek(const HM033Parser* parser);
+void hm033Pop(HM033Parser* parser);
+
+#endif // HM033_PARSER_H
@@ -0,0 +1,97 @@
+/*
+ * HM-033 UART frame decoder
+ * Single producer (UART receive callback) / single consumer (loop()).
+ */
+
+#include "hm033_parser.h"
+
+static bool queueFull(const HM033Parser* parser) {
+  return (uint8_t)((parser->head + 1) % HM033_FRAME_QUEUE) == parser->tail;
+}
+
+void hm033Reset(HM033Parser* parser) {
+  memset(parser, 0, sizeof(HM033Parser));
+  parser->state = HM033_WAIT_HEADER;
+  parser->target = &parser->scratch;
+}
+
+bool hm033Feed(HM033Parser* parser, uint8_t value, unsigned long now) {
+  // A gap inside a frame means the rest of it was lost - resynchronise
+  if (parser->state != HM033_WAIT_HEADER &&
+      now - parser->last_byte_time > HM033_INTERBYTE_TIMEOUT) {
+    parser->timeouts++;
+    parser->state = HM033_WAIT_HEADER;
+  }
+  parser->last_byte_time = now;
+
+  HM033Frame* frame = parser->target;
+
+  switch (parser->state) {
+    case HM033_WAIT_HEADER:
+      if (value == HM033_FRAME_HEADER) {
+        if (queueFull(parser)) {
+          parser->overruns++;
+          parser->target = &parser->scratch;
+        } else {
+          parser->target = &parser->frames[parser->head];
+        }
+        parser->state = HM033_READ_LENGTH;
+      }
+      break;
+
+    case HM033_READ_LENGTH:
+      // LEN covers the card type byte plus the UID
+      if (value < HM033_MIN_UID_LENGTH + 1 || value > HM033_MAX_UID_LENGTH + 1) {
+        parser->length_errors++;
+        parser->state = (value == HM033_FRAME_HEADER) ? HM033_READ_LENGTH : HM033_WAIT_HEADER;
+        break;
+      }
+      frame->uid_length = value - 1;
+      parser->checksum = value;
+      parser->state = HM033_READ_CARD_TYPE;
+      break;
+
+    case HM033_READ_CARD_TYPE:
+      frame->card_type = value;
+      parser->checksum ^= value;
+      parser->received = 0;
+      parser->state = HM033_READ_UID;
+      break;
+
+    case HM033_READ_UID:
+      frame->uid[parser->received++] = value;
+      parser->checksum ^= value;
+      if (parser->received == frame->uid_length) {
+        parser->state = HM033_READ_CHECKSUM;
+      }
+      break;
+
+    case HM033_READ_CHECKSUM:
+      parser->state = HM033_WAIT_HEADER;
+      if (value != parser->checksum) {
+        parser->checksum_errors++;
+        return false;
+      }
+      if (frame == &parser->scratch) {
+        return false;                  // Valid, but dropped by a full queue
+      }
+      parser->frames_ok++;
+      parser->head = (parser->head + 1) % HM033_FRAME_QUEUE;
+      return true;
+  }
+
+  return false;
+}
+
+const HM033Frame* hm033Peek(const HM033Parser* parser) {
+  if (parser->tail == parser->head) {
+    return NULL;
+  }
+  return &parser->frames[parser->tail];
+}
+
+void hm033Pop(HM033Parser* parser) {
+  if (parser->tail != parser->head) {
+    parser->tail = (parser->tail + 1) % HM033_FRAME_QUEUE;
+  }
+}
@@ -1,6 +1,7 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include "hm033_parser.h"
 
 // Hardware pins
 #define NFC_RX_PIN 16
@@ -11,6 +12,10 @@
 
 // NFC Communication
 HardwareSerial nfcSerial(2); // Use UART2 for NFC communication
+HM033Parser nfcParser;       // Fed from the UART receive callback
+
+void onNFCSerialReceive();
+void handleNFCTap(String cardId);
 
 // System states
 enum PalletState {
@@ -28,7 +33,7 @@ unsigned long lastTapTime = 0;
 int tapCount = 0;
 bool doubleTapDetected = false;
 
-// Known NFC card IDs (you'll need to scan these first)
+// Known NFC card IDs - hex UIDs as printed by "NFC card UID:" (scan these first)
 String knownCards[3] = {
   "CARD_ID_1", // Replace with actual card IDs
   "CARD_ID_2",
@@ -43,7 +48,11 @@ String lorryNames[3] = {
 
 void setup() {
   Serial.begin(115200);
-  nfcSerial.begin(9600);
+  
+  // Frames are decoded as bytes arrive, driven by the UART event task
+  hm033Reset(&nfcParser);
+  nfcSerial.begin(9600, SERIAL_8N1, NFC_RX_PIN, NFC_TX_PIN);
+  nfcSerial.onReceive(onNFCSerialReceive);
   
   // Initialize LED pins
   pinMode(BLUE_LED, OUTPUT);
@@ -77,37 +86,27 @@ void initializeNFC() {
   Serial.println("NFC Reader initialized");
 }
 
-void checkForNFCCard() {
-  if (nfcSerial.available()) {
-    String cardId = readNFCCard();
-    if (cardId.length() > 0) {
-      handleNFCTap(cardId);
-    }
-  }
-}
-
-String readNFCCard() {
-  String cardData = "";
+void onNFCSerialReceive() {
+  // Runs in the UART event task: drain the FIFO into the frame decoder
+  unsigned long now = millis();
   while (nfcSerial.available()) {
-    char c = nfcSerial.read();
-    cardData += c;
-    delay(10);
+    hm033Feed(&nfcParser, (uint8_t)nfcSerial.read(), now);
   }
-  
-  // Process the card data based on HM-033 protocol
-  // You may need to adjust this based on the actual data format
-  if (cardData.length() > 0) {
-    Serial.println("Raw NFC data: " + cardData);
-    return extractCardId(cardData);
-  }
-  
-  return "";
 }
 
-String extractCardId(String rawData) {
-  // Extract actual card ID from raw data
-  // This depends on HM-033 data format - adjust as needed
-  return rawData; // Simplified for now
+void checkForNFCCard() {
+  const HM033Frame* frame;
+  while ((frame = hm033Peek(&nfcParser)) != NULL) {
+    char cardId[HM033_MAX_UID_LENGTH * 2 + 1];
+    for (uint8_t i = 0; i < frame->uid_length; i++) {
+      sprintf(&cardId[i * 2], "%02X", frame->uid[i]);
+    }
+    cardId[frame->uid_length * 2] = '\0';
+    hm033Pop(&nfcParser);
+    
+    Serial.printf("NFC card UID: %s\n", cardId);
+    handleNFCTap(cardId);
+  }
 }
 
 void handleNFCTap(String cardId) {
@@ -17,21 +17,87 @@ from datetime import datetime, timedelta
 import time
 import threading
 import signal
+import struct
 import sys
 
 # MQTT Configuration (matches your system)
 MQTT_BROKER = "broker.hivemq.com"
 MQTT_TOPICS = [
+    "bottle-scale/+/+/frame",    # bottle-scale/<site>/<device>/frame
+    "bottle-scale/+/+/samples",  # bottle-scale/<site>/<device>/samples
+    # Shared text topics, only from firmware built with -DMQTT_LEGACY_TOPICS=1
     "bottle-scale/weight",
     "bottle-scale/bottles", 
     "bottle-scale/status",
     "bottle-scale/data"
 ]
 
+# Binary pallet snapshot, layout in lib/PalletTelemetry/src/telemetry_frame.h
+SNAPSHOT_SCHEMA = 0x01
+SNAPSHOT_V1 = struct.Struct('<BBIihBBBB7s')
+SNAPSHOT_V3_TAIL = struct.Struct('<QIIHh')   # At offset 28: epoch_ms, boot, sequence, ...
+STATUS_NAMES = {0: 'idle', 1: 'loading', 2: 'unloading'}
+
+# Full-rate sample windows (firmware built with -DSAMPLE_BATCHING=1),
+# layout in lib/PalletTelemetry/src/sample_window.h
+SAMPLE_WINDOW_SCHEMA = 0x02
+SAMPLE_WINDOW_HEADER = struct.Struct('<BBIIHHBBiiff')
+SAMPLE_WINDOW_TRAILER = struct.Struct('<IQ')  # Version 2: boot_count, start_epoch_ms
+SAMPLE_UNITS = {0: 'raw', 1: 'decigram'}
+
 # Data storage
 collected_data = []
+collected_samples = []
 is_collecting = False
 
+def decode_snapshot(payload):
+    """Unpack one bottle-scale/<site>/<device>/frame message into the fields
+    the old bottle-scale/data JSON had"""
+    if len(payload) < SNAPSHOT_V1.size or payload[0] != SNAPSHOT_SCHEMA:
+        raise ValueError(f"not a snapshot frame ({len(payload)} bytes)")
+    (schema, version, device_ms, weight_g, bottles, status, nfc_state,
+     open_transactions, uid_length, uid) = SNAPSHOT_V1.unpack_from(payload)
+    data = {
+        'device_ms': device_ms, 'weight_g': weight_g,
+        'weight_oz': round(weight_g / 28.34952, 2), 'bottles': bottles,
+        'status': STATUS_NAMES.get(status, 'idle'), 'open_transactions': open_transactions,
+        'vehicle_id': uid[:min(uid_length, 7)].hex().upper(),
+        'epoch_ms': None, 'boot': None, 'sequence': None
+    }
+    if version >= 3 and len(payload) >= 28 + SNAPSHOT_V3_TAIL.size:
+        epoch_ms, boot, sequence, _, _ = SNAPSHOT_V3_TAIL.unpack_from(payload, 28)
+        data.update(epoch_ms=epoch_ms or None, boot=boot, sequence=sequence)
+    return data
+
+def decode_sample_window(payload):
+    """Unpack one bottle-scale/samples message into its header and samples"""
+    (schema, version, window, start_ms, span_ms, count, unit, width,
+     w_min, w_max, mean, variance) = SAMPLE_WINDOW_HEADER.unpack_from(payload)
+    if schema != SAMPLE_WINDOW_SCHEMA or count == 0 or width not in (2, 4):
+        raise ValueError(f"not a sample window (schema {schema}, count {count}, width {width})")
+
+    # First sample absolute, the rest deltas from their predecessor
+    offset = SAMPLE_WINDOW_HEADER.size
+    deltas = struct.unpack_from(f"<i{count - 1}{'h' if width == 2 else 'i'}", payload, offset)
+    samples = np.cumsum(deltas, dtype=np.int64)
+
+    boot, start_epoch_ms = None, None
+    if version >= 2:
+        boot, start_epoch_ms = SAMPLE_WINDOW_TRAILER.unpack_from(
+            payload, offset + 4 + (count - 1) * width)
+        start_epoch_ms = start_epoch_ms or None  # 0 = device clock not synced
+
+    # Conversions are evenly spaced between the first and last sample
+    step = span_ms / (count - 1) if count > 1 else 0
+    return {
+        'boot': boot, 'window': window, 'start_ms': start_ms, 'start_epoch_ms': start_epoch_ms,
+        'span_ms': span_ms, 'count': count,
+        'unit': SAMPLE_UNITS.get(unit, 'unknown'), 'min': w_min, 'max': w_max,
+        'mean': mean, 'variance': variance,
+        'device_ms': [start_ms + round(i * step) for i in range(count)],
+        'samples': samples.tolist()
+    }
+
 def on_connect(client, userdata, flags, rc):
     """Callback for when the MQTT client connects"""
     if rc == 0:
@@ -53,9 +119,23 @@ def on_message(client, userdata, msg):
         topic = msg.topic
         timestamp = datetime.now()
         
-        if topic == "bottle-scale/data":
-            # Parse JSON data
+        if topic.startswith("bottle-scale/") and topic.endswith("/samples"):
+            window = decode_sample_window(msg.payload)
+            window['timestamp'] = timestamp
+            window['device_id'] = topic.split('/')[2]
+            collected_samples.append(window)
+            return
+
+        if topic.startswith("bottle-scale/") and topic.endswith("/frame"):
+            data = decode_snapshot(msg.payload)
+            data['device_id'] = topic.split('/')[2]
+        elif topic == "bottle-scale/data":
+            # Parse JSON data (legacy firmware)
             data = json.loads(msg.payload.decode())
+        else:
+            data = None
+
+        if data is not None:
             data['timestamp'] = timestamp
             data['topic'] = topic
             collected_data.append(data)
@@ -75,6 +155,30 @@ def on_message(client, userdata, msg):
     except Exception as e:
         print(f"❌ Error parsing message: {e}")
 
+def process_sample_windows(windows):
+    """Flatten sample windows into one row per conversion"""
+    if not windows:
+        return None
+
+    rows = []
+    for w in windows:
+        scale = 0.1 if w['unit'] == 'decigram' else 1.0
+        offset = (w['start_epoch_ms'] - w['start_ms']) if w['start_epoch_ms'] else None
+        for device_ms, value in zip(w['device_ms'], w['samples']):
+            rows.append({'boot': w['boot'], 'window': w['window'], 'device_ms': device_ms,
+                         'epoch_ms': device_ms + offset if offset is not None else None,
+                         'value': value * scale, 'unit': 'g' if scale != 1.0 else w['unit']})
+    df = pd.DataFrame(rows)
+
+    # Window numbers restart with every boot
+    lost = 0
+    for boot in {w['boot'] for w in windows}:
+        windows_seen = sorted({w['window'] for w in windows if w['boot'] == boot})
+        lost += windows_seen[-1] - windows_seen[0] + 1 - len(windows_seen)
+    rate = sum(w['count'] for w in windows) / max(sum(w['span_ms'] for w in windows) / 1000.0, 1e-9)
+    print(f"📈 {len(df)} samples in {len(windows)} windows (~{rate:.0f} SPS, {lost} windows lost)")
+    return df
+
 def signal_handler(sig, frame):
     """Handle Ctrl+C gracefully"""
     global is_collecting
@@ -129,11 +233,12 @@ def process_collected_data(data):
         print("❌ No data to process")
         return None
     
-    # Separate JSON data from individual topics
-    json_data = [d for d in data if d.get('topic') == 'bottle-scale/data']
+    # Separate snapshots (frames, or legacy JSON) from individual topics
+    json_data = [d for d in data if 'bottles' in d]
     
     if not json_data:
-        print("❌ No JSON data found. Make sure your system is publishing to 'bottle-scale/data'")
+        print("❌ No snapshots found. Make sure your system is publishing to "
+              "'bottle-scale/<site>/<device>/frame'")
         return None
     
     # Convert to DataFrame
@@ -225,6 +330,12 @@ def main():
     # Collect data
     data = collect_data_for_duration(duration)
     
+    samples_df = process_sample_windows(collected_samples)
+    if samples_df is not None:
+        samples_filename = f'realtime_samples_{datetime.now().strftime("%Y%m%d_%H%M%S")}.csv'
+        samples_df.to_csv(samples_filename, index=False)
+        print(f"💾 Full-rate samples saved to: {samples_filename}")
+
     if not data:
         print("❌ No data collected. Please check:")
         print("   • Your Smart Inventory Pallet system is running")
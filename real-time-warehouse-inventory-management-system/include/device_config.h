@@ -0,0 +1,60 @@
+/*
+  device_config.h - Runtime-tunable settings persisted in NVS
+  Values that used to be compile-time constants (the heartbeat interval,
+  the weight deadband and the weight of one bottle) can now be changed
+  over MQTT (remote_commands.h). Each change is range-checked, written to
+  NVS and survives a reboot; the compile-time values are only the
+  defaults for keys that were never set.
+
+  The store is written from the console task only. The NFC task reads the
+  values after the console tells it they changed.
+*/
+
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Config Store Configuration
+// ============================================================================
+#define DEVICE_CONFIG_NAMESPACE "config"
+
+// Accepted ranges for each key
+#define DEVICE_CONFIG_INTERVAL_MIN 5000        // Heartbeat, ms
+#define DEVICE_CONFIG_INTERVAL_MAX 3600000
+#define DEVICE_CONFIG_DEADBAND_MIN 1           // grams
+#define DEVICE_CONFIG_DEADBAND_MAX 5000
+#define DEVICE_CONFIG_UNIT_WEIGHT_MIN 10       // grams per bottle
+#define DEVICE_CONFIG_UNIT_WEIGHT_MAX 20000
+
+enum DeviceConfigKey {
+  CONFIG_PUBLISH_INTERVAL = 0,           // Report-by-exception heartbeat, ms
+  CONFIG_WEIGHT_DEADBAND,                // Weight drift reported without a count change, g
+  CONFIG_UNIT_WEIGHT,                    // Weight of one bottle, g
+  CONFIG_KEY_COUNT
+};
+
+enum DeviceConfigResult {
+  CONFIG_OK = 0,
+  CONFIG_OUT_OF_RANGE,
+  CONFIG_NOT_SAVED                       // Applied for this boot, but NVS refused the write
+};
+
+struct DeviceConfig {
+  uint32_t publish_interval;
+  int32_t weight_deadband;
+  int32_t unit_weight_g;
+};
+
+// Loads stored values over the given defaults
+void deviceConfigBegin(const DeviceConfig* defaults);
+
+const DeviceConfig* deviceConfig();
+
+// Validates, applies and persists one value
+DeviceConfigResult deviceConfigSet(DeviceConfigKey key, int32_t value);
+
+const char* deviceConfigKeyName(DeviceConfigKey key);
+
+#endif // DEVICE_CONFIG_H
@@ -0,0 +1,45 @@
+/*
+  nfc_presence.h - Duplicate-read suppression for NFC taps
+  A card resting on the reader is read on every poll. This cache remembers
+  recently seen UIDs with timestamps and turns the stream of reads into one
+  "present" event when a card arrives and one "removed" event when it has
+  not been read for NFC_REMOVAL_TIMEOUT. Only arrivals count as taps, so a
+  card left on the antenna can no longer look like a double tap.
+*/
+
+#ifndef NFC_PRESENCE_H
+#define NFC_PRESENCE_H
+
+#include <Arduino.h>
+#include "nfc_transactions.h"
+
+// ============================================================================
+// Presence Cache Configuration
+// ============================================================================
+#define NFC_PRESENCE_SLOTS 8           // Distinct cards remembered at once
+#define NFC_REMOVAL_TIMEOUT 1200       // ms without a read before a card counts as removed
+
+enum NFCPresenceEvent {
+  NFC_CARD_REPEAT,                     // Same card still on the reader - ignore
+  NFC_CARD_PRESENT                     // Card arrived - this is a tap
+};
+
+struct NFCPresenceEntry {
+  bool in_use;
+  bool present;
+  char uid[VEHICLE_ID_LENGTH];
+  unsigned long arrival_time;          // Start of the current (or last) presence
+  unsigned long last_seen;             // Most recent successful read
+  uint32_t reads;                      // Reads collapsed into this presence
+};
+
+void nfcPresenceBegin();
+
+// Records a successful read of uid at time now
+NFCPresenceEvent nfcPresenceSeen(const char* uid, unsigned long now);
+
+// Reports cards that have left the reader; on_removed gets the UID and how
+// long it stayed on the antenna
+void nfcPresenceExpire(unsigned long now, void (*on_removed)(const char* uid, unsigned long dwell_ms));
+
+#endif // NFC_PRESENCE_H
@@ -0,0 +1,54 @@
+/*
+  nfc_readers.h - Round-robin scheduler for up to four PN532 readers
+  Readers may sit on separate SPI chip-selects, separate I2C buses (the
+  PN532 I2C address is fixed at 0x24, so use Wire and Wire1) or a mix.
+  Each call to nfcReadersPoll() services exactly one reader, so adding
+  readers does not multiply the time the NFC task spends blocked:
+  - readers with an IRQ line keep an InListPassiveTarget armed and are only
+    read once the PN532 pulls IRQ low;
+  - readers without one answer "no card" after NFC_PASSIVE_RETRIES retries
+    instead of waiting out a long timeout.
+  Health (nfc_available / last_health_check) is tracked per reader.
+*/
+
+#ifndef NFC_READERS_H
+#define NFC_READERS_H
+
+#include <Arduino.h>
+#include <Adafruit_PN532.h>
+#include "nfc_transactions.h"
+
+// ============================================================================
+// Reader Scheduling Configuration
+// ============================================================================
+#define MAX_NFC_READERS 4
+#define NFC_NO_IRQ -1                  // Reader has no IRQ line wired
+#define NFC_PASSIVE_RETRIES 0x02       // InListPassiveTarget retries for polled readers
+#define NFC_POLL_SLOT_TIMEOUT 50       // ms a polled reader may take to answer
+#define NFC_HEALTH_CHECK_INTERVAL 10000  // Ping an idle reader every 10 seconds
+#define NFC_RECONNECT_INTERVAL 30000   // Retry a lost reader every 30 seconds
+
+struct NFCReader {
+  const char* name;                    // Shown in logs, e.g. "front" / "rear"
+  Adafruit_PN532* pn532;
+  int8_t irq_pin;                      // NFC_NO_IRQ for polled readers
+
+  // Runtime state
+  bool available;
+  bool detecting;                      // Asynchronous detection armed (IRQ readers)
+  unsigned long last_check;            // Last reconnect attempt while unavailable
+  unsigned long last_health_check;
+  uint32_t cards_read;
+  uint32_t failures;
+};
+
+// Initialises every reader; returns how many answered
+int nfcReadersBegin(NFCReader* readers, int count);
+
+// Services the next reader in turn. Returns true and fills vehicle_id
+// (hex UID, VEHICLE_ID_LENGTH bytes) and reader_index when a card was read.
+bool nfcReadersPoll(char* vehicle_id, int* reader_index);
+
+int nfcReadersAvailableCount();
+
+#endif // NFC_READERS_H
@@ -0,0 +1,94 @@
+/*
+  nfc_transactions.h - Open NFC transaction table
+  Keeps one entry per vehicle so several lorries can work the same
+  pallet row at once. Each entry carries its own start snapshot,
+  timeout and state. Start and end counts are looked up in the weight
+  history at the exact tap times; when transactions overlap, bottle count
+  changes are credited to entries by the time they were sampled.
+*/
+
+#ifndef NFC_TRANSACTIONS_H
+#define NFC_TRANSACTIONS_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Transaction Table Configuration
+// ============================================================================
+#define MAX_OPEN_TRANSACTIONS 8        // Vehicles that can hold a transaction at once
+#define NFC_UID_MAX_LENGTH 7           // PN532 reports ISO14443A UIDs of up to 7 bytes
+#define VEHICLE_ID_LENGTH (NFC_UID_MAX_LENGTH * 2 + 1)  // Hex string + terminator
+#define TRANSACTION_TIMEOUT 900000     // Abandon an open transaction after 15 minutes
+#define TRANSACTION_RESULT_HOLD 3000   // Keep a completed entry visible for 3 seconds
+
+// NFC Transaction States (NFC_IDLE marks a free slot)
+enum NFCTransactionState {
+  NFC_IDLE,
+  NFC_LOAD_READY,
+  NFC_LOAD_COMPLETE,
+  NFC_UNLOAD_READY,
+  NFC_UNLOAD_COMPLETE
+};
+
+struct NFCTransaction {
+  NFCTransactionState state;
+  char vehicle_id[VEHICLE_ID_LENGTH];
+  unsigned long start_time;      // Tap that opened the transaction
+  unsigned long last_tap_time;   // Most recent tap by this vehicle
+  unsigned long end_time;        // Tap that closed it (0 while open)
+  unsigned long resolved_at;     // Result became final; the display holds it from here
+  int start_bottles;             // Pallet count when the transaction opened
+  int end_bottles;               // Pallet count when it closed
+  int attributed_bottles;        // Signed sum of count changes credited to it
+  bool start_resolved;           // start_bottles taken from history at start_time
+  bool end_resolved;             // end_bottles taken from history at end_time
+  bool overlapped;               // Another vehicle had a transaction open meanwhile
+};
+
+void nfcTransactionsBegin();
+
+// Entry currently held by a vehicle (open or recently completed), or NULL
+NFCTransaction* nfcTransactionFind(const char* vehicle_id);
+
+// Opens a LOAD_READY/UNLOAD_READY entry; NULL when no slot can be reused
+NFCTransaction* nfcTransactionOpen(const char* vehicle_id, NFCTransactionState state,
+                                   unsigned long tap_time, int bottles);
+
+// Marks the entry complete; its result is final once nfcTransactionsResolve()
+// has looked up the weight at tap_time
+void nfcTransactionClose(NFCTransaction* tx, unsigned long tap_time, int bottles);
+
+// Bottles moved by the vehicle: LOAD counts removals, UNLOAD counts additions.
+// A transaction that ran alone uses the history counts at its two taps; one
+// that overlapped another uses the changes credited to it.
+int nfcTransactionBottleDifference(const NFCTransaction* tx);
+
+// Call after each new weight sample: resolves start/end counts from the weight
+// history and reports completed transactions whose result is now final
+void nfcTransactionsResolve(unsigned long now, void (*on_complete)(const NFCTransaction* tx));
+
+// Credits a pallet count change sampled at sample_time to one open entry
+void nfcTransactionsAttribute(int bottle_delta, unsigned long sample_time);
+
+// Call when the scale is re-zeroed or its unit weight changes: open entries
+// stop using the history counts at their taps, which are on the old baseline,
+// and report only the changes credited to them
+void nfcTransactionsRebase();
+
+// As nfcTransactionsRebase() for a unit weight change: the changes already
+// credited to open entries are converted from the old unit to the new one
+void nfcTransactionsRescale(long from_unit_g, long to_unit_g);
+
+// Frees reported entries after TRANSACTION_RESULT_HOLD and abandons open
+// ones after TRANSACTION_TIMEOUT (on_timeout is called before the slot is freed)
+void nfcTransactionsExpire(unsigned long now, void (*on_timeout)(const NFCTransaction* tx));
+
+// Most recently tapped entry, used for LEDs, display and telemetry
+NFCTransaction* nfcTransactionLatest();
+
+int nfcTransactionsOpenCount();
+bool nfcTransactionIsOpen(const NFCTransaction* tx);
+const char* nfcStateName(NFCTransactionState state);
+const char* nfcTransactionType(const NFCTransaction* tx);
+
+#endif // NFC_TRANSACTIONS_H
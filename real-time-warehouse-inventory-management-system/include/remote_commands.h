@@ -0,0 +1,80 @@
+/*
+  remote_commands.h - Commands over MQTT instead of the USB serial cable
+  Each pallet subscribes to bottle-scale/<site>/<client ID>/cmd (and the
+  site-wide bottle-scale/<site>/all/cmd) and accepts one small JSON object
+  per message:
+
+    {"id":"42","cmd":"set_deadband","value":30}
+
+    id      correlation ID echoed in the response (up to 23 characters)
+    cmd     tare | calibrate | set_interval | set_deadband |
+            set_unit_weight | reboot | stats | trace
+    value   integer argument: ms for set_interval, grams for the others;
+            for calibrate the reference weight on the scale (optional);
+            for trace the number of newest events to publish (optional)
+
+  The answer goes to bottle-scale/<site>/<client ID>/cmd-response:
+
+    {"id":"42","cmd":"set_deadband","ok":true,"result":{...}}
+    {"id":"42","ok":false,"error":"value out of range"}
+
+  Parsing happens on the MQTT network task into a fixed StaticJsonDocument:
+  messages over REMOTE_COMMAND_MAX_PAYLOAD bytes or nested objects are
+  refused before any allocation. Parsed commands are handed to the console
+  task through a small FreeRTOS queue. Tare and calibration take the HX711
+  from the acquisition task there, so they never overlap a weight reading.
+  A malformed command still reaches the queue so its sender gets an error.
+*/
+
+#ifndef REMOTE_COMMANDS_H
+#define REMOTE_COMMANDS_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Command Channel Configuration
+// ============================================================================
+#define REMOTE_COMMAND_MAX_PAYLOAD 192     // Larger messages are rejected unparsed
+#define REMOTE_COMMAND_JSON_CAPACITY 192   // StaticJsonDocument pool: one flat object
+#define REMOTE_COMMAND_ID_LENGTH 24        // Including the terminator
+#define REMOTE_COMMAND_QUEUE_DEPTH 4       // Commands waiting for the console task
+
+enum RemoteCommandOp {
+  CMD_INVALID = 0,                       // Parse error - answered with error
+  CMD_TARE,
+  CMD_CALIBRATE,
+  CMD_SET_INTERVAL,
+  CMD_SET_DEADBAND,
+  CMD_SET_UNIT_WEIGHT,
+  CMD_REBOOT,
+  CMD_STATS,
+  CMD_TRACE                              // Event trace dump (event_trace.h)
+};
+
+struct RemoteCommand {
+  char id[REMOTE_COMMAND_ID_LENGTH];     // "" if the message carried none
+  RemoteCommandOp op;
+  bool has_value;
+  int32_t value;
+  const char* error;                     // Static text, set when op is CMD_INVALID
+};
+
+struct RemoteCommandStats {
+  uint32_t received;
+  uint32_t invalid;                      // Answered with a parse error
+  uint32_t dropped;                      // Queue full or oversize - never answered
+};
+
+void remoteCommandsBegin();
+
+// Network task: parses one message and queues it for the console task.
+// Returns false if it was dropped.
+bool remoteCommandReceive(const uint8_t* payload, unsigned int length);
+
+// Console task: next queued command, without waiting
+bool remoteCommandNext(RemoteCommand* command);
+
+const char* remoteCommandName(RemoteCommandOp op);
+RemoteCommandStats remoteCommandStats();
+
+#endif // REMOTE_COMMANDS_H
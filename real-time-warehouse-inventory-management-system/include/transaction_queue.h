@@ -0,0 +1,95 @@
+/*
+  transaction_queue.h - Store-and-forward queue for completed NFC transactions
+  Every completed LOAD/UNLOAD is appended to flash before anything is
+  published, and the queue drains in order once the broker is reachable,
+  so a result from a WiFi dropout (or a reboot) is sent late instead of lost.
+
+  Layout on LittleFS: /txq/<segment>.seg files of fixed 32-byte records
+  (sequence number and CRC32 in each), 4 KB per segment, plus a small
+  /txq/cursor file holding the read position, next sequence number and
+  queue generation (random, chosen when the queue is first created).
+  Each record costs one append; the cursor is rewritten when an
+  acknowledgement moves the read position, and fully acknowledged segments
+  are deleted. LittleFS spreads these
+  writes over the partition (wear leveling) and replaces the cursor file
+  atomically.
+
+  Records leave flash only once the backend acknowledges them. Up to
+  TXQ_INFLIGHT_WINDOW records are in flight at a time; each is resent with
+  exponential backoff until its acknowledgement arrives, and the read
+  position moves past the acknowledged prefix. Every record has a
+  transaction ID (queue generation + sequence) that is unique across
+  reboots and flash formats, so the backend can drop the duplicates that
+  resends produce and count each transaction exactly once.
+*/
+
+#ifndef TRANSACTION_QUEUE_H
+#define TRANSACTION_QUEUE_H
+
+#include <Arduino.h>
+#include "nfc_transactions.h"
+
+// ============================================================================
+// Queue Configuration
+// ============================================================================
+#define TXQ_DIR "/txq"
+#define TXQ_RECORD_SIZE 32
+#define TXQ_RECORDS_PER_SEGMENT 128    // 4 KB segment files
+#define TXQ_MAX_SEGMENTS 64            // 8192 transactions (256 KB) before the oldest are dropped
+#define TXQ_INFLIGHT_WINDOW 4          // Records sent but not yet acknowledged
+#define TXQ_ACK_TIMEOUT 5000           // ms before the first resend, doubling per resend
+#define TXQ_ACK_TIMEOUT_MAX 60000
+#define TXQ_ID_LENGTH 17               // 16 hex characters + NUL
+
+enum QueuedTransactionType {
+  TXQ_LOAD = 0,
+  TXQ_UNLOAD = 1
+};
+
+struct QueuedTransaction {
+  uint32_t sequence;                   // Assigned on append; keeps increasing across reboots
+  uint32_t completed_at;               // millis() of the tap that closed the transaction
+  uint64_t completed_epoch_ms;         // Unix time in ms of the same moment, 0 if unknown
+  uint8_t boot_tag;                    // Low byte of the boot counter at completion
+  char vehicle_id[VEHICLE_ID_LENGTH];
+  uint8_t type;                        // QueuedTransactionType
+  int16_t bottle_count;                // Bottles moved by the vehicle
+  int16_t total_bottles;               // Pallet count after the transaction
+};
+
+struct TxQueueStats {
+  uint32_t pending;                    // Records waiting to be published
+  uint32_t appended;                   // Since boot
+  uint32_t acknowledged;               // Since boot
+  uint32_t resent;                     // Sends after an acknowledgement timed out
+  uint32_t in_flight;                  // Sent and waiting for an acknowledgement
+  uint32_t dropped;                    // Oldest records discarded because the queue was full
+  uint32_t corrupt;                    // Records skipped because their CRC did not match
+};
+
+// Mounts LittleFS (formatting it on first use) and recovers the queue
+// position from flash. Returns false if the queue is unavailable.
+bool txQueueBegin();
+
+// Stores the transaction and sets tx->sequence; false if it could not be written
+bool txQueueAppend(QueuedTransaction* tx);
+
+// Sends the oldest records that are not in flight yet and resends those
+// whose acknowledgement is overdue, stopping at the first one publish()
+// rejects. Returns the number of publishes. May run on a different task than
+// txQueueAppend(); publish() is called without the queue lock held, so
+// appends never wait on the network.
+int txQueueService(bool (*publish)(const QueuedTransaction* tx), unsigned long now_ms);
+
+// Backend acknowledged the record with this transaction ID; false if it is
+// not in flight (already acknowledged, or from another queue generation)
+bool txQueueAck(const char* tx_id);
+
+// "<generation><sequence>" as 16 lowercase hex characters
+void txQueueTransactionId(uint32_t sequence, char* tx_id);
+
+uint32_t txQueuePending();
+const TxQueueStats* txQueueStats();
+const char* txQueueTypeName(uint8_t type);
+
+#endif // TRANSACTION_QUEUE_H
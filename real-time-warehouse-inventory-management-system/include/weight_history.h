@@ -0,0 +1,38 @@
+/*
+  weight_history.h - Bounded history of timestamped weight samples
+  Lets NFC transactions look up the pallet weight at the exact moment a card
+  was tapped instead of whatever bottle_count happened to hold, which can be
+  a full reading interval (plus an NFC poll) out of date.
+*/
+
+#ifndef WEIGHT_HISTORY_H
+#define WEIGHT_HISTORY_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// History Configuration
+// ============================================================================
+#define WEIGHT_HISTORY_SIZE 128        // ~100 s at the 800 ms reading interval
+#define WEIGHT_MOTION_THRESHOLD 60     // grams of change that count as motion
+
+struct WeightSample {
+  unsigned long timestamp;             // Midpoint of the HX711 conversion window
+  int weight_g;
+  int bottles;
+};
+
+void weightHistoryAdd(unsigned long timestamp, int weight_g, int bottles);
+
+// Stable weight at time t: the sample in force at t, carried forward to just
+// before the first motion after t. Returns false if t predates the history.
+bool weightHistoryStableAt(unsigned long t, WeightSample* sample);
+
+// True once a sample taken after t has been recorded
+bool weightHistoryHasSampleAfter(unsigned long t);
+
+// Drops every sample; used when the scale is re-zeroed or its unit weight
+// changes, since older samples no longer compare with new ones
+void weightHistoryClear();
+
+#endif // WEIGHT_HISTORY_H
@@ -0,0 +1,97 @@
+/*
+ * Device clock - SNTP anchor, drift estimate and boot counter
+ * The clock is an anchor pair (millis(), Unix ms) taken at the last SNTP
+ * sync. Converting through the anchor instead of reading the system time
+ * keeps every record from one boot on the same timeline, including stamps
+ * taken before a re-sync.
+ */
+
+#include "device_clock.h"
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
+
+static SemaphoreHandle_t clock_mutex = NULL;  // Sync callback (lwIP task) vs. readers
+static bool anchored = false;
+static uint32_t anchor_millis = 0;
+static uint64_t anchor_epoch_ms = 0;
+static uint32_t sync_count = 0;
+static int32_t drift_ppm = 0;
+static uint32_t boot_count = 0;
+
+// Runs on the lwIP task after SNTP has set the system time
+static void onTimeSync(struct timeval* tv) {
+  uint32_t now = millis();
+  uint64_t epoch_ms = (uint64_t)tv->tv_sec * 1000ULL + (uint64_t)(tv->tv_usec / 1000);
+
+  xSemaphoreTake(clock_mutex, portMAX_DELAY);
+  if (anchored) {
+    // How far the millis() prediction was off over the span since the last sync
+    uint32_t span = now - anchor_millis;
+    int64_t error = (int64_t)(epoch_ms - anchor_epoch_ms) - (int64_t)span;
+    if (span >= DEVICE_CLOCK_DRIFT_MIN_SPAN) {
+      drift_ppm = (int32_t)(error * 1000000LL / (int64_t)span);
+    }
+  }
+  anchor_millis = now;
+  anchor_epoch_ms = epoch_ms;
+  anchored = true;
+  sync_count++;
+  xSemaphoreGive(clock_mutex);
+}
+
+void deviceClockBegin() {
+  if (clock_mutex != NULL) {
+    return;
+  }
+  clock_mutex = xSemaphoreCreateMutex();
+
+  Preferences clock_preferences;
+  clock_preferences.begin("clock", false);
+  boot_count = clock_preferences.getUInt("boot", 0) + 1;
+  clock_preferences.putUInt("boot", boot_count);
+  clock_preferences.end();
+
+  sntp_set_time_sync_notification_cb(onTimeSync);
+  sntp_set_sync_interval(DEVICE_CLOCK_SYNC_INTERVAL);
+  configTime(0, 0, DEVICE_CLOCK_NTP_SERVER_1, DEVICE_CLOCK_NTP_SERVER_2);
+  Serial.printf("🕒 Boot #%lu - SNTP started (%s)\n", (unsigned long)boot_count,
+                DEVICE_CLOCK_NTP_SERVER_1);
+}
+
+uint64_t deviceClockEpochMs(uint32_t at_millis) {
+  if (clock_mutex == NULL) {
+    return 0;
+  }
+  xSemaphoreTake(clock_mutex, portMAX_DELAY);
+  uint64_t epoch_ms = anchored ? anchor_epoch_ms + (int64_t)(int32_t)(at_millis - anchor_millis) : 0;
+  xSemaphoreGive(clock_mutex);
+  return epoch_ms;
+}
+
+uint64_t deviceClockNowMs() {
+  return deviceClockEpochMs(millis());
+}
+
+uint32_t deviceClockBootCount() {
+  return boot_count;
+}
+
+DeviceClockStatus deviceClockStatus() {
+  DeviceClockStatus status;
+  memset(&status, 0, sizeof(status));
+  status.sync_age_ms = DEVICE_CLOCK_NEVER;
+  status.boot_count = boot_count;
+  if (clock_mutex == NULL) {
+    return status;
+  }
+  xSemaphoreTake(clock_mutex, portMAX_DELAY);
+  status.synced = anchored;
+  status.syncs = sync_count;
+  status.drift_ppm = drift_ppm;
+  if (anchored) {
+    status.sync_age_ms = millis() - anchor_millis;
+  }
+  xSemaphoreGive(clock_mutex);
+  return status;
+}
@@ -0,0 +1,53 @@
+/*
+  device_clock.h - Wall-clock time and boot numbering for published records
+  millis() restarts at every boot and differs between pallets, so records
+  stamped with it cannot be ordered or joined across devices. This keeps an
+  SNTP-disciplined mapping from millis() to Unix time in milliseconds, plus
+  a boot counter persisted in NVS, so every record can carry:
+
+    epoch_ms   Unix time in ms (0 until the first SNTP sync this boot)
+    boot       boot counter, incremented once per power-up
+    sequence   per-boot, per-stream counter kept by the publisher
+
+  (boot, sequence) orders records from one device even without a clock and
+  a gap in sequence means a lost record. epoch_ms merges streams from many
+  devices.
+
+  SNTP runs in the background on the lwIP task and re-syncs every
+  DEVICE_CLOCK_SYNC_INTERVAL. At each sync the clock compares the server
+  time with its own prediction to estimate how fast millis() drifts.
+*/
+
+#ifndef DEVICE_CLOCK_H
+#define DEVICE_CLOCK_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Clock Configuration
+// ============================================================================
+#define DEVICE_CLOCK_NTP_SERVER_1 "pool.ntp.org"
+#define DEVICE_CLOCK_NTP_SERVER_2 "time.google.com"
+#define DEVICE_CLOCK_SYNC_INTERVAL 3600000UL   // SNTP re-sync period, ms
+#define DEVICE_CLOCK_DRIFT_MIN_SPAN 600000UL   // Shortest sync-to-sync span used for a drift estimate
+#define DEVICE_CLOCK_NEVER 0xFFFFFFFFUL        // Sync age before the first sync
+
+struct DeviceClockStatus {
+  bool synced;                         // At least one SNTP sync this boot
+  uint32_t syncs;                      // SNTP syncs this boot
+  uint32_t sync_age_ms;                // Since the last sync, DEVICE_CLOCK_NEVER before the first
+  int32_t drift_ppm;                   // millis() vs. server time, positive = millis() slow
+  uint32_t boot_count;
+};
+
+// Increments the boot counter and starts SNTP (UTC); call once WiFi is up
+void deviceClockBegin();
+
+// Unix time in ms of a millis() value from this boot; 0 before the first sync
+uint64_t deviceClockEpochMs(uint32_t at_millis);
+uint64_t deviceClockNowMs();
+
+uint32_t deviceClockBootCount();
+DeviceClockStatus deviceClockStatus();
+
+#endif // DEVICE_CLOCK_H
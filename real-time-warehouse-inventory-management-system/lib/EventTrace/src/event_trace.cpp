@@ -0,0 +1,207 @@
+/*
+ * Event trace - fixed ring of 8-byte begin/end events
+ * Events come from tasks on both cores and the WiFi event task, so each
+ * write goes through a spinlock; the timestamp is taken under it, which
+ * keeps the ring in time order.
+ */
+
+#include "event_trace.h"
+
+#if EVENT_TRACE
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <string.h>
+
+struct TraceEvent {
+  uint32_t time_us;
+  uint8_t name;
+  char phase;
+  uint8_t task;
+  uint8_t core;
+};
+
+struct TraceTask {
+  TaskHandle_t handle;
+  char name[EVENT_TRACE_TASK_NAME];        // Copied: the task may be gone by the dump
+};
+
+#ifdef BOARD_HAS_PSRAM
+static TraceEvent* ring = NULL;            // PSRAM, or internal RAM without it
+#else
+static TraceEvent ring_events[EVENT_TRACE_EVENTS];
+static TraceEvent* ring = NULL;
+#endif
+static uint32_t capacity = 0;
+static uint32_t head = 0;                  // Next slot written
+static uint32_t recorded = 0;
+static uint32_t overwritten = 0;
+static uint32_t missed = 0;                // Recorded while a dump was running
+static bool dumping = false;
+
+static const char* names[EVENT_TRACE_MAX_NAMES];
+static uint8_t name_count = 0;
+static TraceTask tasks[EVENT_TRACE_MAX_TASKS];
+static uint8_t task_count = 0;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void eventTraceBegin() {
+  if (ring != NULL) {
+    return;
+  }
+  TraceEvent* events = NULL;
+  uint32_t size = 0;
+#ifdef BOARD_HAS_PSRAM
+  if (psramFound()) {
+    events = (TraceEvent*)ps_malloc(EVENT_TRACE_PSRAM_EVENTS * sizeof(TraceEvent));
+    size = EVENT_TRACE_PSRAM_EVENTS;
+  }
+  if (events == NULL) {
+    events = (TraceEvent*)malloc(EVENT_TRACE_EVENTS * sizeof(TraceEvent));
+    size = EVENT_TRACE_EVENTS;
+  }
+  if (events == NULL) {
+    Serial.println("❌ Event trace: no memory for the ring");
+    return;
+  }
+#else
+  events = ring_events;
+  size = EVENT_TRACE_EVENTS;
+#endif
+
+  portENTER_CRITICAL(&trace_lock);
+  capacity = size;
+  head = 0;
+  recorded = 0;
+  overwritten = 0;
+  missed = 0;
+  ring = events;
+  portEXIT_CRITICAL(&trace_lock);
+  Serial.printf("🧵 Event trace: %lu events (%lu KB)\n", (unsigned long)size,
+                (unsigned long)(size * sizeof(TraceEvent) / 1024));
+}
+
+uint8_t eventTraceRegister(const char* name) {
+  uint8_t id = EVENT_TRACE_NONE;
+  portENTER_CRITICAL(&trace_lock);
+  for (uint8_t i = 0; i < name_count; i++) {
+    if (strcmp(names[i], name) == 0) {
+      id = i;
+      break;
+    }
+  }
+  if (id == EVENT_TRACE_NONE && name_count < EVENT_TRACE_MAX_NAMES) {
+    names[name_count] = name;
+    id = name_count++;
+  }
+  portEXIT_CRITICAL(&trace_lock);
+  return id;
+}
+
+// Under trace_lock; a task first seen after the table fills shares the
+// last id
+static uint8_t taskId(TaskHandle_t handle) {
+  for (uint8_t i = 0; i < task_count; i++) {
+    if (tasks[i].handle == handle) {
+      return i;
+    }
+  }
+  if (task_count == EVENT_TRACE_MAX_TASKS) {
+    return EVENT_TRACE_MAX_TASKS - 1;
+  }
+  TraceTask* task = &tasks[task_count];
+  task->handle = handle;
+  strncpy(task->name, pcTaskGetName(handle), EVENT_TRACE_TASK_NAME - 1);
+  task->name[EVENT_TRACE_TASK_NAME - 1] = '\0';
+  return task_count++;
+}
+
+void eventTraceRecord(uint8_t name, char phase) {
+  if (name >= EVENT_TRACE_MAX_NAMES) {
+    return;
+  }
+  TaskHandle_t handle = xTaskGetCurrentTaskHandle();
+  uint8_t core = (uint8_t)xPortGetCoreID();
+
+  portENTER_CRITICAL(&trace_lock);
+  if (ring == NULL || dumping) {
+    if (dumping) {
+      missed++;
+    }
+    portEXIT_CRITICAL(&trace_lock);
+    return;
+  }
+  TraceEvent* event = &ring[head];
+  event->time_us = micros();
+  event->name = name;
+  event->phase = phase;
+  event->task = taskId(handle);
+  event->core = core;
+  head = head + 1 == capacity ? 0 : head + 1;
+  if (recorded >= capacity) {
+    overwritten++;
+  }
+  recorded++;
+  portEXIT_CRITICAL(&trace_lock);
+}
+
+uint32_t eventTraceCapacity() {
+  return capacity;
+}
+
+uint32_t eventTraceDump(EventTraceWriter writer, void* context, uint32_t max_events) {
+  if (ring == NULL) {
+    return 0;
+  }
+  portENTER_CRITICAL(&trace_lock);
+  dumping = true;
+  uint32_t end = head;
+  uint32_t total = recorded;
+  uint32_t lost = overwritten;
+  uint32_t lost_dumping = missed;
+  uint8_t task_total = task_count;
+  uint8_t name_total = name_count;
+  portEXIT_CRITICAL(&trace_lock);
+
+  uint32_t available = total < capacity ? total : capacity;
+  uint32_t count = (max_events == 0 || max_events > available) ? available : max_events;
+  char line[EVENT_TRACE_LINE_SIZE];
+  uint32_t written = 0;
+
+  snprintf(line, sizeof(line), "TR,H,%lu,%lu,%lu,%lu,%lu", (unsigned long)capacity,
+           (unsigned long)total, (unsigned long)lost, (unsigned long)lost_dumping,
+           (unsigned long)micros());
+  bool ok = writer(line, context);
+  for (uint8_t i = 0; ok && i < name_total; i++) {
+    snprintf(line, sizeof(line), "TR,N,%u,%s", i, names[i]);
+    ok = writer(line, context);
+  }
+  for (uint8_t i = 0; ok && i < task_total; i++) {
+    snprintf(line, sizeof(line), "TR,T,%u,%s", i, tasks[i].name);
+    ok = writer(line, context);
+  }
+
+  // The ring is not written while dumping, so no lock is needed to read it
+  uint32_t index = (end + capacity - count) % capacity;
+  while (ok && written < count) {
+    const TraceEvent* event = &ring[index];
+    snprintf(line, sizeof(line), "TR,E,%lu,%c,%u,%u,%u", (unsigned long)event->time_us,
+             event->phase, event->name, event->task, event->core);
+    ok = writer(line, context);
+    if (ok) {
+      written++;
+    }
+    index = index + 1 == capacity ? 0 : index + 1;
+  }
+  if (ok) {
+    writer("TR,Z", context);
+  }
+
+  portENTER_CRITICAL(&trace_lock);
+  dumping = false;
+  portEXIT_CRITICAL(&trace_lock);
+  return written;
+}
+
+#endif // EVENT_TRACE
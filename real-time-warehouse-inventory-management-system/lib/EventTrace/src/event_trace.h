@@ -0,0 +1,107 @@
+/*
+  event_trace.h - Begin/end event ring for timeline traces
+  TRACE_SCOPE("name") at the top of a block records a begin event there and
+  an end event when the block exits; TRACE_INSTANT("name") records a single
+  point in time (a WiFi drop, say). Each event carries its micros()
+  timestamp, the FreeRTOS task and the core, so a dump shows which task ran
+  what, and for how long, around a missed tap or a stalled reading. Names
+  register on first use, as with stage_timer.h.
+
+  Tracing is compiled in only with -DEVENT_TRACE=1. Without it the macros
+  expand to nothing and this library adds no code or RAM.
+
+  Events are 8 bytes. The ring lives in PSRAM when the board has it
+  (BOARD_HAS_PSRAM and psramFound()): EVENT_TRACE_PSRAM_EVENTS, several
+  minutes of a busy pallet. Otherwise it holds EVENT_TRACE_EVENTS in
+  internal RAM, a few seconds. The oldest events are overwritten; nothing
+  is allocated after eventTraceBegin().
+
+  eventTraceDump() stops recording, hands the newest events to a writer
+  one text line at a time, and resumes. Events from other tasks during the
+  dump are counted as missed, not recorded. The lines are:
+
+    TR,H,<capacity>,<recorded>,<overwritten>,<missed>,<now_us>
+    TR,N,<name id>,<name>
+    TR,T,<task id>,<task name>
+    TR,E,<time_us>,<B|E|i>,<name id>,<task id>,<core>
+    TR,Z
+
+  Any other text between them (serial logs) is ignored by
+  tools/trace_to_chrome, which turns a dump into Chrome/Perfetto trace JSON.
+  micros() wraps every 71 minutes; the converter unwraps it.
+*/
+
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <Arduino.h>
+
+#ifndef EVENT_TRACE
+#define EVENT_TRACE 0
+#endif
+
+#if EVENT_TRACE
+
+// ============================================================================
+// Trace Configuration
+// ============================================================================
+#define EVENT_TRACE_EVENTS 1024            // Internal RAM ring (8 KB)
+#define EVENT_TRACE_PSRAM_EVENTS 65536     // PSRAM ring (512 KB)
+#define EVENT_TRACE_MAX_NAMES 16
+#define EVENT_TRACE_MAX_TASKS 12
+#define EVENT_TRACE_TASK_NAME 16           // Including the terminator
+#define EVENT_TRACE_LINE_SIZE 72           // Longest dump line (the header) with its terminator
+#define EVENT_TRACE_NONE 0xFF              // No free name: the site is not traced
+
+#define EVENT_TRACE_BEGIN 'B'
+#define EVENT_TRACE_END 'E'
+#define EVENT_TRACE_INSTANT 'i'
+
+// Called once per dump line, without a newline; returning false ends the
+// dump early
+typedef bool (*EventTraceWriter)(const char* line, void* context);
+
+// Sets up the ring; events recorded before it are dropped
+void eventTraceBegin();
+
+// Name id, registering it on first use; EVENT_TRACE_NONE once
+// EVENT_TRACE_MAX_NAMES names are taken
+uint8_t eventTraceRegister(const char* name);
+
+void eventTraceRecord(uint8_t name, char phase);
+
+// Events the ring holds
+uint32_t eventTraceCapacity();
+
+// Writes the newest max_events events (0 for the whole ring) with the
+// name and task tables. Returns the number of events written.
+uint32_t eventTraceDump(EventTraceWriter writer, void* context, uint32_t max_events);
+
+class TraceScope {
+ public:
+  explicit TraceScope(uint8_t name) : name_(name) { eventTraceRecord(name_, EVENT_TRACE_BEGIN); }
+  ~TraceScope() { eventTraceRecord(name_, EVENT_TRACE_END); }
+
+ private:
+  uint8_t name_;
+};
+
+#define EVENT_TRACE_JOIN2(a, b) a##b
+#define EVENT_TRACE_JOIN(a, b) EVENT_TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name)                                                                   \
+  static const uint8_t EVENT_TRACE_JOIN(event_trace_id_, __LINE__) = eventTraceRegister(name); \
+  TraceScope EVENT_TRACE_JOIN(event_trace_scope_, __LINE__)(EVENT_TRACE_JOIN(event_trace_id_, __LINE__))
+#define TRACE_INSTANT(name)                                                                 \
+  do {                                                                                      \
+    static const uint8_t event_trace_id = eventTraceRegister(name);                        \
+    eventTraceRecord(event_trace_id, EVENT_TRACE_INSTANT);                                  \
+  } while (0)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+
+#endif // EVENT_TRACE
+
+#endif // EVENT_TRACE_H
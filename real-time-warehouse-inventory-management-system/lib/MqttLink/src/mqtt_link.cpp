@@ -0,0 +1,278 @@
+/*
+ * MQTT network task and bounded outbox
+ * Producers only ever hold the outbox mutex for a memcpy; the network task
+ * copies the oldest message out before publishing, so a slow socket never
+ * holds the lock.
+ */
+
+#include "mqtt_link.h"
+#include "stage_timer.h"
+#include "event_trace.h"
+#include <WiFi.h>
+#include <stddef.h>
+
+#define MQTT_PACKET_OVERHEAD 7             // Fixed header (up to 5) + topic length (2)
+
+struct OutboxSlot {
+  uint32_t id;
+  const char* topic;
+  uint16_t length;
+  uint8_t message_class;
+  bool retained;
+  bool in_use;
+  uint8_t payload[MQTT_OUTBOX_MAX_PAYLOAD];
+};
+
+static MqttLinkConfig link_config;
+static WiFiClient link_socket;
+static PubSubClient link_client(link_socket);
+static TaskHandle_t link_task = NULL;
+static SemaphoreHandle_t outbox_mutex = NULL;  // Outbox and stats: producers vs. the network task
+static volatile bool link_connected = false;
+static size_t packet_limit = 0;
+
+static OutboxSlot slots[MQTT_OUTBOX_SLOTS];
+static uint8_t order[MQTT_OUTBOX_SLOTS];   // Slot numbers, oldest first
+static uint16_t depth = 0;
+static uint32_t next_id = 1;
+static MqttLinkStats stats;
+
+static void removeAt(uint16_t position) {
+  slots[order[position]].in_use = false;
+  for (uint16_t i = position; i + 1 < depth; i++) {
+    order[i] = order[i + 1];
+  }
+  depth--;
+}
+
+bool mqttLinkPublish(const char* topic, const uint8_t* payload, size_t length,
+                     MqttMessageClass message_class, bool retained) {
+  if (outbox_mutex == NULL) {
+    return false;
+  }
+
+  xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+  if (topic == NULL || length > MQTT_OUTBOX_MAX_PAYLOAD ||
+      strlen(topic) + length + MQTT_PACKET_OVERHEAD > packet_limit) {
+    stats.rejected++;
+    xSemaphoreGive(outbox_mutex);
+    return false;
+  }
+
+  if (depth == MQTT_OUTBOX_SLOTS) {
+    // Full: make room by overwriting the oldest telemetry, never a transaction
+    uint16_t victim = 0;
+    while (victim < depth && slots[order[victim]].message_class != MQTT_TELEMETRY) {
+      victim++;
+    }
+    if (victim == depth) {
+      stats.rejected++;
+      xSemaphoreGive(outbox_mutex);
+      return false;
+    }
+    removeAt(victim);
+    stats.overwritten++;
+  }
+
+  uint8_t slot = 0;
+  while (slots[slot].in_use) {
+    slot++;
+  }
+  slots[slot].id = next_id++;
+  slots[slot].topic = topic;
+  slots[slot].length = (uint16_t)length;
+  slots[slot].message_class = (uint8_t)message_class;
+  slots[slot].retained = retained;
+  slots[slot].in_use = true;
+  memcpy(slots[slot].payload, payload, length);
+  order[depth++] = slot;
+
+  stats.queued++;
+  if (depth > stats.high_water) {
+    stats.high_water = depth;
+  }
+  xSemaphoreGive(outbox_mutex);
+  return true;
+}
+
+bool mqttLinkPublish(const char* topic, const char* text,
+                     MqttMessageClass message_class, bool retained) {
+  return mqttLinkPublish(topic, (const uint8_t*)text, strlen(text), message_class, retained);
+}
+
+bool mqttLinkPublishNow(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+  return link_client.publish(topic, payload, length, retained);
+}
+
+bool mqttLinkConnected() {
+  return link_connected;
+}
+
+MqttLinkStats mqttLinkStats() {
+  MqttLinkStats copy;
+  if (outbox_mutex == NULL) {
+    memset(&copy, 0, sizeof(copy));
+    return copy;
+  }
+  xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+  copy = stats;
+  copy.depth = depth;
+  xSemaphoreGive(outbox_mutex);
+  return copy;
+}
+
+uint16_t mqttLinkDepth() {
+  if (outbox_mutex == NULL) {
+    return 0;
+  }
+  xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+  uint16_t waiting = depth;
+  xSemaphoreGive(outbox_mutex);
+  return waiting;
+}
+
+// Broker (re)connection; the only place that blocks on the network.
+// WiFi itself is reconnected by wifi_link.h.
+static void serviceConnection() {
+  static unsigned long last_attempt = 0;
+  static unsigned long retry_delay = 0;
+  unsigned long now = millis();
+
+  if (WiFi.status() != WL_CONNECTED) {
+    link_connected = false;
+    return;
+  }
+
+  if (link_client.connected()) {
+    return;
+  }
+  if (link_connected) {
+    Serial.println("📴 MQTT connection lost");
+    link_connected = false;
+    retry_delay = 0;
+  }
+  if (now - last_attempt < retry_delay) {
+    return;
+  }
+  last_attempt = now;
+
+  bool has_login = link_config.username != NULL && link_config.username[0] != '\0';
+  bool connected = has_login
+      ? link_client.connect(link_config.client_id, link_config.username, link_config.password)
+      : link_client.connect(link_config.client_id);
+  if (!connected) {
+    xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+    stats.connect_failures++;
+    xSemaphoreGive(outbox_mutex);
+    retry_delay = retry_delay == 0 ? MQTT_LINK_RETRY_MIN : retry_delay * 2;
+    if (retry_delay > MQTT_LINK_RETRY_MAX) {
+      retry_delay = MQTT_LINK_RETRY_MAX;
+    }
+    Serial.printf("❌ MQTT connect failed (rc=%d) - retrying in %lu ms\n",
+                  link_client.state(), retry_delay);
+    return;
+  }
+
+  for (uint8_t i = 0; i < link_config.subscription_count; i++) {
+    link_client.subscribe(link_config.subscriptions[i]);
+  }
+  xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+  stats.connects++;
+  xSemaphoreGive(outbox_mutex);
+  retry_delay = 0;
+  link_connected = true;
+  Serial.printf("✅ Connected to MQTT broker %s as %s\n", link_config.host, link_config.client_id);
+  if (link_config.on_connect != NULL) {
+    link_config.on_connect();
+  }
+}
+
+// Sends the oldest messages in order; a failed publish stays queued for the
+// next connection
+static void sendOutbox() {
+  static OutboxSlot sending;
+
+  for (int sent = 0; sent < MQTT_LINK_SEND_BATCH; sent++) {
+    xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+    if (depth == 0) {
+      xSemaphoreGive(outbox_mutex);
+      return;
+    }
+    const OutboxSlot* head = &slots[order[0]];
+    memcpy(&sending, head, offsetof(OutboxSlot, payload) + head->length);
+    xSemaphoreGive(outbox_mutex);
+
+    bool ok;
+    {
+      STAGE_TIMER("mqtt_publish");
+      TRACE_SCOPE("mqtt_publish");
+      ok = link_client.publish(sending.topic, sending.payload, sending.length, sending.retained);
+    }
+
+    xSemaphoreTake(outbox_mutex, portMAX_DELAY);
+    if (ok) {
+      // Unless a newer message already overwrote it while it was being sent
+      if (depth > 0 && slots[order[0]].id == sending.id) {
+        removeAt(0);
+      }
+      stats.sent++;
+    } else {
+      stats.failed++;
+    }
+    xSemaphoreGive(outbox_mutex);
+
+    if (!ok) {
+      return;
+    }
+  }
+}
+
+static void networkTask(void* parameter) {
+  for (;;) {
+    serviceConnection();
+
+    if (link_connected) {
+      {
+        STAGE_TIMER("mqtt_loop");
+        link_client.loop();
+      }
+      sendOutbox();
+      if (depth == 0 && link_config.on_idle != NULL) {
+        link_config.on_idle();
+      }
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+bool mqttLinkBegin(const MqttLinkConfig* config) {
+  if (link_task != NULL) {
+    return true;
+  }
+
+  link_config = *config;
+  memset(&stats, 0, sizeof(stats));
+  outbox_mutex = xSemaphoreCreateMutex();
+  if (outbox_mutex == NULL) {
+    return false;
+  }
+
+  link_client.setServer(link_config.host, link_config.port);
+  link_client.setSocketTimeout(MQTT_LINK_SOCKET_TIMEOUT);
+  if (link_config.on_message != NULL) {
+    link_client.setCallback(link_config.on_message);
+  }
+  if (link_config.buffer_size > 0) {
+    link_client.setBufferSize(link_config.buffer_size);
+  }
+  packet_limit = link_client.getBufferSize();
+
+  if (xTaskCreatePinnedToCore(networkTask, "mqtt_link", MQTT_LINK_STACK_SIZE, NULL,
+                              MQTT_LINK_PRIORITY, &link_task, MQTT_LINK_CORE) != pdPASS) {
+    link_task = NULL;
+    Serial.println("❌ Could not start the MQTT network task");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,93 @@
+/*
+  mqtt_link.h - MQTT client on its own FreeRTOS task
+  All WiFiClient/PubSubClient work (connecting, keep-alive, receiving and
+  publishing) happens on a network task pinned to the WiFi core. Everything
+  else hands messages over through a bounded outbox and never waits on TCP:
+  a broker that takes the full socket timeout to refuse a connection stalls
+  only the network task, not sampling, NFC or the display.
+
+  The outbox has MQTT_OUTBOX_SLOTS fixed slots with an overflow policy per
+  message class:
+    MQTT_TELEMETRY    - a full outbox overwrites its oldest telemetry message;
+                        only the newest state matters
+    MQTT_TRANSACTION  - never overwritten; mqttLinkPublish() returns false
+                        instead so the caller keeps it (e.g. in flash)
+
+  Topics are stored by pointer and must outlive the message (string
+  literals or globals). The message, connect and idle callbacks run on the
+  network task and may call mqttLinkPublishNow() to publish synchronously.
+
+  The link waits for WiFi but never reconnects it; that belongs to
+  wifi_link.h, which backs off between attempts.
+*/
+
+#ifndef MQTT_LINK_H
+#define MQTT_LINK_H
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+// ============================================================================
+// Link Configuration
+// ============================================================================
+#define MQTT_OUTBOX_SLOTS 16
+#define MQTT_OUTBOX_MAX_PAYLOAD 448        // Largest message (a full sample window)
+#define MQTT_LINK_STACK_SIZE 6144
+#define MQTT_LINK_PRIORITY 1
+#define MQTT_LINK_CORE 0                   // WiFi stack core; the application tasks run on core 1
+#define MQTT_LINK_SEND_BATCH 8             // Outbox messages sent per pass
+#define MQTT_LINK_RETRY_MIN 1000           // Reconnect backoff, doubling up to the max
+#define MQTT_LINK_RETRY_MAX 30000
+#define MQTT_LINK_SOCKET_TIMEOUT 5         // Seconds; only the network task waits on it
+
+enum MqttMessageClass {
+  MQTT_TELEMETRY = 0,
+  MQTT_TRANSACTION = 1
+};
+
+struct MqttLinkConfig {
+  const char* host;
+  uint16_t port;
+  const char* client_id;
+  const char* username;                  // NULL or "" for an anonymous broker
+  const char* password;
+  const char* const* subscriptions;      // Re-subscribed after every connect
+  uint8_t subscription_count;
+  uint16_t buffer_size;                  // PubSubClient packet buffer, 0 keeps the default
+  void (*on_message)(char* topic, uint8_t* payload, unsigned int length);
+  void (*on_connect)();                  // After connecting and subscribing
+  void (*on_idle)();                     // While connected with an empty outbox
+};
+
+struct MqttLinkStats {
+  uint32_t queued;                       // Accepted into the outbox
+  uint32_t sent;
+  uint32_t overwritten;                  // Telemetry replaced by newer telemetry
+  uint32_t rejected;                     // Refused: outbox full of transactions, or too large
+  uint32_t failed;                       // Publish attempts that failed; the message stays queued
+  uint32_t connects;
+  uint32_t connect_failures;
+  uint16_t depth;                        // Messages waiting now
+  uint16_t high_water;                   // Deepest the outbox has been
+};
+
+// Copies the configuration and starts the network task
+bool mqttLinkBegin(const MqttLinkConfig* config);
+
+// Queues a message for the network task; false if it was not accepted
+bool mqttLinkPublish(const char* topic, const uint8_t* payload, size_t length,
+                     MqttMessageClass message_class, bool retained = false);
+bool mqttLinkPublish(const char* topic, const char* text,
+                     MqttMessageClass message_class, bool retained = false);
+
+// Publishes immediately; only for the callbacks above (network task)
+bool mqttLinkPublishNow(const char* topic, const uint8_t* payload, size_t length,
+                        bool retained = false);
+
+bool mqttLinkConnected();
+
+// Both take the outbox lock, so any task may call them
+MqttLinkStats mqttLinkStats();
+uint16_t mqttLinkDepth();                // Messages waiting now, for flow control
+
+#endif // MQTT_LINK_H
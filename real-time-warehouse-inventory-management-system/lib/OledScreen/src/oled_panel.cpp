@@ -0,0 +1,118 @@
+/*
+ * SSD1306 dirty-run flush - framebuffer diffed against the panel's copy
+ */
+
+#include "oled_panel.h"
+#include "event_trace.h"
+#include <string.h>
+
+#define SSD1306_CONTROL_COMMAND 0x00
+#define SSD1306_CONTROL_DATA 0x40
+
+static Adafruit_SSD1306* panel = NULL;
+static TwoWire* panel_wire = NULL;
+static uint8_t panel_address = 0;
+static int16_t panel_width = 0;
+static uint8_t panel_pages = 0;
+static bool panel_unknown = true;          // Controller RAM not known: send everything
+static uint8_t shown[OLED_PANEL_MAX_BYTES];
+static OledPanelStats stats;
+
+// Window covering columns first..last of one page
+static void setWindow(uint8_t page, uint8_t first, uint8_t last) {
+  panel_wire->beginTransmission(panel_address);
+  panel_wire->write(SSD1306_CONTROL_COMMAND);
+  panel_wire->write(SSD1306_COLUMNADDR);
+  panel_wire->write(first);
+  panel_wire->write(last);
+  panel_wire->write(SSD1306_PAGEADDR);
+  panel_wire->write(page);
+  panel_wire->write(page);
+  panel_wire->endTransmission();
+}
+
+static void sendRun(uint8_t page, int16_t first, int16_t last, const uint8_t* row) {
+  setWindow(page, (uint8_t)first, (uint8_t)last);
+  for (int16_t column = first; column <= last; column += OLED_PANEL_CHUNK) {
+    int16_t length = last - column + 1 < OLED_PANEL_CHUNK ? last - column + 1 : OLED_PANEL_CHUNK;
+    panel_wire->beginTransmission(panel_address);
+    panel_wire->write(SSD1306_CONTROL_DATA);
+    panel_wire->write(row + column, length);
+    panel_wire->endTransmission();
+    yield();                               // Tasks of the same priority get the core between chunks
+  }
+  stats.windows++;
+}
+
+bool oledPanelBegin(Adafruit_SSD1306* display, TwoWire* wire, uint8_t address, uint32_t clock) {
+  if (display == NULL || display->getBuffer() == NULL ||
+      (size_t)display->width() * display->height() / 8 > OLED_PANEL_MAX_BYTES) {
+    Serial.println("❌ OLED panel: no framebuffer or larger than 128x64");
+    return false;
+  }
+  panel = display;
+  panel_wire = wire;
+  panel_address = address;
+  panel_width = display->width();
+  panel_pages = (uint8_t)(display->height() / 8);
+  wire->setClock(clock);
+  memset(&stats, 0, sizeof(stats));
+  oledPanelInvalidate();
+  Serial.printf("🖥️ OLED panel: %dx%d at %lu kHz, dirty runs only\n", panel_width, panel_pages * 8,
+                (unsigned long)(clock / 1000));
+  return true;
+}
+
+void oledPanelInvalidate() {
+  panel_unknown = true;
+}
+
+uint16_t oledPanelFlush() {
+  if (panel == NULL) {
+    return 0;
+  }
+  TRACE_SCOPE("oled_flush");
+  unsigned long start = micros();
+  const uint8_t* buffer = panel->getBuffer();
+  uint16_t sent = 0;
+  for (uint8_t page = 0; page < panel_pages; page++) {
+    const uint8_t* row = buffer + page * panel_width;
+    uint8_t* was = shown + page * panel_width;
+    int16_t column = 0;
+    while (column < panel_width) {
+      if (!panel_unknown && row[column] == was[column]) {
+        column++;
+        continue;
+      }
+      // Extend the run until OLED_PANEL_RUN_GAP unchanged bytes in a row
+      int16_t first = column;
+      int16_t last = column;
+      for (int16_t c = column + 1; c < panel_width && c - last <= OLED_PANEL_RUN_GAP; c++) {
+        if (panel_unknown || row[c] != was[c]) {
+          last = c;
+        }
+      }
+      sendRun(page, first, last, row);
+      memcpy(was + first, row + first, last - first + 1);
+      sent += last - first + 1;
+      column = last + 1;
+    }
+  }
+  panel_unknown = false;
+
+  if (sent > 0) {
+    uint32_t elapsed = micros() - start;
+    stats.flushes++;
+    stats.bytes_sent += sent;
+    stats.last_bytes = sent;
+    stats.last_flush_us = elapsed;
+    if (elapsed > stats.max_flush_us) {
+      stats.max_flush_us = elapsed;
+    }
+  }
+  return sent;
+}
+
+OledPanelStats oledPanelStats() {
+  return stats;
+}
@@ -0,0 +1,55 @@
+/*
+  oled_panel.h - SSD1306 transfers limited to the bytes that changed
+  Adafruit_SSD1306::display() sends the whole 1 KB framebuffer on every
+  call. That is about 25 ms of I2C at 400 kHz and about 100 ms at 100 kHz,
+  even when a single digit changed.
+
+  The panel keeps a copy of what the controller's RAM holds. The SSD1306
+  stores a 128-column screen as pages of 8 pixel rows, one byte per column
+  and page. A flush compares the framebuffer with the copy page by page
+  and sends only the changed column runs. Each run goes behind a
+  column/page window command (0x21/0x22), so the controller's address
+  pointer starts at the run. Runs closer than OLED_PANEL_RUN_GAP unchanged
+  bytes are merged, since a window command costs about as many bytes.
+  Data goes out in writes of OLED_PANEL_CHUNK bytes, under 1 ms each at
+  400 kHz, with a yield after each one.
+
+  Everything drawn must go out through oledPanelFlush() rather than
+  display(), or the copy no longer matches the panel; oledPanelInvalidate()
+  makes the next flush send everything.
+*/
+
+#ifndef OLED_PANEL_H
+#define OLED_PANEL_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+
+#define OLED_PANEL_MAX_BYTES 1024          // 128x64
+#define OLED_PANEL_RUN_GAP 8               // Unchanged bytes worth sending to save a window command
+#define OLED_PANEL_CHUNK 31                // Data bytes per I2C write; fits every core's Wire buffer
+
+struct OledPanelStats {
+  uint32_t flushes;                        // Flushes that sent something
+  uint32_t bytes_sent;                     // Framebuffer bytes, without I2C overhead
+  uint32_t windows;                        // Runs sent, one window command each
+  uint32_t last_bytes;
+  uint32_t last_flush_us;                  // Bus time of the last flush that sent something
+  uint32_t max_flush_us;
+};
+
+// After display->begin(): sets the bus clock and marks the panel unknown,
+// so the first flush sends the whole framebuffer. The display should be
+// constructed with clock as both its clkDuring and clkAfter, or its own
+// commands drop the bus back to 100 kHz.
+bool oledPanelBegin(Adafruit_SSD1306* display, TwoWire* wire, uint8_t address, uint32_t clock);
+
+void oledPanelInvalidate();
+
+// Sends what changed since the last flush; returns the bytes sent
+uint16_t oledPanelFlush();
+
+OledPanelStats oledPanelStats();
+
+#endif // OLED_PANEL_H
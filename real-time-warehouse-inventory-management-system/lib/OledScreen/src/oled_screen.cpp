@@ -0,0 +1,94 @@
+/*
+ * Retained-mode OLED text - fields redrawn only when their text changes
+ */
+
+#include "oled_screen.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define OLED_CHAR_WIDTH 6
+#define OLED_CHAR_HEIGHT 8
+#define OLED_BLACK 0
+#define OLED_WHITE 1
+
+OledScreen::OledScreen(Adafruit_GFX* gfx)
+    : _gfx(gfx), _layout(NULL), _count(0), _clear(false), _dirty(0) {
+  memset(_text, 0, sizeof(_text));
+}
+
+bool OledScreen::show(const OledField* layout, uint8_t count) {
+  if (layout == _layout) {
+    return false;
+  }
+  _layout = layout;
+  _count = count > OLED_SCREEN_MAX_FIELDS ? OLED_SCREEN_MAX_FIELDS : count;
+  for (uint8_t i = 0; i < _count; i++) {
+    const OledField* field = &_layout[i];
+    uint8_t width = field->width > OLED_FIELD_MAX_CHARS ? OLED_FIELD_MAX_CHARS : field->width;
+    strncpy(_text[i], field->text != NULL ? field->text : "", width);
+    _text[i][width] = '\0';
+  }
+  invalidate();
+  return true;
+}
+
+void OledScreen::invalidate() {
+  _clear = true;
+  _dirty = (uint16_t)((1UL << _count) - 1);
+}
+
+void OledScreen::setText(uint8_t field, const char* text) {
+  if (field >= _count) {
+    return;
+  }
+  uint8_t width = _layout[field].width > OLED_FIELD_MAX_CHARS ? OLED_FIELD_MAX_CHARS : _layout[field].width;
+  char cut[OLED_FIELD_MAX_CHARS + 1];
+  strncpy(cut, text, width);
+  cut[width] = '\0';
+  if (strcmp(cut, _text[field]) == 0) {
+    return;
+  }
+  memcpy(_text[field], cut, sizeof(cut));
+  _dirty |= (uint16_t)(1U << field);
+}
+
+void OledScreen::setInt(uint8_t field, long value) {
+  char text[12];
+  snprintf(text, sizeof(text), "%ld", value);
+  setText(field, text);
+}
+
+void OledScreen::printf(uint8_t field, const char* format, ...) {
+  char text[OLED_FIELD_MAX_CHARS + 1];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  setText(field, text);
+}
+
+bool OledScreen::render() {
+  if (_dirty == 0 && !_clear) {
+    return false;
+  }
+  if (_clear) {
+    _gfx->fillScreen(OLED_BLACK);
+    _clear = false;
+  }
+  _gfx->setTextWrap(false);
+  _gfx->setTextColor(OLED_WHITE);
+  for (uint8_t i = 0; i < _count; i++) {
+    if ((_dirty & (1U << i)) == 0) {
+      continue;
+    }
+    const OledField* field = &_layout[i];
+    _gfx->fillRect(field->x, field->y, field->width * OLED_CHAR_WIDTH * field->size,
+                   OLED_CHAR_HEIGHT * field->size, OLED_BLACK);
+    _gfx->setTextSize(field->size);
+    _gfx->setCursor(field->x, field->y);
+    _gfx->print(_text[i]);
+  }
+  _dirty = 0;
+  return true;
+}
@@ -0,0 +1,74 @@
+/*
+  oled_screen.h - Retained-mode text screens for the OLED
+  A screen is a constexpr layout of text fields, each with a position, a
+  text size and a fixed number of characters. Fields with text in the
+  layout are labels and are drawn once, when the screen is shown. Value
+  fields are set at run time. A field whose text did not change is not
+  redrawn. render() draws only the fields that changed into the
+  framebuffer, erasing each field's box first, so the rest of the
+  framebuffer keeps what it had. oled_panel.h then sends only the changed
+  bytes to the panel.
+
+    static constexpr OledField weight_screen[] = {
+      { 0, 0, 1, 8, "Weight: " },
+      { 48, 0, 1, 13, NULL },
+    };
+    screen.show(weight_screen);          // Clears and redraws only on a screen change
+    screen.printf(1, "%d g", grams);     // Redrawn only if the text differs
+    screen.render();
+
+  Text is cut to the field's width rather than wrapped, so a long value
+  cannot spill into the next field.
+*/
+
+#ifndef OLED_SCREEN_H
+#define OLED_SCREEN_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+#define OLED_SCREEN_MAX_FIELDS 16
+#define OLED_FIELD_MAX_CHARS 21            // 128 px of 6 px characters
+
+struct OledField {
+  int16_t x;
+  int16_t y;
+  uint8_t size;                            // Text size: 6x8 px per character at 1
+  uint8_t width;                           // Characters reserved; longer text is cut
+  const char* text;                        // Label, or NULL for a value field
+};
+
+class OledScreen {
+ public:
+  explicit OledScreen(Adafruit_GFX* gfx);
+
+  // Switches to layout, clearing the framebuffer and marking every field
+  // dirty, unless layout is already showing. Returns true if it switched,
+  // so the caller can add lines or other fixed graphics.
+  template <size_t N>
+  bool show(const OledField (&layout)[N]) {
+    static_assert(N <= OLED_SCREEN_MAX_FIELDS, "Raise OLED_SCREEN_MAX_FIELDS");
+    return show(layout, N);
+  }
+  bool show(const OledField* layout, uint8_t count);
+
+  // Forces a full redraw of the current screen on the next render()
+  void invalidate();
+
+  void setText(uint8_t field, const char* text);
+  void setInt(uint8_t field, long value);
+  void printf(uint8_t field, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+  // Draws the fields that changed; true if anything was drawn
+  bool render();
+
+ private:
+  Adafruit_GFX* _gfx;
+  const OledField* _layout;
+  uint8_t _count;
+  bool _clear;                             // Wipe the framebuffer before the next render()
+  uint16_t _dirty;                         // One bit per field
+  char _text[OLED_SCREEN_MAX_FIELDS][OLED_FIELD_MAX_CHARS + 1];
+};
+
+#endif // OLED_SCREEN_H
@@ -0,0 +1,97 @@
+/*
+ * OLED display task - double-buffered state snapshots, drawn at up to 10 Hz
+ * The back buffer belongs to the producers and the front buffer to the
+ * task; the mutex covers only copies into and out of the back buffer.
+ */
+
+#include "oled_task.h"
+#include "oled_panel.h"
+#include "stage_timer.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <string.h>
+
+static OledScreen* task_screen = NULL;
+static OledRenderCallback render_callback = NULL;
+static size_t snapshot_size = 0;
+static TaskHandle_t display_task = NULL;
+static SemaphoreHandle_t back_mutex = NULL;
+static uint8_t back[OLED_TASK_MAX_STATE];  // Newest post
+static uint8_t front[OLED_TASK_MAX_STATE]; // Being drawn
+static bool back_fresh = false;            // back holds a post not drawn yet
+static OledTaskStats stats;
+
+static void displayTask(void* parameter) {
+  (void)parameter;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    xSemaphoreTake(back_mutex, portMAX_DELAY);
+    bool fresh = back_fresh;
+    if (fresh) {
+      memcpy(front, back, snapshot_size);
+      back_fresh = false;
+    }
+    xSemaphoreGive(back_mutex);
+    if (!fresh) {
+      continue;
+    }
+
+    unsigned long start = micros();
+    {
+      STAGE_TIMER("oled_draw");
+      render_callback(front);
+      task_screen->render();
+      oledPanelFlush();
+    }
+    uint32_t elapsed = micros() - start;
+    stats.drawn++;
+    stats.last_draw_us = elapsed;
+    if (elapsed > stats.max_draw_us) {
+      stats.max_draw_us = elapsed;
+    }
+
+    // Posts made meanwhile leave the notification pending and replace
+    // each other in the back buffer
+    vTaskDelay(pdMS_TO_TICKS(OLED_TASK_MIN_INTERVAL));
+  }
+}
+
+bool oledTaskBegin(OledScreen* screen, size_t state_size, OledRenderCallback render) {
+  if (screen == NULL || render == NULL || state_size > OLED_TASK_MAX_STATE) {
+    Serial.println("❌ OLED task: no screen or callback, or state larger than OLED_TASK_MAX_STATE");
+    return false;
+  }
+  task_screen = screen;
+  render_callback = render;
+  snapshot_size = state_size;
+  memset(&stats, 0, sizeof(stats));
+  back_mutex = xSemaphoreCreateMutex();
+  if (back_mutex == NULL) {
+    return false;
+  }
+  if (xTaskCreatePinnedToCore(displayTask, "oled", OLED_TASK_STACK_SIZE, NULL, OLED_TASK_PRIORITY,
+                              &display_task, OLED_TASK_CORE) != pdPASS) {
+    display_task = NULL;
+    Serial.println("❌ Could not start the OLED display task");
+    return false;
+  }
+  return true;
+}
+
+void oledTaskPost(const void* state) {
+  if (display_task == NULL) {
+    return;
+  }
+  xSemaphoreTake(back_mutex, portMAX_DELAY);
+  memcpy(back, state, snapshot_size);
+  back_fresh = true;
+  stats.posted++;
+  xSemaphoreGive(back_mutex);
+  xTaskNotifyGive(display_task);
+}
+
+OledTaskStats oledTaskStats() {
+  return stats;
+}
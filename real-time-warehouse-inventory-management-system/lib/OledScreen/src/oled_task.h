@@ -0,0 +1,56 @@
+/*
+  oled_task.h - OLED drawing on its own low-priority FreeRTOS task
+  The display task owns the SSD1306: the framebuffer, the screen fields and
+  the I2C transfers. Everything else only posts a snapshot of the state to
+  show, a plain struct the application defines, and returns at once.
+
+  The snapshot is double-buffered. oledTaskPost() copies it into the back
+  buffer, and the task copies the back buffer into its front buffer before
+  drawing. Both sides hold the buffer mutex only for that memcpy, so a
+  producer never waits for drawing or I2C. Posts that arrive while a frame
+  is being drawn replace each other; only the newest is drawn next.
+
+  The render callback runs on the display task. It sets the fields of the
+  OledScreen (and may draw extra graphics into the framebuffer); the task
+  then renders the changed fields and flushes the changed bytes
+  (oled_panel.h). The flush goes out in short I2C writes, so a sampling or
+  NFC task of higher priority preempts it between any two of them.
+
+  At most one frame is drawn per OLED_TASK_MIN_INTERVAL.
+*/
+
+#ifndef OLED_TASK_H
+#define OLED_TASK_H
+
+#include <Arduino.h>
+#include "oled_screen.h"
+
+// ============================================================================
+// Task Configuration
+// ============================================================================
+#define OLED_TASK_STACK_SIZE 4096
+#define OLED_TASK_PRIORITY 1               // Lowest application priority
+#define OLED_TASK_CORE 1                   // Application core; the WiFi stack has core 0
+#define OLED_TASK_MIN_INTERVAL 100         // ms between frames (10 Hz)
+#define OLED_TASK_MAX_STATE 128            // Largest snapshot struct
+
+typedef void (*OledRenderCallback)(const void* state);
+
+struct OledTaskStats {
+  uint32_t posted;
+  uint32_t drawn;                          // Posts replaced before drawing: posted - drawn
+  uint32_t last_draw_us;                   // Callback, render and flush of the last frame
+  uint32_t max_draw_us;
+};
+
+// After oledPanelBegin(): starts the task. state_size is the size of the
+// snapshot struct that oledTaskPost() will be given.
+bool oledTaskBegin(OledScreen* screen, size_t state_size, OledRenderCallback render);
+
+// Copies state for the display task; never waits on drawing or I2C.
+// Dropped if the task is not running (no display found).
+void oledTaskPost(const void* state);
+
+OledTaskStats oledTaskStats();
+
+#endif // OLED_TASK_H
@@ -0,0 +1,191 @@
+/*
+ * Fixed-layout JSON payloads - layout once, patch value slots per publish
+ */
+
+#include "json_template.h"
+
+#include <math.h>
+#include <string.h>
+
+// Writes the digits of value backwards from end; returns the start
+static char* formatUnsigned(char* end, unsigned long long value) {
+  char* p = end;
+  do {
+    *--p = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  return p;
+}
+
+// Signed integer into a scratch buffer of at least 21 chars; returns the start
+static char* formatInteger(char* scratch_end, long long value) {
+  bool negative = value < 0;
+  unsigned long long magnitude = negative ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+  char* p = formatUnsigned(scratch_end, magnitude);
+  if (negative) *--p = '-';
+  return p;
+}
+
+// Fixed-point text for value; returns the length, 0 if not finite or too wide
+static size_t formatDecimal(char* scratch, size_t size, float value, uint8_t decimals) {
+  if (isnan(value) || isinf(value) || decimals > 6) {
+    return 0;
+  }
+
+  double scale = 1.0;
+  for (uint8_t i = 0; i < decimals; i++) scale *= 10.0;
+  double scaled = (double)value * scale;
+  if (fabs(scaled) > 9.0e15) {
+    return 0;
+  }
+  long long fixed = (long long)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+
+  char digits[24];
+  char* end = digits + sizeof(digits);
+  unsigned long long magnitude = fixed < 0 ? 0ULL - (unsigned long long)fixed : (unsigned long long)fixed;
+  char* p = formatUnsigned(end, magnitude);
+  // Leading zeros so there is at least one digit before the point
+  while ((size_t)(end - p) <= decimals) *--p = '0';
+
+  size_t integer_digits = (size_t)(end - p) - decimals;
+  size_t length = (fixed < 0 ? 1 : 0) + integer_digits + (decimals > 0 ? 1 + decimals : 0);
+  if (length > size) {
+    return 0;
+  }
+
+  char* out = scratch;
+  if (fixed < 0) *out++ = '-';
+  memcpy(out, p, integer_digits);
+  out += integer_digits;
+  if (decimals > 0) {
+    *out++ = '.';
+    memcpy(out, p + integer_digits, decimals);
+  }
+  return length;
+}
+
+void JsonTemplate::layout() {
+  size_t needed = 2;
+  for (uint8_t i = 0; i < _count; i++) {
+    needed += strlen(_fields[i].key) + 3 + _fields[i].width + 1;
+  }
+  if (_size < needed || needed - 1 > 0xFFFF) {
+    if (_size > 0) _buffer[0] = '\0';
+    _count = 0;
+    return;
+  }
+
+  char* p = _buffer;
+  *p++ = '{';
+  for (uint8_t i = 0; i < _count; i++) {
+    const JsonField& field = _fields[i];
+    size_t key_length = strlen(field.key);
+    *p++ = '"';
+    memcpy(p, field.key, key_length);
+    p += key_length;
+    *p++ = '"';
+    *p++ = ':';
+    _offsets[i] = (uint16_t)(p - _buffer);
+    memset(p, ' ', field.width);
+    p += field.width;
+    *p++ = (i + 1 < _count) ? ',' : '}';
+  }
+  *p = '\0';
+  _length = (size_t)(p - _buffer);
+
+  // Every slot starts with a valid value
+  for (uint8_t i = 0; i < _count; i++) {
+    switch (_fields[i].type) {
+      case JSON_NUMBER: setInt(i, 0); break;
+      case JSON_BOOL: setBool(i, false); break;
+      case JSON_STRING: setString(i, ""); break;
+    }
+  }
+}
+
+char* JsonTemplate::slot(uint8_t field, JsonFieldType type) {
+  if (field >= _count || _fields[field].type != type) {
+    return NULL;
+  }
+  return _buffer + _offsets[field];
+}
+
+void JsonTemplate::writeNumber(uint8_t field, const char* digits, size_t length) {
+  char* p = slot(field, JSON_NUMBER);
+  if (p == NULL) return;
+
+  uint8_t width = _fields[field].width;
+  if (length == 0 || length > width) {
+    // Keeps the payload valid when the slot is too narrow for the value
+    _overflows++;
+    digits = "null";
+    length = 4;
+    if (length > width) return;
+  }
+  memset(p, ' ', width - length);
+  memcpy(p + width - length, digits, length);
+}
+
+void JsonTemplate::setInt(uint8_t field, long value) {
+  char scratch[24];
+  char* end = scratch + sizeof(scratch);
+  char* start = formatInteger(end, value);
+  writeNumber(field, start, (size_t)(end - start));
+}
+
+void JsonTemplate::setUnsigned(uint8_t field, unsigned long long value) {
+  char scratch[24];
+  char* end = scratch + sizeof(scratch);
+  char* start = formatUnsigned(end, value);
+  writeNumber(field, start, (size_t)(end - start));
+}
+
+void JsonTemplate::setFloat(uint8_t field, float value, uint8_t decimals) {
+  char scratch[32];
+  size_t length = formatDecimal(scratch, sizeof(scratch), value, decimals);
+  writeNumber(field, scratch, length);
+}
+
+void JsonTemplate::setBool(uint8_t field, bool value) {
+  char* p = slot(field, JSON_BOOL);
+  if (p == NULL) return;
+
+  uint8_t width = _fields[field].width;
+  const char* text = value ? "true" : "false";
+  size_t length = value ? 4 : 5;
+  if (length > width) {
+    _overflows++;
+    return;
+  }
+  memcpy(p, text, length);
+  memset(p + length, ' ', width - length);
+}
+
+void JsonTemplate::setString(uint8_t field, const char* value) {
+  char* p = slot(field, JSON_STRING);
+  if (p == NULL) return;
+
+  uint8_t width = _fields[field].width;
+  if (width < 2) return;
+  size_t capacity = width - 2;
+
+  size_t length = 0;
+  *p++ = '"';
+  while (value[length] != '\0' && length < capacity) {
+    char c = value[length];
+    // Characters that would need an escape sequence are replaced so the
+    // slot width stays fixed
+    p[length] = ((unsigned char)c < 0x20 || c == '"' || c == '\\') ? '?' : c;
+    length++;
+  }
+  if (value[length] != '\0') _overflows++;
+  p[length] = '"';
+  memset(p + length + 1, ' ', capacity - length);
+}
+
+size_t jsonFormatDecimal(char* out, size_t size, float value, uint8_t decimals) {
+  if (size == 0) return 0;
+  size_t length = formatDecimal(out, size - 1, value, decimals);
+  out[length] = '\0';
+  return length;
+}
@@ -0,0 +1,106 @@
+/*
+  json_template.h - Fixed-layout JSON payloads patched in place
+  A payload's keys and field widths are declared once as a constexpr schema.
+  The template lays out the JSON text once into a static buffer sized at
+  compile time, then each publish only overwrites the value slots. Numbers
+  are right-aligned and strings are left-aligned, with spaces as padding.
+  JSON allows whitespace around values, so every payload stays valid JSON
+  and has the same length. Nothing here allocates; floats are formatted
+  by hand because newlib's printf float path can allocate.
+
+    static constexpr JsonField schema[] = {
+      { "weight_g", JSON_NUMBER, JSON_INT32_WIDTH },
+      { "status",   JSON_STRING, JSON_STRING_WIDTH(9) },
+    };
+    static char buffer[JSON_TEMPLATE_SIZE(schema)];
+    JsonTemplate payload(schema, buffer, sizeof(buffer));
+
+    payload.setInt(0, weight);          // {"weight_g":      -1375,"status":"idle"     }
+    payload.setString(1, "idle");
+*/
+
+#ifndef JSON_TEMPLATE_H
+#define JSON_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Schema
+// ============================================================================
+#define JSON_TEMPLATE_MAX_FIELDS 16
+#define JSON_INT32_WIDTH 11            // -2147483648
+#define JSON_UINT32_WIDTH 10           // 4294967295
+#define JSON_EPOCH_MS_WIDTH 13         // Unix time in ms until the year 2286
+#define JSON_BOOL_WIDTH 5              // false
+#define JSON_STRING_WIDTH(chars) ((chars) + 2)  // Characters plus quotes
+
+enum JsonFieldType {
+  JSON_NUMBER,
+  JSON_BOOL,
+  JSON_STRING
+};
+
+struct JsonField {
+  const char* key;
+  JsonFieldType type;
+  uint8_t width;                       // Characters reserved for the value
+};
+
+constexpr size_t jsonKeyLength(const char* key) {
+  return *key == '\0' ? 0 : 1 + jsonKeyLength(key + 1);
+}
+
+// "key":<value>, or "key":<value>} for the last field
+constexpr size_t jsonFieldsSize(const JsonField* fields, size_t count) {
+  return count == 0 ? 0
+                    : jsonKeyLength(fields[0].key) + 3 + fields[0].width + 1 +
+                          jsonFieldsSize(fields + 1, count - 1);
+}
+
+// Buffer size for a schema array: '{', the fields, and the terminator
+#define JSON_TEMPLATE_SIZE(schema) \
+  (2 + jsonFieldsSize(schema, sizeof(schema) / sizeof((schema)[0])))
+
+class JsonTemplate {
+public:
+  template <size_t N>
+  JsonTemplate(const JsonField (&fields)[N], char* buffer, size_t size)
+      : _fields(fields), _count(N), _buffer(buffer), _size(size), _length(0), _overflows(0) {
+    static_assert(N <= JSON_TEMPLATE_MAX_FIELDS, "Raise JSON_TEMPLATE_MAX_FIELDS");
+    layout();
+  }
+
+  // Values that do not fit their slot are written as null (numbers) or
+  // truncated (strings) and counted in overflows()
+  void setInt(uint8_t field, long value);
+  void setUnsigned(uint8_t field, unsigned long long value);
+  void setFloat(uint8_t field, float value, uint8_t decimals);
+  void setBool(uint8_t field, bool value);
+  void setString(uint8_t field, const char* value);
+
+  // Empty string if the buffer was too small for the schema
+  const char* c_str() const { return _buffer; }
+  size_t length() const { return _length; }
+  unsigned long overflows() const { return _overflows; }
+
+private:
+  void layout();
+  char* slot(uint8_t field, JsonFieldType type);
+  void writeNumber(uint8_t field, const char* digits, size_t length);
+
+  const JsonField* _fields;
+  uint8_t _count;
+  char* _buffer;
+  size_t _size;
+  size_t _length;
+  unsigned long _overflows;
+  uint16_t _offsets[JSON_TEMPLATE_MAX_FIELDS];
+};
+
+// Formats value with a fixed number of decimals (at most 6) into out without
+// touching the heap, for plain-text topics. Returns the length, or 0 if it
+// does not fit or value is not finite.
+size_t jsonFormatDecimal(char* out, size_t size, float value, uint8_t decimals);
+
+#endif // JSON_TEMPLATE_H
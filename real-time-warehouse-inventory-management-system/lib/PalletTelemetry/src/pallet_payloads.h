@@ -0,0 +1,56 @@
+/*
+  pallet_payloads.h - JSON payload schemas the pallet publishes
+  One definition of each payload's keys and widths (json_template.h) for
+  the firmware, the heap test sketch and tools/pallet_loadgen, so what the
+  backend parses cannot drift between them. Each file lays out its own
+  JsonTemplate buffer from these.
+*/
+
+#ifndef PALLET_PAYLOADS_H
+#define PALLET_PAYLOADS_H
+
+#include "json_template.h"
+#include "telemetry_frame.h"
+
+#define PAYLOAD_DEVICE_ID_LENGTH 24    // BottleScale_<MAC>
+#define PAYLOAD_TX_ID_LENGTH 16        // Queue generation + sequence in hex
+#define PAYLOAD_VEHICLE_ID_LENGTH (TELEMETRY_UID_MAX_LENGTH * 2)  // UID in hex
+
+// <site>/<device>/nfc/transaction: one completed LOAD/UNLOAD
+enum NFCTransactionJsonField {
+  TX_JSON_DEVICE_ID, TX_JSON_TX_ID, TX_JSON_SEQUENCE, TX_JSON_VEHICLE_ID, TX_JSON_TYPE,
+  TX_JSON_BOTTLE_COUNT, TX_JSON_TOTAL_BOTTLES, TX_JSON_TIMESTAMP, TX_JSON_EPOCH_MS
+};
+static constexpr JsonField nfc_transaction_schema[] = {
+  { "device_id", JSON_STRING, JSON_STRING_WIDTH(PAYLOAD_DEVICE_ID_LENGTH) },
+  { "tx_id", JSON_STRING, JSON_STRING_WIDTH(PAYLOAD_TX_ID_LENGTH) },
+  { "sequence", JSON_NUMBER, JSON_UINT32_WIDTH },
+  { "vehicle_id", JSON_STRING, JSON_STRING_WIDTH(PAYLOAD_VEHICLE_ID_LENGTH) },
+  { "transaction_type", JSON_STRING, JSON_STRING_WIDTH(6) },
+  { "bottle_count", JSON_NUMBER, 6 },
+  { "total_bottles", JSON_NUMBER, 6 },
+  { "timestamp", JSON_NUMBER, JSON_UINT32_WIDTH },
+  { "epoch_ms", JSON_NUMBER, JSON_EPOCH_MS_WIDTH },
+};
+
+// bottle-scale/data (MQTT_LEGACY_TOPICS): the pallet snapshot as JSON
+enum DataJsonField {
+  DATA_JSON_WEIGHT_G, DATA_JSON_WEIGHT_OZ, DATA_JSON_BOTTLES, DATA_JSON_STATUS, DATA_JSON_NFC_STATE,
+  DATA_JSON_VEHICLE_ID, DATA_JSON_OPEN_TRANSACTIONS, DATA_JSON_TIMESTAMP, DATA_JSON_EPOCH_MS,
+  DATA_JSON_BOOT, DATA_JSON_SEQUENCE
+};
+static constexpr JsonField data_schema[] = {
+  { "weight_g", JSON_NUMBER, 7 },
+  { "weight_oz", JSON_NUMBER, 8 },
+  { "bottles", JSON_NUMBER, 6 },
+  { "status", JSON_STRING, JSON_STRING_WIDTH(9) },
+  { "nfc_state", JSON_STRING, JSON_STRING_WIDTH(15) },
+  { "vehicle_id", JSON_STRING, JSON_STRING_WIDTH(PAYLOAD_VEHICLE_ID_LENGTH) },
+  { "open_transactions", JSON_NUMBER, 2 },
+  { "timestamp", JSON_NUMBER, JSON_UINT32_WIDTH },
+  { "epoch_ms", JSON_NUMBER, JSON_EPOCH_MS_WIDTH },
+  { "boot", JSON_NUMBER, JSON_UINT32_WIDTH },
+  { "sequence", JSON_NUMBER, JSON_UINT32_WIDTH },
+};
+
+#endif // PALLET_PAYLOADS_H
@@ -0,0 +1,71 @@
+/*
+ * Report-by-exception policy - decides when a telemetry sample is published
+ */
+
+#include "report_policy.h"
+
+void reportPolicyBegin(ReportPolicy* policy, int32_t weight_deadband,
+                       uint32_t heartbeat_interval, uint32_t min_interval) {
+  policy->weight_deadband = weight_deadband;
+  policy->heartbeat_interval = heartbeat_interval;
+  policy->min_interval = min_interval;
+  policy->has_baseline = false;
+  policy->last_report_time = 0;
+  policy->published = 0;
+  policy->heartbeats = 0;
+  policy->suppressed = 0;
+}
+
+ReportReason reportCheck(ReportPolicy* policy, const ReportSample* sample, uint32_t now) {
+  if (!policy->has_baseline) {
+    return REPORT_FIRST;
+  }
+
+  uint32_t since_report = now - policy->last_report_time;
+  const ReportSample* last = &policy->last;
+  ReportReason reason = REPORT_NONE;
+
+  int32_t weight_change = sample->weight - last->weight;
+  if (weight_change < 0) weight_change = -weight_change;
+
+  if (sample->count != last->count) {
+    reason = REPORT_COUNT;
+  } else if (sample->status != last->status || sample->nfc_state != last->nfc_state) {
+    reason = REPORT_STATE;
+  } else if (weight_change > policy->weight_deadband) {
+    reason = REPORT_WEIGHT;
+  } else if (since_report >= policy->heartbeat_interval) {
+    reason = REPORT_HEARTBEAT;
+  }
+
+  // Rate limit: the baseline is untouched, so the change goes out next time
+  if (reason != REPORT_NONE && reason != REPORT_HEARTBEAT && since_report < policy->min_interval) {
+    reason = REPORT_NONE;
+  }
+
+  if (reason == REPORT_NONE) {
+    policy->suppressed++;
+  }
+  return reason;
+}
+
+void reportSent(ReportPolicy* policy, const ReportSample* sample, ReportReason reason, uint32_t now) {
+  policy->last = *sample;
+  policy->has_baseline = true;
+  policy->last_report_time = now;
+  policy->published++;
+  if (reason == REPORT_HEARTBEAT) {
+    policy->heartbeats++;
+  }
+}
+
+const char* reportReasonName(ReportReason reason) {
+  switch (reason) {
+    case REPORT_FIRST: return "first";
+    case REPORT_COUNT: return "count";
+    case REPORT_STATE: return "state";
+    case REPORT_WEIGHT: return "weight";
+    case REPORT_HEARTBEAT: return "heartbeat";
+    default: return "none";
+  }
+}
@@ -0,0 +1,64 @@
+/*
+  report_policy.h - Report-by-exception for periodic telemetry
+  Instead of publishing the full state on a fixed clock, the firmware asks
+  the policy after every sample whether anything worth reporting happened:
+  the bottle count changed, the weight moved past a deadband since the last
+  report, or the status / NFC state changed. A heartbeat still goes out on
+  a long interval so consumers can tell a quiet pallet from a dead one.
+  Checks that find nothing to report are counted as suppressed publishes.
+
+  reportCheck() does not update the baseline - call reportSent() only once
+  the publish went out, so a change seen while offline is still reported.
+*/
+
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdint.h>
+
+enum ReportReason {
+  REPORT_NONE = 0,                     // Nothing changed - publish suppressed
+  REPORT_FIRST,                        // No report sent yet
+  REPORT_COUNT,                        // Bottle count changed
+  REPORT_STATE,                        // Status or NFC state changed
+  REPORT_WEIGHT,                       // Weight moved past the deadband
+  REPORT_HEARTBEAT                     // Nothing changed for heartbeat_interval
+};
+
+// What the policy compares between reports
+struct ReportSample {
+  int32_t weight;                      // Same unit as weight_deadband
+  int32_t count;
+  uint8_t status;
+  uint8_t nfc_state;
+};
+
+struct ReportPolicy {
+  // Configuration
+  int32_t weight_deadband;             // Weight change that is reported on its own
+  uint32_t heartbeat_interval;         // ms without a report before one is forced
+  uint32_t min_interval;               // ms between reports (changes wait, not dropped)
+
+  // Baseline: what the last report carried
+  bool has_baseline;
+  ReportSample last;
+  uint32_t last_report_time;
+
+  // Counters since boot
+  uint32_t published;
+  uint32_t heartbeats;
+  uint32_t suppressed;
+};
+
+void reportPolicyBegin(ReportPolicy* policy, int32_t weight_deadband,
+                       uint32_t heartbeat_interval, uint32_t min_interval);
+
+// Why the sample should be published now, or REPORT_NONE
+ReportReason reportCheck(ReportPolicy* policy, const ReportSample* sample, uint32_t now);
+
+// Records a publish that actually went out as the new baseline
+void reportSent(ReportPolicy* policy, const ReportSample* sample, ReportReason reason, uint32_t now);
+
+const char* reportReasonName(ReportReason reason);
+
+#endif // REPORT_POLICY_H
@@ -0,0 +1,222 @@
+/*
+ * Full-rate sample windows - running statistics, encoder and decoder
+ * Same byte-by-byte little-endian writing as telemetry_frame.cpp; floats
+ * are sent as their IEEE-754 bit pattern, which the ESP32 and every host
+ * this is decoded on share.
+ */
+
+#include "sample_window.h"
+
+#include <string.h>
+
+static void putU16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)((value >> 8) & 0xFF);
+  p[2] = (uint8_t)((value >> 16) & 0xFF);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static void putFloat(uint8_t* p, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  putU32(p, bits);
+}
+
+static void putU64(uint8_t* p, uint64_t value) {
+  putU32(p, (uint32_t)(value & 0xFFFFFFFFULL));
+  putU32(p + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t getU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t getU64(const uint8_t* p) {
+  return (uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+static float getFloat(const uint8_t* p) {
+  uint32_t bits = getU32(p);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void sampleWindowBegin(SampleWindow* window, uint8_t unit) {
+  window->sequence = 0;
+  window->count = 0;
+  window->unit = unit;
+  window->boot_count = 0;
+  window->start_epoch_ms = 0;
+  sampleWindowReset(window);
+}
+
+void sampleWindowReset(SampleWindow* window) {
+  if (window->count > 0) {
+    window->sequence++;
+  }
+  window->start_ms = 0;
+  window->last_ms = 0;
+  window->count = 0;
+  window->min = 0;
+  window->max = 0;
+  window->mean = 0.0;
+  window->m2 = 0.0;
+}
+
+bool sampleWindowAdd(SampleWindow* window, int32_t value, uint32_t now_ms) {
+  if (window->count >= SAMPLE_WINDOW_MAX_SAMPLES) {
+    return false;
+  }
+
+  if (window->count == 0) {
+    window->start_ms = now_ms;
+    window->min = value;
+    window->max = value;
+  } else {
+    if (value < window->min) window->min = value;
+    if (value > window->max) window->max = value;
+  }
+  window->samples[window->count++] = value;
+  window->last_ms = now_ms;
+
+  // Welford: numerically stable single pass mean and variance
+  double delta = value - window->mean;
+  window->mean += delta / window->count;
+  window->m2 += delta * (value - window->mean);
+  return true;
+}
+
+bool sampleWindowDue(const SampleWindow* window, uint32_t now_ms, uint32_t duration_ms) {
+  if (window->count == 0) {
+    return false;
+  }
+  return window->count >= SAMPLE_WINDOW_MAX_SAMPLES || now_ms - window->start_ms >= duration_ms;
+}
+
+float sampleWindowVariance(const SampleWindow* window) {
+  if (window->count < 2) {
+    return 0.0f;
+  }
+  return (float)(window->m2 / (window->count - 1));
+}
+
+size_t sampleWindowEncode(const SampleWindow* window, uint8_t* out, size_t capacity) {
+  if (window->count == 0) {
+    return 0;
+  }
+
+  // Two-byte deltas unless one step between neighbours does not fit
+  uint8_t width = 2;
+  for (uint16_t i = 1; i < window->count; i++) {
+    int64_t step = (int64_t)window->samples[i] - window->samples[i - 1];
+    if (step < INT16_MIN || step > INT16_MAX) {
+      width = 4;
+      break;
+    }
+  }
+
+  size_t length = SAMPLE_WINDOW_HEADER_SIZE + 4 + (size_t)(window->count - 1) * width +
+                  SAMPLE_WINDOW_TRAILER_SIZE;
+  if (capacity < length) {
+    return 0;
+  }
+
+  uint32_t span = window->last_ms - window->start_ms;
+  out[0] = TELEMETRY_SCHEMA_SAMPLE_WINDOW;
+  out[1] = SAMPLE_WINDOW_VERSION;
+  putU32(&out[2], window->sequence);
+  putU32(&out[6], window->start_ms);
+  putU16(&out[10], (uint16_t)(span > 0xFFFF ? 0xFFFF : span));
+  putU16(&out[12], window->count);
+  out[14] = window->unit;
+  out[15] = width;
+  putU32(&out[16], (uint32_t)window->min);
+  putU32(&out[20], (uint32_t)window->max);
+  putFloat(&out[24], (float)window->mean);
+  putFloat(&out[28], sampleWindowVariance(window));
+  putU32(&out[32], (uint32_t)window->samples[0]);
+
+  uint8_t* p = &out[SAMPLE_WINDOW_HEADER_SIZE + 4];
+  for (uint16_t i = 1; i < window->count; i++) {
+    uint32_t step = (uint32_t)window->samples[i] - (uint32_t)window->samples[i - 1];
+    if (width == 2) {
+      putU16(p, (uint16_t)step);
+    } else {
+      putU32(p, step);
+    }
+    p += width;
+  }
+  putU32(p, window->boot_count);
+  putU64(p + 4, window->start_epoch_ms);
+  return length;
+}
+
+TelemetryDecodeResult sampleWindowDecode(const uint8_t* data, size_t length,
+                                         SampleWindowStats* stats,
+                                         int32_t* samples, size_t max_samples) {
+  if (length < 2) {
+    return TELEMETRY_TOO_SHORT;
+  }
+  if (data[0] != TELEMETRY_SCHEMA_SAMPLE_WINDOW) {
+    return TELEMETRY_UNKNOWN_SCHEMA;
+  }
+  if (length < SAMPLE_WINDOW_HEADER_SIZE + 4) {
+    return TELEMETRY_TOO_SHORT;
+  }
+
+  stats->sequence = getU32(&data[2]);
+  stats->start_ms = getU32(&data[6]);
+  stats->span_ms = getU16(&data[10]);
+  stats->count = getU16(&data[12]);
+  stats->unit = data[14];
+  stats->sample_width = data[15];
+  stats->min = (int32_t)getU32(&data[16]);
+  stats->max = (int32_t)getU32(&data[20]);
+  stats->mean = getFloat(&data[24]);
+  stats->variance = getFloat(&data[28]);
+
+  if (stats->count == 0 || (stats->sample_width != 2 && stats->sample_width != 4)) {
+    return TELEMETRY_BAD_FIELD;
+  }
+  size_t needed = SAMPLE_WINDOW_HEADER_SIZE + 4 + (size_t)(stats->count - 1) * stats->sample_width;
+  if (length < needed || (data[1] >= 2 && length < needed + SAMPLE_WINDOW_TRAILER_SIZE)) {
+    return TELEMETRY_TOO_SHORT;
+  }
+  stats->boot_count = data[1] >= 2 ? getU32(&data[needed]) : 0;
+  stats->start_epoch_ms = data[1] >= 2 ? getU64(&data[needed + 4]) : 0;
+  if (samples == NULL || max_samples == 0) {
+    return TELEMETRY_OK;
+  }
+
+  uint32_t value = getU32(&data[32]);
+  samples[0] = (int32_t)value;
+  const uint8_t* p = &data[SAMPLE_WINDOW_HEADER_SIZE + 4];
+  for (uint16_t i = 1; i < stats->count && i < max_samples; i++) {
+    if (stats->sample_width == 2) {
+      value += (uint32_t)(int32_t)(int16_t)getU16(p);
+    } else {
+      value += getU32(p);
+    }
+    samples[i] = (int32_t)value;
+    p += stats->sample_width;
+  }
+  return TELEMETRY_OK;
+}
+
+const char* sampleUnitName(uint8_t unit) {
+  switch (unit) {
+    case SAMPLE_UNIT_RAW: return "raw";
+    case SAMPLE_UNIT_DECIGRAM: return "decigram";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,119 @@
+/*
+  sample_window.h - Fixed windows of full-rate load cell samples
+  Collects every HX711 conversion for a fixed time window (1 s by default),
+  keeps running min/max/mean/variance (Welford's method, so nothing is
+  re-scanned when the window closes) and packs the samples into a single
+  binary message: the first sample as int32 and every following one as a
+  delta from its predecessor, 2 bytes each unless a step does not fit.
+
+  Message layout (schema TELEMETRY_SCHEMA_SAMPLE_WINDOW, version 2):
+
+    offset size field
+    0      1    schema id
+    1      1    schema version
+    2      4    window_sequence     uint32, windows closed since boot
+    6      4    start_ms            uint32, device millis() of the first sample
+    10     2    span_ms             uint16, first to last sample
+    12     2    count               samples in the window (>= 1)
+    14     1    unit                SampleUnit of every value below
+    15     1    sample_width        2 or 4, size of each delta
+    16     4    min                 int32
+    20     4    max                 int32
+    24     4    mean                IEEE-754 float
+    28     4    variance            IEEE-754 float, sample variance (n - 1)
+    32     4    first sample        int32
+    36     ...  count - 1 deltas    int16 or int32, little-endian
+    -- version 2, after the last delta --
+    +0     4    boot_count          uint32, persistent boot counter
+    +4     8    start_epoch_ms      uint64, Unix time in ms of the first sample, 0 if unsynced
+
+  Samples carry no individual timestamps: the HX711 converts on its own
+  clock, so sample i is at start_ms + i * span_ms / (count - 1).
+  A gap in window_sequence means windows were lost (e.g. broker offline);
+  the sequence restarts at 0 with every boot_count.
+  The version 2 trailer sits after the samples so version 1 decoders, which
+  stop after the last delta, still read these messages.
+*/
+
+#ifndef SAMPLE_WINDOW_H
+#define SAMPLE_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_frame.h"
+
+// ============================================================================
+// Schema
+// ============================================================================
+#define TELEMETRY_SCHEMA_SAMPLE_WINDOW 0x02
+#define SAMPLE_WINDOW_VERSION 2
+#define SAMPLE_WINDOW_HEADER_SIZE 32
+#define SAMPLE_WINDOW_TRAILER_SIZE 12
+#define SAMPLE_WINDOW_MAX_SAMPLES 100   // 1 s at 80 SPS plus clock slack
+#define SAMPLE_WINDOW_MAX_SIZE \
+  (SAMPLE_WINDOW_HEADER_SIZE + 4 * SAMPLE_WINDOW_MAX_SAMPLES + SAMPLE_WINDOW_TRAILER_SIZE)
+
+enum SampleUnit {
+  SAMPLE_UNIT_RAW = 0,                  // HX711 counts before tare and scale
+  SAMPLE_UNIT_DECIGRAM = 1              // Calibrated weight in 0.1 g
+};
+
+struct SampleWindow {
+  uint32_t sequence;                    // Number of the window being filled
+  uint32_t start_ms;
+  uint32_t last_ms;
+  uint16_t count;
+  uint8_t unit;
+  int32_t min;
+  int32_t max;
+  double mean;                          // Welford running mean
+  double m2;                            // Welford sum of squared deviations
+  int32_t samples[SAMPLE_WINDOW_MAX_SAMPLES];
+  uint32_t boot_count;                  // Set by the caller before encoding
+  uint64_t start_epoch_ms;              // Set by the caller before encoding, 0 if unknown
+};
+
+// Decoded header; the samples are returned separately
+struct SampleWindowStats {
+  uint32_t sequence;
+  uint32_t start_ms;
+  uint16_t span_ms;
+  uint16_t count;
+  uint8_t unit;
+  uint8_t sample_width;
+  int32_t min;
+  int32_t max;
+  float mean;
+  float variance;
+  uint32_t boot_count;                  // 0 in version 1 messages
+  uint64_t start_epoch_ms;              // 0 in version 1 messages
+};
+
+void sampleWindowBegin(SampleWindow* window, uint8_t unit);
+
+// Adds one sample; false (sample ignored) if the window is already full
+bool sampleWindowAdd(SampleWindow* window, int32_t value, uint32_t now_ms);
+
+// True once the window holds samples and either duration_ms has passed
+// since its first sample or it is full
+bool sampleWindowDue(const SampleWindow* window, uint32_t now_ms, uint32_t duration_ms);
+
+float sampleWindowVariance(const SampleWindow* window);
+
+// Encodes the window (count must be > 0); returns the message length, or 0
+// if capacity is too small. SAMPLE_WINDOW_MAX_SIZE always fits.
+size_t sampleWindowEncode(const SampleWindow* window, uint8_t* out, size_t capacity);
+
+// Starts the next window: bumps the sequence and clears the samples
+void sampleWindowReset(SampleWindow* window);
+
+// Decodes the header into stats and up to max_samples values into samples
+// (samples may be NULL to read the header only)
+TelemetryDecodeResult sampleWindowDecode(const uint8_t* data, size_t length,
+                                         SampleWindowStats* stats,
+                                         int32_t* samples, size_t max_samples);
+
+const char* sampleUnitName(uint8_t unit);
+
+#endif // SAMPLE_WINDOW_H
@@ -0,0 +1,221 @@
+/*
+ * Time-series block codec - bucketed zig-zag bit packing
+ * The header is little-endian like the other frames; the sample bits are
+ * packed MSB first, so a block reads left to right in a hex dump.
+ */
+
+#include "series_codec.h"
+
+#include <string.h>
+
+// Payload widths of buckets 1-4 (bucket 0 is an exact zero)
+static const uint8_t timestamp_widths[4] = { 7, 9, 12, 32 };
+static const uint8_t value_widths[4] = { 4, 8, 16, 32 };
+
+static void putU16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)((value >> 8) & 0xFF);
+  p[2] = (uint8_t)((value >> 16) & 0xFF);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static uint16_t getU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t zigzag(uint32_t value) {
+  return (value << 1) ^ (uint32_t)((int32_t)value >> 31);
+}
+
+static uint32_t unzigzag(uint32_t value) {
+  return (value >> 1) ^ (0U - (value & 1));
+}
+
+// Smallest bucket that holds value: 0 for zero, else 1-4
+static int bucketFor(uint32_t value, const uint8_t* widths) {
+  if (value == 0) return 0;
+  for (int i = 0; i < 3; i++) {
+    if (value < (1UL << widths[i])) return i + 1;
+  }
+  return 4;
+}
+
+// Prefix (bucket ones, then a zero below bucket 4) plus payload
+static int bucketBits(int bucket, const uint8_t* widths) {
+  if (bucket == 0) return 1;
+  return (bucket < 4 ? bucket + 1 : 4) + widths[bucket - 1];
+}
+
+static void putBits(SeriesEncoder* encoder, uint32_t value, int bits) {
+  while (bits > 0) {
+    size_t index = encoder->bit_position >> 3;
+    int used = (int)(encoder->bit_position & 7);
+    if (used == 0) {
+      encoder->out[index] = 0;
+    }
+    int take = 8 - used < bits ? 8 - used : bits;
+    uint32_t chunk = (value >> (bits - take)) & ((1U << take) - 1);
+    encoder->out[index] |= (uint8_t)(chunk << (8 - used - take));
+    encoder->bit_position += take;
+    bits -= take;
+  }
+}
+
+static void putBucketed(SeriesEncoder* encoder, uint32_t value, int bucket, const uint8_t* widths) {
+  if (bucket == 0) {
+    putBits(encoder, 0, 1);
+    return;
+  }
+  // bucket ones, terminated by a zero except in the last bucket
+  int prefix_bits = bucket < 4 ? bucket + 1 : 4;
+  uint32_t prefix = bucket < 4 ? ((1U << bucket) - 1) << 1 : 0xF;
+  putBits(encoder, prefix, prefix_bits);
+  putBits(encoder, value, widths[bucket - 1]);
+}
+
+bool seriesEncoderBegin(SeriesEncoder* encoder, uint8_t* out, size_t capacity,
+                        uint32_t sequence, uint8_t unit) {
+  if (capacity < SERIES_BLOCK_HEADER_SIZE) {
+    return false;
+  }
+  memset(out, 0, SERIES_BLOCK_HEADER_SIZE);
+  out[0] = TELEMETRY_SCHEMA_SERIES_BLOCK;
+  out[1] = SERIES_BLOCK_VERSION;
+  putU32(out + 2, sequence);
+  out[8] = unit;
+
+  encoder->out = out;
+  encoder->capacity = capacity;
+  encoder->bit_position = SERIES_BLOCK_HEADER_SIZE * 8;
+  encoder->count = 0;
+  encoder->last_ms = 0;
+  encoder->last_delta_ms = 0;
+  encoder->last_value = 0;
+  return true;
+}
+
+bool seriesEncoderAdd(SeriesEncoder* encoder, uint32_t timestamp_ms, int32_t value) {
+  if (encoder->count == 0) {
+    putU32(encoder->out + 10, timestamp_ms);
+    putU32(encoder->out + 18, (uint32_t)value);
+  } else {
+    if (encoder->count == SERIES_BLOCK_MAX_SAMPLES) {
+      return false;
+    }
+    uint32_t delta_ms = timestamp_ms - encoder->last_ms;
+    uint32_t timestamp_code = zigzag(delta_ms - encoder->last_delta_ms);
+    uint32_t value_code = zigzag((uint32_t)value - (uint32_t)encoder->last_value);
+    int timestamp_bucket = bucketFor(timestamp_code, timestamp_widths);
+    int value_bucket = bucketFor(value_code, value_widths);
+
+    // Check the space first so a refused sample leaves the block intact
+    size_t bits = bucketBits(timestamp_bucket, timestamp_widths) + bucketBits(value_bucket, value_widths);
+    if ((encoder->bit_position + bits + 7) / 8 > encoder->capacity) {
+      return false;
+    }
+    putBucketed(encoder, timestamp_code, timestamp_bucket, timestamp_widths);
+    putBucketed(encoder, value_code, value_bucket, value_widths);
+    encoder->last_delta_ms = delta_ms;
+  }
+
+  encoder->count++;
+  encoder->last_ms = timestamp_ms;
+  encoder->last_value = value;
+  return true;
+}
+
+size_t seriesEncoderFinish(SeriesEncoder* encoder) {
+  if (encoder->count == 0) {
+    return 0;
+  }
+  putU16(encoder->out + 6, encoder->count);
+  putU32(encoder->out + 14, encoder->last_ms);
+  return (encoder->bit_position + 7) / 8;
+}
+
+// Bit reader over the packed samples; reads past the end set overrun
+struct BitReader {
+  const uint8_t* data;
+  size_t bit_length;
+  size_t bit_position;
+  bool overrun;
+};
+
+static uint32_t getBits(BitReader* reader, int bits) {
+  if (reader->bit_position + bits > reader->bit_length) {
+    reader->overrun = true;
+    return 0;
+  }
+  uint32_t value = 0;
+  while (bits > 0) {
+    uint8_t byte = reader->data[reader->bit_position >> 3];
+    int used = (int)(reader->bit_position & 7);
+    int take = 8 - used < bits ? 8 - used : bits;
+    value = (value << take) | ((byte >> (8 - used - take)) & ((1U << take) - 1));
+    reader->bit_position += take;
+    bits -= take;
+  }
+  return value;
+}
+
+static uint32_t getBucketed(BitReader* reader, const uint8_t* widths) {
+  int bucket = 0;
+  while (bucket < 4 && getBits(reader, 1) == 1) {
+    bucket++;
+  }
+  return bucket == 0 ? 0 : getBits(reader, widths[bucket - 1]);
+}
+
+TelemetryDecodeResult seriesDecode(const uint8_t* data, size_t length, SeriesBlockInfo* info,
+                                   uint32_t* timestamps, int32_t* values, size_t max_samples) {
+  if (length < 2) {
+    return TELEMETRY_TOO_SHORT;
+  }
+  if (data[0] != TELEMETRY_SCHEMA_SERIES_BLOCK) {
+    return TELEMETRY_UNKNOWN_SCHEMA;
+  }
+  if (length < SERIES_BLOCK_HEADER_SIZE) {
+    return TELEMETRY_TOO_SHORT;
+  }
+
+  info->sequence = getU32(data + 2);
+  info->count = getU16(data + 6);
+  info->unit = data[8];
+  info->first_ms = getU32(data + 10);
+  info->last_ms = getU32(data + 14);
+  if (info->count == 0) {
+    return TELEMETRY_BAD_FIELD;
+  }
+  if (timestamps == NULL || values == NULL || max_samples == 0) {
+    return TELEMETRY_OK;
+  }
+
+  uint32_t timestamp = info->first_ms;
+  uint32_t delta_ms = 0;
+  uint32_t value = getU32(data + 18);
+  timestamps[0] = timestamp;
+  values[0] = (int32_t)value;
+
+  BitReader reader = { data, length * 8, SERIES_BLOCK_HEADER_SIZE * 8, false };
+  size_t wanted = info->count < max_samples ? info->count : max_samples;
+  for (size_t i = 1; i < wanted; i++) {
+    delta_ms += unzigzag(getBucketed(&reader, timestamp_widths));
+    value += unzigzag(getBucketed(&reader, value_widths));
+    if (reader.overrun) {
+      return TELEMETRY_TOO_SHORT;
+    }
+    timestamp += delta_ms;
+    timestamps[i] = timestamp;
+    values[i] = (int32_t)value;
+  }
+  return TELEMETRY_OK;
+}
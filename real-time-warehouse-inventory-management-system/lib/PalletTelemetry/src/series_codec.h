@@ -0,0 +1,92 @@
+/*
+  series_codec.h - Streaming compression for (timestamp, value) series
+  Gorilla-style: timestamps are stored as delta-of-delta and values as the
+  delta from the previous value, both zig-zag mapped and bit-packed into
+  variable-width buckets. A pallet at rest repeats its weight and samples
+  on a steady clock, so most samples cost 2 bits. Values are fixed-point
+  integers (e.g. decigrams or raw HX711 counts), so an integer delta does
+  the job a float XOR does in Gorilla and the series is lossless.
+
+  Samples are added one at a time in O(1) into a caller-provided buffer;
+  when a sample no longer fits, the block is finished and a new one begun.
+  Each block decodes on its own, so blocks can be published as MQTT
+  batches or appended to a flash log.
+
+  Block layout (schema TELEMETRY_SCHEMA_SERIES_BLOCK, version 1):
+
+    offset size field
+    0      1    schema id
+    1      1    schema version
+    2      4    block_sequence      uint32, chosen by the writer
+    6      2    count               samples in the block (>= 1)
+    8      1    unit                SampleUnit of every value
+    9      1    reserved            0
+    10     4    first_ms            uint32, timestamp of the first sample
+    14     4    last_ms             uint32, timestamp of the last sample
+    18     4    first_value         int32
+    22     ...  count - 1 samples, bit-packed MSB first:
+                  timestamp: delta-of-delta   value: delta
+                  0                 zero      0                 zero
+                  10   + 7 bits               10   + 4 bits
+                  110  + 9 bits               110  + 8 bits
+                  1110 + 12 bits              1110 + 16 bits
+                  1111 + 32 bits              1111 + 32 bits
+                each payload a zig-zag encoded int32; the last byte is
+                zero padded
+
+  The previous delta starts at 0, so the second sample stores its full
+  timestamp delta. All arithmetic is modulo 2^32, which makes millis()
+  wrap-around and any int32 value round-trip exactly.
+*/
+
+#ifndef SERIES_CODEC_H
+#define SERIES_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_frame.h"
+
+// ============================================================================
+// Schema
+// ============================================================================
+#define TELEMETRY_SCHEMA_SERIES_BLOCK 0x03
+#define SERIES_BLOCK_VERSION 1
+#define SERIES_BLOCK_HEADER_SIZE 22
+#define SERIES_BLOCK_MAX_SAMPLES 65535
+#define SERIES_SAMPLE_MAX_BITS 72       // Worst case per sample: 36 + 36
+
+struct SeriesEncoder {
+  uint8_t* out;
+  size_t capacity;
+  size_t bit_position;                  // From the start of out
+  uint16_t count;
+  uint32_t last_ms;
+  uint32_t last_delta_ms;
+  int32_t last_value;
+};
+
+struct SeriesBlockInfo {
+  uint32_t sequence;
+  uint16_t count;
+  uint8_t unit;
+  uint32_t first_ms;
+  uint32_t last_ms;
+};
+
+// Starts a block in out; false if capacity cannot hold the header
+bool seriesEncoderBegin(SeriesEncoder* encoder, uint8_t* out, size_t capacity,
+                        uint32_t sequence, uint8_t unit);
+
+// Appends one sample; false (nothing written) if the block is full
+bool seriesEncoderAdd(SeriesEncoder* encoder, uint32_t timestamp_ms, int32_t value);
+
+// Completes the header; returns the block length, or 0 if it holds no samples
+size_t seriesEncoderFinish(SeriesEncoder* encoder);
+
+// Decodes up to max_samples samples (timestamps and values may be NULL to
+// read the header only)
+TelemetryDecodeResult seriesDecode(const uint8_t* data, size_t length, SeriesBlockInfo* info,
+                                   uint32_t* timestamps, int32_t* values, size_t max_samples);
+
+#endif // SERIES_CODEC_H
@@ -0,0 +1,165 @@
+/*
+ * Compact binary telemetry frame - encoder and decoder
+ * Fields are written byte by byte so the layout does not depend on the
+ * compiler's struct packing or the CPU's byte order.
+ */
+
+#include "telemetry_frame.h"
+
+#include <string.h>
+
+static void putU16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)((value >> 8) & 0xFF);
+  p[2] = (uint8_t)((value >> 16) & 0xFF);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static void putU64(uint8_t* p, uint64_t value) {
+  putU32(p, (uint32_t)(value & 0xFFFFFFFFULL));
+  putU32(p + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t getU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t getU64(const uint8_t* p) {
+  return (uint64_t)getU32(p) | ((uint64_t)getU32(p + 4) << 32);
+}
+
+size_t telemetryEncodeSnapshot(const TelemetrySnapshot* snapshot, uint8_t* out, size_t capacity) {
+  if (capacity < TELEMETRY_SNAPSHOT_SIZE) {
+    return 0;
+  }
+
+  uint8_t uid_length = snapshot->vehicle_uid_length;
+  if (uid_length > TELEMETRY_UID_MAX_LENGTH) {
+    uid_length = TELEMETRY_UID_MAX_LENGTH;
+  }
+
+  out[0] = TELEMETRY_SCHEMA_SNAPSHOT;
+  out[1] = TELEMETRY_SNAPSHOT_VERSION;
+  putU32(&out[2], snapshot->timestamp_ms);
+  putU32(&out[6], (uint32_t)snapshot->weight_g);
+  putU16(&out[10], (uint16_t)snapshot->bottles);
+  out[12] = snapshot->status;
+  out[13] = snapshot->nfc_state;
+  out[14] = snapshot->open_transactions;
+  out[15] = uid_length;
+  memset(&out[16], 0, TELEMETRY_UID_MAX_LENGTH);
+  memcpy(&out[16], snapshot->vehicle_uid, uid_length);
+  out[23] = snapshot->report_reason;
+  putU32(&out[24], snapshot->suppressed);
+  putU64(&out[28], snapshot->epoch_ms);
+  putU32(&out[36], snapshot->boot_count);
+  putU32(&out[40], snapshot->sequence);
+  putU16(&out[44], snapshot->clock_age_s);
+  putU16(&out[46], (uint16_t)snapshot->drift_ppm);
+  return TELEMETRY_SNAPSHOT_SIZE;
+}
+
+TelemetryDecodeResult telemetryDecodeSnapshot(const uint8_t* data, size_t length,
+                                              TelemetrySnapshot* snapshot) {
+  if (length < 2) {
+    return TELEMETRY_TOO_SHORT;
+  }
+  if (data[0] != TELEMETRY_SCHEMA_SNAPSHOT) {
+    return TELEMETRY_UNKNOWN_SCHEMA;
+  }
+  // Newer versions only append fields - anything past the known layout is skipped
+  uint8_t version = data[1];
+  if (length < TELEMETRY_SNAPSHOT_V1_SIZE || (version >= 2 && length < TELEMETRY_SNAPSHOT_V2_SIZE) ||
+      (version >= 3 && length < TELEMETRY_SNAPSHOT_SIZE)) {
+    return TELEMETRY_TOO_SHORT;
+  }
+  if (data[15] > TELEMETRY_UID_MAX_LENGTH) {
+    return TELEMETRY_BAD_FIELD;
+  }
+
+  snapshot->timestamp_ms = getU32(&data[2]);
+  snapshot->weight_g = (int32_t)getU32(&data[6]);
+  snapshot->bottles = (int16_t)getU16(&data[10]);
+  snapshot->status = data[12];
+  snapshot->nfc_state = data[13];
+  snapshot->open_transactions = data[14];
+  snapshot->vehicle_uid_length = data[15];
+  memcpy(snapshot->vehicle_uid, &data[16], TELEMETRY_UID_MAX_LENGTH);
+  snapshot->report_reason = version >= 2 ? data[23] : 0;
+  snapshot->suppressed = version >= 2 ? getU32(&data[24]) : 0;
+  snapshot->epoch_ms = version >= 3 ? getU64(&data[28]) : 0;
+  snapshot->boot_count = version >= 3 ? getU32(&data[36]) : 0;
+  snapshot->sequence = version >= 3 ? getU32(&data[40]) : 0;
+  snapshot->clock_age_s = version >= 3 ? getU16(&data[44]) : TELEMETRY_CLOCK_AGE_UNKNOWN;
+  snapshot->drift_ppm = version >= 3 ? (int16_t)getU16(&data[46]) : 0;
+  return TELEMETRY_OK;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+uint8_t telemetryParseUID(const char* hex, uint8_t* uid) {
+  uint8_t length = 0;
+  while (length < TELEMETRY_UID_MAX_LENGTH) {
+    int high = hexValue(hex[length * 2]);
+    if (high < 0) break;
+    int low = hexValue(hex[length * 2 + 1]);
+    if (low < 0) break;
+    uid[length++] = (uint8_t)((high << 4) | low);
+  }
+  return length;
+}
+
+void telemetryFormatUID(const uint8_t* uid, uint8_t uid_length, char* hex) {
+  static const char digits[] = "0123456789ABCDEF";
+  if (uid_length > TELEMETRY_UID_MAX_LENGTH) {
+    uid_length = TELEMETRY_UID_MAX_LENGTH;
+  }
+  for (uint8_t i = 0; i < uid_length; i++) {
+    hex[i * 2] = digits[uid[i] >> 4];
+    hex[i * 2 + 1] = digits[uid[i] & 0x0F];
+  }
+  hex[uid_length * 2] = '\0';
+}
+
+const char* telemetryStatusName(uint8_t status) {
+  switch (status) {
+    case TELEMETRY_STATUS_LOADING: return "loading";
+    case TELEMETRY_STATUS_UNLOADING: return "unloading";
+    default: return "idle";
+  }
+}
+
+// Same numbering and names as NFCTransactionState / nfcStateName()
+const char* telemetryNFCStateName(uint8_t nfc_state) {
+  switch (nfc_state) {
+    case 1: return "load_ready";
+    case 2: return "load_complete";
+    case 3: return "unload_ready";
+    case 4: return "unload_complete";
+    default: return "idle";
+  }
+}
+
+const char* telemetryDecodeResultName(TelemetryDecodeResult result) {
+  switch (result) {
+    case TELEMETRY_OK: return "ok";
+    case TELEMETRY_TOO_SHORT: return "too short";
+    case TELEMETRY_UNKNOWN_SCHEMA: return "unknown schema";
+    case TELEMETRY_BAD_FIELD: return "bad field";
+    default: return "unknown";
+  }
+}
@@ -0,0 +1,100 @@
+/*
+  telemetry_frame.h - Compact binary telemetry frame
+  One fixed-layout, little-endian frame carries the whole pallet snapshot
+  that used to go out as five separate text publishes (weight, bottles,
+  status, JSON data and the weight_count CSV). Plain C++ with no Arduino
+  dependency so the same encoder/decoder builds on the ESP32 and on a host.
+
+  Frame layout (schema TELEMETRY_SCHEMA_SNAPSHOT, version 3, 48 bytes):
+
+    offset size field
+    0      1    schema id
+    1      1    schema version
+    2      4    timestamp_ms        uint32, device millis()
+    6      4    weight_g            int32
+    10     2    bottles             int16
+    12     1    status              TelemetryStatus
+    13     1    nfc_state           NFCTransactionState of the latest entry
+    14     1    open_transactions
+    15     1    vehicle_uid_length  0..TELEMETRY_UID_MAX_LENGTH
+    16     7    vehicle_uid         raw UID bytes, zero padded
+    -- version 2 --
+    23     1    report_reason       ReportReason that triggered this frame
+    24     4    suppressed          uint32, publishes suppressed since boot
+    -- version 3 --
+    28     8    epoch_ms            uint64, Unix time in ms, 0 if the clock is not synced
+    36     4    boot_count          uint32, persistent boot counter
+    40     4    sequence            uint32, frames since boot (first is 1)
+    44     2    clock_age_s         uint16, seconds since the last SNTP sync, 0xFFFF never
+    46     2    drift_ppm           int16, millis() drift measured between syncs
+
+  Later versions of a schema only append fields, so a decoder accepts any
+  version of a schema it knows as long as the frame holds the fields it
+  reads. An incompatible layout gets a new schema id.
+*/
+
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Schema
+// ============================================================================
+#define TELEMETRY_SCHEMA_SNAPSHOT 0x01
+#define TELEMETRY_SNAPSHOT_VERSION 3
+#define TELEMETRY_UID_MAX_LENGTH 7
+#define TELEMETRY_SNAPSHOT_V1_SIZE 23
+#define TELEMETRY_SNAPSHOT_V2_SIZE 28
+#define TELEMETRY_SNAPSHOT_SIZE 48
+#define TELEMETRY_CLOCK_AGE_UNKNOWN 0xFFFF
+
+enum TelemetryStatus {
+  TELEMETRY_STATUS_IDLE = 0,
+  TELEMETRY_STATUS_LOADING = 1,
+  TELEMETRY_STATUS_UNLOADING = 2
+};
+
+enum TelemetryDecodeResult {
+  TELEMETRY_OK,
+  TELEMETRY_TOO_SHORT,
+  TELEMETRY_UNKNOWN_SCHEMA,
+  TELEMETRY_BAD_FIELD
+};
+
+struct TelemetrySnapshot {
+  uint32_t timestamp_ms;
+  int32_t weight_g;
+  int16_t bottles;
+  uint8_t status;
+  uint8_t nfc_state;
+  uint8_t open_transactions;
+  uint8_t vehicle_uid_length;
+  uint8_t vehicle_uid[TELEMETRY_UID_MAX_LENGTH];
+  uint8_t report_reason;               // 0 in version 1 frames
+  uint32_t suppressed;                 // 0 in version 1 frames
+  uint64_t epoch_ms;                   // Fields below are 0 in version 1-2 frames
+  uint32_t boot_count;
+  uint32_t sequence;
+  uint16_t clock_age_s;                // TELEMETRY_CLOCK_AGE_UNKNOWN in version 1-2 frames
+  int16_t drift_ppm;
+};
+
+// Writes the frame into out; returns its length, or 0 if capacity is too small
+size_t telemetryEncodeSnapshot(const TelemetrySnapshot* snapshot, uint8_t* out, size_t capacity);
+
+TelemetryDecodeResult telemetryDecodeSnapshot(const uint8_t* data, size_t length,
+                                              TelemetrySnapshot* snapshot);
+
+// Vehicle IDs travel as raw UID bytes; these convert to and from the
+// uppercase hex strings used everywhere else. Parsing stops at the first
+// non-hex character and returns the number of bytes written.
+uint8_t telemetryParseUID(const char* hex, uint8_t* uid);
+void telemetryFormatUID(const uint8_t* uid, uint8_t uid_length, char* hex);
+
+const char* telemetryStatusName(uint8_t status);
+const char* telemetryNFCStateName(uint8_t nfc_state);
+const char* telemetryDecodeResultName(TelemetryDecodeResult result);
+
+#endif // TELEMETRY_FRAME_H
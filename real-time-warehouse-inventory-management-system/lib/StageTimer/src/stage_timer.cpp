@@ -0,0 +1,153 @@
+/*
+ * Stage timer - log2 histograms of cycle-counted block durations
+ * Stages are recorded from tasks on both cores, so updates and copies go
+ * through a spinlock; each holds it for a few dozen cycles.
+ */
+
+#include "stage_timer.h"
+
+#if STAGE_TIMING
+
+#include <freertos/FreeRTOS.h>
+#include <stdio.h>
+#include <string.h>
+
+struct Stage {
+  const char* name;
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t buckets[STAGE_TIMER_BUCKETS];
+};
+
+static Stage stages[STAGE_TIMER_MAX_STAGES];
+static uint8_t stage_count = 0;
+static portMUX_TYPE stage_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t bucketFor(uint32_t us) {
+  uint8_t bucket = us == 0 ? 0 : (uint8_t)(32 - __builtin_clz(us));
+  return bucket < STAGE_TIMER_BUCKETS ? bucket : STAGE_TIMER_BUCKETS - 1;
+}
+
+// Duration at which the running count reaches rank, spread evenly over
+// the bucket it falls in
+static uint32_t percentile(const Stage* stage, uint8_t percent) {
+  uint32_t rank = (uint32_t)(((uint64_t)stage->count * percent + 99) / 100);
+  uint32_t seen = 0;
+  for (uint8_t bucket = 0; bucket < STAGE_TIMER_BUCKETS; bucket++) {
+    uint32_t in_bucket = stage->buckets[bucket];
+    if (seen + in_bucket < rank) {
+      seen += in_bucket;
+      continue;
+    }
+    uint32_t low = bucket == 0 ? 0 : 1UL << (bucket - 1);
+    uint32_t high = bucket == 0 ? 1 : (bucket == STAGE_TIMER_BUCKETS - 1 ? stage->max_us : 1UL << bucket);
+    uint32_t value = low + (uint32_t)((uint64_t)(high - low) * (rank - seen) / in_bucket);
+    if (value < stage->min_us) return stage->min_us;
+    if (value > stage->max_us) return stage->max_us;
+    return value;
+  }
+  return stage->max_us;
+}
+
+uint8_t stageTimerRegister(const char* name) {
+  uint8_t stage = STAGE_TIMER_NONE;
+  portENTER_CRITICAL(&stage_lock);
+  for (uint8_t i = 0; i < stage_count; i++) {
+    if (strcmp(stages[i].name, name) == 0) {
+      stage = i;
+      break;
+    }
+  }
+  if (stage == STAGE_TIMER_NONE && stage_count < STAGE_TIMER_MAX_STAGES) {
+    stage = stage_count++;
+    memset(&stages[stage], 0, sizeof(Stage));
+    stages[stage].name = name;
+  }
+  portEXIT_CRITICAL(&stage_lock);
+  return stage;
+}
+
+void stageTimerRecord(uint8_t stage, uint32_t cycles) {
+  if (stage >= STAGE_TIMER_MAX_STAGES) {
+    return;
+  }
+  static uint32_t cycles_per_us = 0;
+  if (cycles_per_us == 0) {
+    cycles_per_us = ESP.getCpuFreqMHz();
+  }
+  uint32_t us = cycles / cycles_per_us;
+  uint8_t bucket = bucketFor(us);
+
+  portENTER_CRITICAL(&stage_lock);
+  Stage* s = &stages[stage];
+  if (s->count == 0 || us < s->min_us) {
+    s->min_us = us;
+  }
+  if (us > s->max_us) {
+    s->max_us = us;
+  }
+  s->count++;
+  s->buckets[bucket]++;
+  portEXIT_CRITICAL(&stage_lock);
+}
+
+uint8_t stageTimerCount() {
+  return stage_count;
+}
+
+bool stageTimerStats(uint8_t stage, StageStats* stats) {
+  if (stage >= stage_count) {
+    return false;
+  }
+  Stage copy;
+  portENTER_CRITICAL(&stage_lock);
+  memcpy(&copy, &stages[stage], sizeof(copy));
+  portEXIT_CRITICAL(&stage_lock);
+
+  stats->name = copy.name;
+  stats->count = copy.count;
+  stats->min_us = copy.min_us;
+  stats->max_us = copy.max_us;
+  stats->p50_us = copy.count > 0 ? percentile(&copy, 50) : 0;
+  stats->p99_us = copy.count > 0 ? percentile(&copy, 99) : 0;
+  return true;
+}
+
+void stageTimerReset() {
+  portENTER_CRITICAL(&stage_lock);
+  for (uint8_t i = 0; i < stage_count; i++) {
+    const char* name = stages[i].name;
+    memset(&stages[i], 0, sizeof(Stage));
+    stages[i].name = name;
+  }
+  portEXIT_CRITICAL(&stage_lock);
+}
+
+size_t stageTimerFormatJson(char* out, size_t size) {
+  if (size < 3) {
+    return 0;
+  }
+  size_t length = 1;
+  out[0] = '{';
+  for (uint8_t i = 0; i < stage_count; i++) {
+    StageStats stats;
+    if (!stageTimerStats(i, &stats) || stats.count == 0) {
+      continue;
+    }
+    // Room is kept for the closing brace
+    int written = snprintf(out + length, size - length - 1, "%s\"%s\":[%lu,%lu,%lu,%lu,%lu]",
+                           length > 1 ? "," : "", stats.name, (unsigned long)stats.count,
+                           (unsigned long)stats.min_us, (unsigned long)stats.p50_us,
+                           (unsigned long)stats.p99_us, (unsigned long)stats.max_us);
+    if (written < 0 || (size_t)written >= size - length - 1) {
+      break;
+    }
+    length += written;
+  }
+  out[length++] = '}';
+  out[length] = '\0';
+  return length;
+}
+
+#endif // STAGE_TIMING
@@ -0,0 +1,90 @@
+/*
+  stage_timer.h - Execution time histograms per firmware stage
+  STAGE_TIMER("name") at the top of a block times the rest of the block
+  with the CPU cycle counter and adds the duration to that stage's
+  histogram. The first pass through a site registers the name; sites with
+  the same name share a stage, so a library can time its own work (the
+  OLED task, the MQTT task) next to the application's.
+
+  Timing is compiled in only with -DSTAGE_TIMING=1. Without it the macro
+  expands to nothing and this library adds no code or RAM.
+
+  Each stage keeps its count, min and max and a log2 histogram of
+  microseconds. Bucket 0 holds durations under 1 us, bucket b those from
+  2^(b-1) up to 2^b us, and the last bucket everything longer. p50 and p99
+  are interpolated within their bucket, so they can be off by up to the
+  bucket width (a factor of two); min and max are exact.
+
+  The cycle counter is per core and wraps every 17.9 s at 240 MHz. Time only
+  blocks that run on one pinned task and take less than that.
+*/
+
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <Arduino.h>
+
+#ifndef STAGE_TIMING
+#define STAGE_TIMING 0
+#endif
+
+#if STAGE_TIMING
+
+// ============================================================================
+// Histogram Configuration
+// ============================================================================
+#define STAGE_TIMER_MAX_STAGES 12
+#define STAGE_TIMER_BUCKETS 24             // The last one holds everything from 2^22 us (4.2 s)
+#define STAGE_TIMER_NONE 0xFF              // No free stage: the site is not timed
+
+struct StageStats {
+  const char* name;
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t p50_us;
+  uint32_t p99_us;
+};
+
+// Stage for a name, registering it on first use; STAGE_TIMER_NONE once
+// STAGE_TIMER_MAX_STAGES names are taken
+uint8_t stageTimerRegister(const char* name);
+
+void stageTimerRecord(uint8_t stage, uint32_t cycles);
+
+uint8_t stageTimerCount();
+
+// False for an unregistered stage
+bool stageTimerStats(uint8_t stage, StageStats* stats);
+
+// Clears every histogram; the stages stay registered
+void stageTimerReset();
+
+// Every stage with samples as {"name":[count,min,p50,p99,max],...} in us.
+// Stages that do not fit are left out. Returns the length, without the
+// terminator.
+size_t stageTimerFormatJson(char* out, size_t size);
+
+class StageScope {
+ public:
+  explicit StageScope(uint8_t stage) : stage_(stage), start_(ESP.getCycleCount()) {}
+  ~StageScope() { stageTimerRecord(stage_, ESP.getCycleCount() - start_); }
+
+ private:
+  uint8_t stage_;
+  uint32_t start_;
+};
+
+#define STAGE_TIMER_JOIN2(a, b) a##b
+#define STAGE_TIMER_JOIN(a, b) STAGE_TIMER_JOIN2(a, b)
+#define STAGE_TIMER(name)                                                                 \
+  static const uint8_t STAGE_TIMER_JOIN(stage_timer_id_, __LINE__) = stageTimerRegister(name); \
+  StageScope STAGE_TIMER_JOIN(stage_timer_scope_, __LINE__)(STAGE_TIMER_JOIN(stage_timer_id_, __LINE__))
+
+#else
+
+#define STAGE_TIMER(name) do {} while (0)
+
+#endif // STAGE_TIMING
+
+#endif // STAGE_TIMER_H
@@ -0,0 +1,204 @@
+/*
+ * WiFi station state machine - WiFi events plus one retry timer
+ * The event handler (WiFi event task) and the timer callback (timer
+ * service task) share the state under a mutex. Each arms the timer before
+ * releasing it, so the latest transition always owns the next deadline.
+ */
+
+#include "wifi_link.h"
+#include "event_trace.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/timers.h>
+
+static SemaphoreHandle_t link_mutex = NULL;
+static TimerHandle_t retry_timer = NULL;
+static volatile WifiLinkState state = WIFI_LINK_IDLE;
+static uint32_t retries_in_row = 0;        // Failed attempts since the last connection
+static uint32_t begin_time = 0;
+static uint32_t down_since = 0;
+static bool in_outage = false;
+static WifiLinkStats stats;
+
+// Lock held
+static void armTimer(uint32_t ms) {
+  if (xTimerChangePeriod(retry_timer, pdMS_TO_TICKS(ms), 0) != pdPASS) {
+    Serial.println("⚠️ WiFi retry timer not armed");
+  }
+}
+
+// Lock held: exponential backoff with jitter, then wait for the timer
+static uint32_t scheduleRetry() {
+  uint32_t wait = WIFI_LINK_RETRY_MIN;
+  for (uint32_t i = 0; i < retries_in_row && wait < WIFI_LINK_RETRY_MAX; i++) {
+    wait *= 2;
+  }
+  if (wait > WIFI_LINK_RETRY_MAX) {
+    wait = WIFI_LINK_RETRY_MAX;
+  }
+  uint32_t spread = wait * WIFI_LINK_RETRY_JITTER / 100;
+  wait = wait - spread + esp_random() % (2 * spread + 1);
+
+  retries_in_row++;
+  state = WIFI_LINK_WAITING;
+  armTimer(wait);
+  return wait;
+}
+
+// WiFi event task
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  uint32_t now = millis();
+  uint32_t outage = 0;
+  uint32_t wait = 0;
+  bool connected = false;
+
+  xSemaphoreTake(link_mutex, portMAX_DELAY);
+  if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP && state != WIFI_LINK_CONNECTED) {
+    xTimerStop(retry_timer, 0);
+    if (stats.connects == 0) {
+      stats.first_connect_ms = now - begin_time;
+    }
+    if (in_outage) {
+      outage = now - down_since;
+      stats.last_down_ms = outage;
+      stats.total_down_ms += outage;
+      if (outage > stats.longest_down_ms) {
+        stats.longest_down_ms = outage;
+      }
+      in_outage = false;
+    }
+    stats.connects++;
+    retries_in_row = 0;
+    state = WIFI_LINK_CONNECTED;
+    connected = true;
+  } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    // Repeated disconnect events while already waiting change nothing
+    stats.last_reason = info.wifi_sta_disconnected.reason;
+    if (state == WIFI_LINK_CONNECTED) {
+      stats.disconnects++;
+      down_since = now;
+      in_outage = true;
+      wait = scheduleRetry();
+    } else if (state == WIFI_LINK_CONNECTING) {
+      stats.failures++;
+      wait = scheduleRetry();
+    }
+  }
+  xSemaphoreGive(link_mutex);
+
+  if (connected) {
+    TRACE_INSTANT("wifi_connected");
+    // Formatted from the octets: IPAddress::toString() allocates a String
+    IPAddress ip = WiFi.localIP();
+    if (outage > 0) {
+      Serial.printf("📶 WiFi back after %lu ms (%u.%u.%u.%u)\n", (unsigned long)outage,
+                    ip[0], ip[1], ip[2], ip[3]);
+    } else {
+      Serial.printf("📶 WiFi connected (%u.%u.%u.%u)\n", ip[0], ip[1], ip[2], ip[3]);
+    }
+  } else if (wait > 0) {
+    TRACE_INSTANT("wifi_down");
+    Serial.printf("📴 WiFi down (reason %u) - retrying in %lu ms\n",
+                  info.wifi_sta_disconnected.reason, (unsigned long)wait);
+  }
+}
+
+// Timer service task: start an attempt, or give up on one that timed out
+static void onRetryTimer(TimerHandle_t timer) {
+  bool attempt = false;
+  bool timed_out = false;
+
+  xSemaphoreTake(link_mutex, portMAX_DELAY);
+  if (state == WIFI_LINK_WAITING) {
+    stats.attempts++;
+    state = WIFI_LINK_CONNECTING;
+    armTimer(WIFI_LINK_CONNECT_TIMEOUT);
+    attempt = true;
+  } else if (state == WIFI_LINK_CONNECTING) {
+    stats.failures++;
+    scheduleRetry();
+    timed_out = true;
+  }
+  xSemaphoreGive(link_mutex);
+
+  // Neither call waits for the connection; the outcome arrives as an event
+  if (attempt) {
+    TRACE_INSTANT("wifi_attempt");
+    esp_wifi_connect();
+  } else if (timed_out) {
+    TRACE_INSTANT("wifi_timeout");
+    esp_wifi_disconnect();
+  }
+}
+
+bool wifiLinkBegin(const char* ssid, const char* password) {
+  if (link_mutex != NULL) {
+    return true;
+  }
+  link_mutex = xSemaphoreCreateMutex();
+  retry_timer = xTimerCreate("wifi_link", pdMS_TO_TICKS(WIFI_LINK_RETRY_MIN), pdFALSE, NULL,
+                             onRetryTimer);
+  if (link_mutex == NULL || retry_timer == NULL) {
+    Serial.println("❌ Could not start the WiFi link");
+    return false;
+  }
+  memset(&stats, 0, sizeof(stats));
+  begin_time = millis();
+
+  // The backoff decides when to retry, not the core
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent(onWiFiEvent);
+
+  bool already_connected = WiFi.status() == WL_CONNECTED;
+  xSemaphoreTake(link_mutex, portMAX_DELAY);
+  if (already_connected) {
+    stats.connects = 1;
+    state = WIFI_LINK_CONNECTED;
+  } else {
+    stats.attempts = 1;
+    state = WIFI_LINK_CONNECTING;
+    armTimer(WIFI_LINK_CONNECT_TIMEOUT);
+  }
+  xSemaphoreGive(link_mutex);
+
+  if (!already_connected) {
+    WiFi.mode(WIFI_STA);
+    if (ssid != NULL) {
+      WiFi.begin(ssid, password);
+    } else {
+      WiFi.begin();
+    }
+    Serial.printf("📶 WiFi connecting to %s in the background\n", ssid != NULL ? ssid : "stored network");
+  }
+  return true;
+}
+
+bool wifiLinkConnected() {
+  // Read without the lock: a single aligned word
+  return state == WIFI_LINK_CONNECTED;
+}
+
+WifiLinkStats wifiLinkStats() {
+  WifiLinkStats copy;
+  if (link_mutex == NULL) {
+    memset(&copy, 0, sizeof(copy));
+    return copy;
+  }
+  xSemaphoreTake(link_mutex, portMAX_DELAY);
+  copy = stats;
+  copy.state = state;
+  copy.down_ms = in_outage ? millis() - down_since : 0;
+  xSemaphoreGive(link_mutex);
+  return copy;
+}
+
+const char* wifiLinkStateName(WifiLinkState link_state) {
+  switch (link_state) {
+    case WIFI_LINK_CONNECTING: return "connecting";
+    case WIFI_LINK_CONNECTED: return "connected";
+    case WIFI_LINK_WAITING: return "waiting";
+    default: return "idle";
+  }
+}
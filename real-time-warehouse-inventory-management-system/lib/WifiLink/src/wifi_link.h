@@ -0,0 +1,66 @@
+/*
+  wifi_link.h - Event-driven WiFi station with reconnect backoff
+  Nothing polls WiFi.status() or sleeps waiting for it. WiFi.onEvent()
+  reports connects and disconnects, and a one-shot FreeRTOS timer drives
+  the reconnect state machine:
+
+    CONNECTING --got IP--> CONNECTED --disconnect--> WAITING
+        ^  |                                            |
+        |  +--disconnect / WIFI_LINK_CONNECT_TIMEOUT--> |
+        +--------------- backoff timer fires -----------+
+
+  The wait before each attempt starts at WIFI_LINK_RETRY_MIN and doubles
+  per failed attempt up to WIFI_LINK_RETRY_MAX. Each wait is spread by
+  +/- WIFI_LINK_RETRY_JITTER percent, so pallets that lose the same access
+  point do not all come back in the same instant. The Arduino core's own
+  auto-reconnect is turned off so it cannot bypass the backoff.
+
+  Outages are timed from the disconnect to the next IP address for
+  diagnostics. The time from wifiLinkBegin() to the first connection is
+  not an outage.
+*/
+
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Reconnect Configuration
+// ============================================================================
+#define WIFI_LINK_RETRY_MIN 1000           // Backoff before the first retry, ms
+#define WIFI_LINK_RETRY_MAX 60000          // Backoff ceiling, ms
+#define WIFI_LINK_RETRY_JITTER 25          // +/- percent applied to every backoff
+#define WIFI_LINK_CONNECT_TIMEOUT 20000    // An attempt with no IP by then has failed
+
+enum WifiLinkState {
+  WIFI_LINK_IDLE = 0,                    // wifiLinkBegin() not called yet
+  WIFI_LINK_CONNECTING,                  // Attempt in progress
+  WIFI_LINK_CONNECTED,                   // Has an IP address
+  WIFI_LINK_WAITING                      // Backing off before the next attempt
+};
+
+struct WifiLinkStats {
+  WifiLinkState state;
+  uint32_t connects;                     // Including the first
+  uint32_t disconnects;                  // Connections lost
+  uint32_t attempts;                     // Reconnect attempts started
+  uint32_t failures;                     // Attempts that ended without an IP
+  uint8_t last_reason;                   // wifi_err_reason_t of the last disconnect event
+  uint32_t first_connect_ms;             // wifiLinkBegin() to the first IP, 0 until then
+  uint32_t down_ms;                      // Current outage so far, 0 while connected
+  uint32_t last_down_ms;                 // Length of the most recent finished outage
+  uint32_t longest_down_ms;
+  uint32_t total_down_ms;                // All finished outages this boot
+};
+
+// Registers the event handler and starts connecting. With ssid NULL the
+// credentials already stored by the WiFi driver (e.g. from WiFiManager)
+// are used. Returns immediately.
+bool wifiLinkBegin(const char* ssid, const char* password);
+
+bool wifiLinkConnected();
+WifiLinkStats wifiLinkStats();
+const char* wifiLinkStateName(WifiLinkState state);
+
+#endif // WIFI_LINK_H
@@ -1,4 +1,4 @@
-import React, { useState, useEffect } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
 import { Activity, Wifi, WifiOff, Scale, Package, TrendingUp, TrendingDown, Minus } from 'lucide-react';
 
 // MQTT Web Client (using MQTT.js via CDN)
@@ -20,6 +20,7 @@ const BottleDashboardPage = () => {
   const [client, setClient] = useState(null);
   const [nfcVehicle, setNfcVehicle] = useState('');
   const [transactions, setTransactions] = useState([]);
+  const lastFrameKey = useRef(null);
 
   // Check for connection timeout
   useEffect(() => {
@@ -69,15 +70,12 @@ const BottleDashboardPage = () => {
           console.log('Connected to MQTT broker');
           setConnectionStatus('connected');
           
-          // Subscribe to topics (including NFC topics)
+          // Weight, bottles and status come from the backend WebSocket, which
+          // decodes the binary frame (and the legacy text topics); only the
+          // vehicle tap is taken straight from the broker.
+          // Per-pallet topics: bottle-scale/<site>/<device>/<stream>
           const topics = [
-            'bottle-scale/data',
-            'bottle-scale/weight',
-            'bottle-scale/bottles',
-            'bottle-scale/status',
-            'bottle-scale/nfc/vehicle-id',
-            'bottle-scale/nfc/transaction'
-
+            'bottle-scale/+/+/nfc/vehicle-id'
           ];
           
           topics.forEach(topic => {
@@ -93,67 +91,18 @@ const BottleDashboardPage = () => {
 
         mqttClient.on('message', (topic, message) => {
           try {
-            const now = new Date();
-            setLastUpdate(now);
-            
-            if (topic === 'bottle-scale/data') {
-              // Parse JSON data
-              const jsonData = JSON.parse(message.toString());
-              setData(prevData => ({
-                ...jsonData,
-                timestamp: now.getTime()
-              }));
-              
-              // Add to history (keep last 20 entries)
-              setHistory(prev => {
-                const newEntry = {
-                  ...jsonData,
-                  time: now.toLocaleTimeString(),
-                  timestamp: now.getTime()
-                };
-                return [newEntry, ...prev].slice(0, 20);
-              });
-              
-            } else {
-              // Handle individual topic updates
-              const value = message.toString();
-              const updateField = topic.split('/')[1]; // Gets 'weight', 'bottles', or 'status'
-                // Handle NFC specific topics (vehicle id and transactions)
-                if (topic === 'bottle-scale/nfc/vehicle-id') {
-                  const vehicleId = message.toString();
-                  setNfcVehicle(vehicleId);
-                  // keep indicator for a short time
-                  setTimeout(() => setNfcVehicle(''), 5000);
-                }
-
-                // NOTE: do NOT use raw MQTT NFC transaction payloads here.
-                // The MCU may publish a non-epoch timestamp which causes wrong
-                // date display until the backend normalizes it. The web-backend
-                // broadcasts a normalized 'nfc' message over WebSocket (with
-                // receivedAt and server timestamp). See WS handler added below.
-              
-              let processedValue = value;
-              
-              // Convert numeric fields
-              if (updateField === 'bottles' || updateField === 'weight') {
-                processedValue = parseInt(value) || 0;
-              }
-              
-              // Map the field names correctly
-              let fieldName = updateField;
-              if (updateField === 'weight') {
-                fieldName = 'weight_g'; // Map to weight_g to match data structure
-              }
-              
-              setData(prev => ({
-                ...prev,
-                [fieldName]: processedValue,
-                timestamp: now.getTime()
-              }));
-              
-              console.log(`Updated ${fieldName}: ${processedValue}`);
+            if (topic.endsWith('/nfc/vehicle-id')) {
+              const vehicleId = message.toString();
+              setNfcVehicle(vehicleId);
+              // keep indicator for a short time
+              setTimeout(() => setNfcVehicle(''), 5000);
             }
-            
+
+            // NOTE: do NOT use raw MQTT NFC transaction payloads here.
+            // The MCU may publish a non-epoch timestamp which causes wrong
+            // date display until the backend normalizes it. The web-backend
+            // broadcasts a normalized 'nfc' message over WebSocket (with
+            // receivedAt and server timestamp). See WS handler added below.
           } catch (error) {
             console.error('Error processing MQTT message:', error);
           }
@@ -210,7 +159,8 @@ const BottleDashboardPage = () => {
       fetchNfc();
     }, []);
 
-    // WebSocket listener to receive normalized NFC transactions from backend
+    // WebSocket listener to receive pallet snapshots and normalized NFC
+    // transactions from backend
     useEffect(() => {
       let ws;
       try {
@@ -218,7 +168,7 @@ const BottleDashboardPage = () => {
         ws = new WebSocket(wsUrl);
 
         ws.addEventListener('open', () => {
-          console.log('WebSocket connected to backend for NFC updates');
+          console.log('WebSocket connected to backend for pallet and NFC updates');
         });
 
         ws.addEventListener('message', (ev) => {
@@ -226,8 +176,31 @@ const BottleDashboardPage = () => {
             const payload = JSON.parse(ev.data);
             if (payload && payload.type === 'nfc' && payload.data) {
               setTransactions(prev => [payload.data, ...prev].slice(0, 50));
+            } else if (payload && payload.type === 'data' && payload.data) {
+              // Latest pallet snapshot, decoded by the backend from the frame
+              const now = new Date();
+              const snapshot = payload.data;
+              setLastUpdate(now);
+              setData({ ...snapshot, timestamp: now.getTime() });
+
+              // The backend resends the snapshot on other topics too (NFC);
+              // a frame is added to the history once, by its sequence number
+              const frameKey = snapshot.sequence != null
+                ? `${snapshot.device_id}:${snapshot.boot}:${snapshot.sequence}`
+                : null;
+              if (frameKey === null || frameKey !== lastFrameKey.current) {
+                lastFrameKey.current = frameKey;
+                // Add to history (keep last 20 entries)
+                setHistory(prev => {
+                  const newEntry = {
+                    ...snapshot,
+                    time: now.toLocaleTimeString(),
+                    timestamp: now.getTime()
+                  };
+                  return [newEntry, ...prev].slice(0, 20);
+                });
+              }
             }
-            // Optionally handle other types
           } catch (e) {
             // ignore parse errors
           }
@@ -237,7 +210,7 @@ const BottleDashboardPage = () => {
           console.log('WebSocket closed');
         });
       } catch (e) {
-        console.warn('Failed to connect WebSocket for NFC updates', e);
+        console.warn('Failed to connect WebSocket for pallet and NFC updates', e);
       }
 
       return () => {
@@ -1,18 +1,26 @@
 const MQTT_BROKER = 'mqtts://broker.hivemq.com';
 const MQTT_PORT = 8883;
 
+// Pallets publish on bottle-scale/<site>/<device_id>/<stream>
+const MQTT_SITE = process.env.MQTT_SITE || 'main';
+
 const MQTT_TOPICS = [
+  `bottle-scale/${MQTT_SITE}/+/frame`,
+  `bottle-scale/${MQTT_SITE}/+/samples`,
+  `bottle-scale/${MQTT_SITE}/+/cmd-response`,
+  `bottle-scale/${MQTT_SITE}/+/nfc/vehicle-id`,
+  `bottle-scale/${MQTT_SITE}/+/nfc/transaction`,
+  // Shared text topics of firmware built with MQTT_LEGACY_TOPICS
   'bottle-scale/weight',
   'bottle-scale/bottles',
   'bottle-scale/status',
-  'bottle-scale/data',
-  'bottle-scale/nfc/vehicle-id',
-  'bottle-scale/nfc/transaction'
+  'bottle-scale/data'
 ];
 
 module.exports = {
   MQTT_BROKER,
   MQTT_PORT,
+  MQTT_SITE,
   MQTT_TOPICS,
   CLIENT_ID_PREFIX: 'bottle-scale-server',
   RECONNECT_PERIOD: 1000,
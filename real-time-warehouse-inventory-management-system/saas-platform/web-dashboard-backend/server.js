@@ -4,6 +4,7 @@ const express = require('express');
 const cors = require('cors');
 const WebSocket = require('ws');
 const http = require('http');
+const { decodeSnapshot, decodeSampleWindow } = require('./utils/telemetryFrame');
 
 const app = express();
 const server = http.createServer(app);
@@ -16,15 +17,42 @@ app.use(express.static('public'));
 
 // MQTT Configuration
 const MQTT_BROKER = 'mqtt://broker.hivemq.com';
+// Pallets publish on bottle-scale/<site>/<device_id>/<stream>; this server
+// follows every pallet of one site through single-level wildcards
+const MQTT_SITE = process.env.MQTT_SITE || 'main';
+const MQTT_SITE_ROOT = `bottle-scale/${MQTT_SITE}/`;
+const COMMAND_NAMES = ['tare', 'calibrate', 'set_interval', 'set_deadband', 'set_unit_weight', 'reboot', 'stats', 'trace'];
 const MQTT_TOPICS = [
+  MQTT_SITE_ROOT + '+/frame',
+  MQTT_SITE_ROOT + '+/samples',
+  MQTT_SITE_ROOT + '+/cmd-response',
+  MQTT_SITE_ROOT + '+/nfc/vehicle-id',
+  MQTT_SITE_ROOT + '+/nfc/transaction',
+  // Shared text topics of firmware built with MQTT_LEGACY_TOPICS
   'bottle-scale/weight',
   'bottle-scale/bottles',
   'bottle-scale/status',
-  'bottle-scale/data',
-  'bottle-scale/nfc/vehicle-id',
-  'bottle-scale/nfc/transaction'
+  'bottle-scale/data'
 ];
 
+// bottle-scale/<site>/<device_id>/<stream> -> { deviceId, stream }; null
+// for the shared legacy topics
+function parseDeviceTopic(topic) {
+  if (!topic.startsWith(MQTT_SITE_ROOT)) {
+    return null;
+  }
+  const rest = topic.substring(MQTT_SITE_ROOT.length);
+  const slash = rest.indexOf('/');
+  if (slash <= 0) {
+    return null;
+  }
+  return { deviceId: rest.substring(0, slash), stream: rest.substring(slash + 1) };
+}
+
+function deviceTopic(deviceId, stream) {
+  return `${MQTT_SITE_ROOT}${deviceId}/${stream}`;
+}
+
 // Data storage
 let latestData = {
   weight_g: 0,
@@ -37,6 +65,12 @@ let latestData = {
 
 let dataHistory = [];
 let nfcTransactions = []; // recent NFC transactions (in-memory)
+let seenTransactionIds = new Map(); // device_id:tx_id -> received time, for dropping resends
+const MAX_SEEN_TRANSACTION_IDS = 10000;
+let sampleWindows = []; // recent full-rate sample windows (firmware built with SAMPLE_BATCHING)
+let frameStreams = new Map(); // device_id -> { boot, sequence }, for gap detection
+let framesLost = 0;
+let commandResponses = []; // recent remote command responses, newest first
 let connectedClients = new Set();
 let mqttConnected = false;
 
@@ -66,10 +100,77 @@ mqttClient.on('connect', () => {
 });
 
 mqttClient.on('message', (topic, message) => {
-  const messageStr = message.toString();
   const timestamp = Date.now();
   const updateTime = new Date().toISOString();
+  const device = parseDeviceTopic(topic);
+  const stream = device ? device.stream : null;
   
+  // Binary snapshot frame - one per publish cycle from current firmware
+  if (stream === 'frame') {
+    try {
+      const snapshot = decodeSnapshot(message);
+      console.log(`📨 MQTT: ${topic} = ${snapshot.weight_g}g, ${snapshot.bottles} bottles, ${snapshot.status}`);
+      trackFrameSequence(device.deviceId, snapshot);
+      latestData = {
+        ...snapshot,
+        device_id: device.deviceId,
+        timestamp: timestamp,
+        lastUpdate: updateTime
+      };
+      dataHistory.unshift({
+        ...latestData,
+        id: timestamp
+      });
+      if (dataHistory.length > 100) {
+        dataHistory = dataHistory.slice(0, 100);
+      }
+      broadcastToClients(latestData);
+    } catch (error) {
+      console.error('❌ Invalid telemetry frame:', error.message);
+    }
+    return;
+  }
+  
+  // Full-rate sample window - kept for analytics, not logged per message
+  if (stream === 'samples') {
+    try {
+      const sampleWindow = decodeSampleWindow(message);
+      sampleWindow.device_id = device.deviceId;
+      sampleWindow.receivedAt = updateTime;
+      sampleWindows.unshift(sampleWindow);
+      if (sampleWindows.length > 300) {
+        sampleWindows = sampleWindows.slice(0, 300);
+      }
+    } catch (error) {
+      console.error('❌ Invalid sample window:', error.message);
+    }
+    return;
+  }
+  
+  // Remote command response - correlated to its request by id
+  if (stream === 'cmd-response') {
+    try {
+      const response = JSON.parse(message.toString());
+      response.device_id = device.deviceId;
+      response.receivedAt = updateTime;
+      console.log(`📟 Command ${response.id} on ${response.device_id}: ${response.ok ? 'ok' : response.error}`);
+      commandResponses.unshift(response);
+      if (commandResponses.length > 200) {
+        commandResponses = commandResponses.slice(0, 200);
+      }
+      const responseMsg = JSON.stringify({ type: 'command_response', data: response });
+      connectedClients.forEach(client => {
+        if (client.readyState === WebSocket.OPEN) {
+          try { client.send(responseMsg); } catch (e) { connectedClients.delete(client); }
+        }
+      });
+    } catch (error) {
+      console.error('❌ Invalid command response:', error.message);
+    }
+    return;
+  }
+  
+  const messageStr = message.toString();
   console.log(`📨 MQTT: ${topic} = ${messageStr}`);
   
   try {
@@ -82,8 +183,9 @@ mqttClient.on('message', (topic, message) => {
         lastUpdate: updateTime
       };
     } else {
-      // Handle individual topic updates
-      const field = topic.split('/')[1];
+      // Handle individual topic updates: the legacy field name, or the
+      // first level of a device stream (nfc)
+      const field = stream ? stream.split('/')[0] : topic.split('/')[1];
       let value = messageStr;
       
       // Convert numeric fields
@@ -113,9 +215,27 @@ mqttClient.on('message', (topic, message) => {
     broadcastToClients(latestData);
 
     // If this is an NFC topic, handle specially
-    if (topic === 'bottle-scale/nfc/transaction') {
+    if (stream === 'nfc/transaction') {
       try {
         const tx = JSON.parse(messageStr);
+
+        // Firmware resends a transaction until its tx_id is acknowledged, so
+        // acknowledge every copy but record only the first
+        if (tx.tx_id && tx.device_id) {
+          mqttClient.publish(deviceTopic(tx.device_id, 'nfc/ack'), tx.tx_id, { qos: 1 });
+
+          const key = `${tx.device_id}:${tx.tx_id}`;
+          if (seenTransactionIds.has(key)) {
+            console.log(`↩️ Duplicate NFC transaction ${key} acknowledged again`);
+            return;
+          }
+          seenTransactionIds.set(key, timestamp);
+          if (seenTransactionIds.size > MAX_SEEN_TRANSACTION_IDS) {
+            // Maps iterate in insertion order: forget the oldest
+            seenTransactionIds.delete(seenTransactionIds.keys().next().value);
+          }
+        }
+
         // Preserve MCU original timestamp if present
         if (tx.timestamp) {
           tx.originalTimestamp = tx.timestamp;
@@ -236,6 +356,21 @@ app.get('/api/history', (req, res) => {
   });
 });
 
+// Frames are numbered per device and boot; a jump in sequence within one
+// boot means frames were lost between the device and here
+function trackFrameSequence(deviceId, snapshot) {
+  if (snapshot.sequence === null) {
+    return;
+  }
+  const last = frameStreams.get(deviceId);
+  if (last && snapshot.boot === last.boot && snapshot.sequence > last.sequence + 1) {
+    const lost = snapshot.sequence - last.sequence - 1;
+    framesLost += lost;
+    console.warn(`⚠️ ${lost} telemetry frame(s) lost from ${deviceId} (boot ${snapshot.boot}, sequence ${snapshot.sequence})`);
+  }
+  frameStreams.set(deviceId, { boot: snapshot.boot, sequence: snapshot.sequence });
+}
+
 // Get system status
 app.get('/api/status', (req, res) => {
   res.json({
@@ -246,6 +381,8 @@ app.get('/api/status', (req, res) => {
       uptime: process.uptime(),
       memoryUsage: process.memoryUsage(),
       dataPoints: dataHistory.length,
+      devices: frameStreams.size,
+      framesLost: framesLost,
       lastUpdate: latestData.lastUpdate
     }
   });
@@ -296,6 +433,42 @@ app.get('/api/nfc/transactions', (req, res) => {
   res.json({ success: true, data: nfcTransactions.slice(0, limit), total: nfcTransactions.length });
 });
 
+// Full-rate sample windows - recent, newest first
+app.get('/api/samples', (req, res) => {
+  const limit = Math.min(parseInt(req.query.limit) || 60, 300);
+  res.json({ success: true, data: sampleWindows.slice(0, limit), total: sampleWindows.length });
+});
+
+// Remote commands - body { cmd, value? }; deviceId is the firmware client ID
+// (BottleScale_<MAC>) or 'all' for every pallet of the site. The response arrives asynchronously on
+// /api/commands and the WebSocket, matched by the returned id.
+app.post('/api/devices/:deviceId/commands', (req, res) => {
+  const { cmd, value } = req.body || {};
+  if (!COMMAND_NAMES.includes(cmd)) {
+    return res.status(400).json({ success: false, message: `cmd must be one of ${COMMAND_NAMES.join(', ')}` });
+  }
+  if (value !== undefined && !Number.isInteger(value)) {
+    return res.status(400).json({ success: false, message: 'value must be an integer' });
+  }
+  if (!mqttConnected) {
+    return res.status(500).json({ success: false, message: 'MQTT not connected' });
+  }
+  
+  // Firmware echoes up to 23 characters of id
+  const id = `${Date.now().toString(36)}${Math.random().toString(36).substr(2, 6)}`;
+  const command = value === undefined ? { id, cmd } : { id, cmd, value };
+  const topic = deviceTopic(req.params.deviceId, 'cmd');
+  mqttClient.publish(topic, JSON.stringify(command), { qos: 1 });
+  res.json({ success: true, id: id, topic: topic, command: command });
+});
+
+// Remote command responses - recent, newest first; ?id= filters to one request
+app.get('/api/commands', (req, res) => {
+  const limit = Math.min(parseInt(req.query.limit) || 50, 200);
+  const matching = req.query.id ? commandResponses.filter(r => r.id === req.query.id) : commandResponses;
+  res.json({ success: true, data: matching.slice(0, limit), total: matching.length });
+});
+
 // Clear history (useful for testing)
 app.delete('/api/history', (req, res) => {
   dataHistory = [];
@@ -0,0 +1,123 @@
+// telemetryFrame.js - Decoders for the binary frame and samples payloads
+// Mirrors lib/PalletTelemetry/src/telemetry_frame.h and sample_window.h in
+// the firmware tree.
+
+const SCHEMA_SNAPSHOT = 0x01;
+const SCHEMA_SAMPLE_WINDOW = 0x02;
+const SAMPLE_WINDOW_HEADER_SIZE = 32;
+const SAMPLE_WINDOW_TRAILER_SIZE = 12;
+const SNAPSHOT_V1_SIZE = 23;
+const SNAPSHOT_V2_SIZE = 28;
+const SNAPSHOT_SIZE = 48;
+const CLOCK_AGE_UNKNOWN = 0xFFFF;
+const UID_MAX_LENGTH = 7;
+
+const STATUS_NAMES = ['idle', 'loading', 'unloading'];
+const NFC_STATE_NAMES = ['idle', 'load_ready', 'load_complete', 'unload_ready', 'unload_complete'];
+const REPORT_REASON_NAMES = ['none', 'first', 'count', 'state', 'weight', 'heartbeat'];
+const SAMPLE_UNIT_NAMES = ['raw', 'decigram'];
+
+// 0 means the device clock was not synced
+function epochOrNull(value) {
+  return value === 0n ? null : Number(value);
+}
+
+// Returns the snapshot in the same shape the old bottle-scale/data JSON had,
+// or throws if the frame is truncated or uses a schema this decoder does not know.
+function decodeSnapshot(buffer) {
+  if (buffer.length < 2) {
+    throw new Error(`telemetry frame too short (${buffer.length} bytes)`);
+  }
+  if (buffer[0] !== SCHEMA_SNAPSHOT) {
+    throw new Error(`unknown telemetry schema 0x${buffer[0].toString(16)}`);
+  }
+  // Newer versions only append fields - anything past the known layout is skipped
+  const version = buffer[1];
+  if (buffer.length < SNAPSHOT_V1_SIZE || (version >= 2 && buffer.length < SNAPSHOT_V2_SIZE) ||
+      (version >= 3 && buffer.length < SNAPSHOT_SIZE)) {
+    throw new Error(`telemetry frame too short (${buffer.length} bytes)`);
+  }
+
+  const uidLength = buffer[15];
+  if (uidLength > UID_MAX_LENGTH) {
+    throw new Error(`bad vehicle UID length ${uidLength}`);
+  }
+
+  const weightG = buffer.readInt32LE(6);
+  return {
+    schema_version: version,
+    weight_g: weightG,
+    weight_oz: Math.round((weightG / 28.34952) * 100) / 100,
+    bottles: buffer.readInt16LE(10),
+    status: STATUS_NAMES[buffer[12]] || 'idle',
+    nfc_state: NFC_STATE_NAMES[buffer[13]] || 'idle',
+    open_transactions: buffer[14],
+    vehicle_id: buffer.subarray(16, 16 + uidLength).toString('hex').toUpperCase(),
+    // Report-by-exception: why this frame was sent and how many were skipped
+    report_reason: version >= 2 ? (REPORT_REASON_NAMES[buffer[23]] || 'none') : 'none',
+    suppressed: version >= 2 ? buffer.readUInt32LE(24) : 0,
+    device_timestamp: buffer.readUInt32LE(2),
+    // Wall clock and numbering: epoch_ms is null until the device has synced
+    epoch_ms: version >= 3 ? epochOrNull(buffer.readBigUInt64LE(28)) : null,
+    boot: version >= 3 ? buffer.readUInt32LE(36) : null,
+    sequence: version >= 3 ? buffer.readUInt32LE(40) : null,
+    clock_age_s: version >= 3 && buffer.readUInt16LE(44) !== CLOCK_AGE_UNKNOWN ? buffer.readUInt16LE(44) : null,
+    drift_ppm: version >= 3 ? buffer.readInt16LE(46) : null
+  };
+}
+
+// Returns the window statistics and the unpacked samples (first sample
+// absolute, the rest deltas from their predecessor), or throws.
+function decodeSampleWindow(buffer) {
+  if (buffer.length < SAMPLE_WINDOW_HEADER_SIZE + 4) {
+    throw new Error(`sample window too short (${buffer.length} bytes)`);
+  }
+  if (buffer[0] !== SCHEMA_SAMPLE_WINDOW) {
+    throw new Error(`unknown telemetry schema 0x${buffer[0].toString(16)}`);
+  }
+
+  const count = buffer.readUInt16LE(12);
+  const width = buffer[15];
+  if (count === 0 || (width !== 2 && width !== 4)) {
+    throw new Error(`bad sample window (count ${count}, width ${width})`);
+  }
+  const needed = SAMPLE_WINDOW_HEADER_SIZE + 4 + (count - 1) * width;
+  const version = buffer[1];
+  const trailer = version >= 2 ? SAMPLE_WINDOW_TRAILER_SIZE : 0;
+  if (buffer.length < needed + trailer) {
+    throw new Error(`sample window too short (${buffer.length} of ${needed + trailer} bytes)`);
+  }
+
+  const samples = new Array(count);
+  let value = buffer.readInt32LE(SAMPLE_WINDOW_HEADER_SIZE);
+  samples[0] = value;
+  for (let i = 1; i < count; i++) {
+    const offset = SAMPLE_WINDOW_HEADER_SIZE + 4 + (i - 1) * width;
+    value = (value + (width === 2 ? buffer.readInt16LE(offset) : buffer.readInt32LE(offset))) | 0;
+    samples[i] = value;
+  }
+
+  return {
+    schema_version: version,
+    boot: version >= 2 ? buffer.readUInt32LE(needed) : null,
+    window: buffer.readUInt32LE(2),
+    start_ms: buffer.readUInt32LE(6),
+    start_epoch_ms: version >= 2 ? epochOrNull(buffer.readBigUInt64LE(needed + 4)) : null,
+    span_ms: buffer.readUInt16LE(10),
+    count: count,
+    unit: SAMPLE_UNIT_NAMES[buffer[14]] || 'unknown',
+    min: buffer.readInt32LE(16),
+    max: buffer.readInt32LE(20),
+    mean: buffer.readFloatLE(24),
+    variance: buffer.readFloatLE(28),
+    samples: samples
+  };
+}
+
+module.exports = {
+  SCHEMA_SNAPSHOT,
+  SCHEMA_SAMPLE_WINDOW,
+  SNAPSHOT_SIZE,
+  decodeSnapshot,
+  decodeSampleWindow
+};
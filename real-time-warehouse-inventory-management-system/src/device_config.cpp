@@ -0,0 +1,70 @@
+/*
+ * Runtime config store - one NVS key per setting, defaults from the build
+ */
+
+#include "device_config.h"
+#include <Preferences.h>
+
+struct ConfigKeyInfo {
+  const char* name;                      // Command key and NVS key (max 15 chars)
+  int32_t min;
+  int32_t max;
+};
+
+static const ConfigKeyInfo config_keys[CONFIG_KEY_COUNT] = {
+  { "interval", DEVICE_CONFIG_INTERVAL_MIN, DEVICE_CONFIG_INTERVAL_MAX },
+  { "deadband", DEVICE_CONFIG_DEADBAND_MIN, DEVICE_CONFIG_DEADBAND_MAX },
+  { "unit_weight", DEVICE_CONFIG_UNIT_WEIGHT_MIN, DEVICE_CONFIG_UNIT_WEIGHT_MAX },
+};
+
+static DeviceConfig config;
+static Preferences config_preferences;
+
+static int32_t* valueFor(DeviceConfigKey key) {
+  switch (key) {
+    case CONFIG_PUBLISH_INTERVAL: return (int32_t*)&config.publish_interval;
+    case CONFIG_WEIGHT_DEADBAND: return &config.weight_deadband;
+    case CONFIG_UNIT_WEIGHT: return &config.unit_weight_g;
+    default: return NULL;
+  }
+}
+
+void deviceConfigBegin(const DeviceConfig* defaults) {
+  config = *defaults;
+  config_preferences.begin(DEVICE_CONFIG_NAMESPACE, false);
+
+  // A stored value outside today's range (e.g. after the limits changed)
+  // falls back to the default
+  for (int i = 0; i < CONFIG_KEY_COUNT; i++) {
+    int32_t* value = valueFor((DeviceConfigKey)i);
+    int32_t stored = config_preferences.getInt(config_keys[i].name, *value);
+    if (stored >= config_keys[i].min && stored <= config_keys[i].max) {
+      *value = stored;
+    }
+  }
+
+  Serial.printf("⚙️ Config: interval %lu ms, deadband %ld g, unit weight %ld g\n",
+                (unsigned long)config.publish_interval, (long)config.weight_deadband,
+                (long)config.unit_weight_g);
+}
+
+const DeviceConfig* deviceConfig() {
+  return &config;
+}
+
+DeviceConfigResult deviceConfigSet(DeviceConfigKey key, int32_t value) {
+  int32_t* target = valueFor(key);
+  if (target == NULL || value < config_keys[key].min || value > config_keys[key].max) {
+    return CONFIG_OUT_OF_RANGE;
+  }
+
+  *target = value;
+  if (config_preferences.putInt(config_keys[key].name, value) != sizeof(int32_t)) {
+    return CONFIG_NOT_SAVED;
+  }
+  return CONFIG_OK;
+}
+
+const char* deviceConfigKeyName(DeviceConfigKey key) {
+  return key < CONFIG_KEY_COUNT ? config_keys[key].name : "unknown";
+}
@@ -7,7 +7,7 @@
  * Features:
  * - Load cell calibration with 172g weight
  * - OLED display showing weight and bottle count
- * - Bottle count = round(total_weight / 275g)
+ * - Bottle count = round(total_weight / 275g), bottle weight tunable over MQTT
  * - Calibration factor stored in flash memory
  * - WiFi and MQTT connectivity with proper timing
  * - Status tracking: "loading" when bottles decrease, "unloading" when bottles increase
@@ -31,11 +31,36 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <PubSubClient.h>
 #include <WiFi.h>
 #include <WiFiManager.h>
 #include <Adafruit_PN532.h>
 #include <SPI.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "nfc_transactions.h"
+#include "nfc_presence.h"
+#include "nfc_readers.h"
+#include "weight_history.h"
+#include "transaction_queue.h"
+#include "device_config.h"
+#include "remote_commands.h"
+#include "telemetry_frame.h"
+#include "json_template.h"
+#include "pallet_payloads.h"
+#include "report_policy.h"
+#include "sample_window.h"
+#include "wifi_link.h"
+#include "mqtt_link.h"
+#include "device_clock.h"
+#include "oled_screen.h"
+#include "oled_panel.h"
+#include "oled_task.h"
+#include "stage_timer.h"
+#include "event_trace.h"
 
 // HX711 Pin Configuration
 #define LOADCELL_DOUT_PIN 5
@@ -46,6 +71,9 @@
 #define SCREEN_HEIGHT 64
 #define OLED_RESET    -1
 #define SCREEN_ADDRESS 0x3C
+#ifndef OLED_I2C_CLOCK
+#define OLED_I2C_CLOCK 400000              // 1000000 works on short wiring to the module
+#endif
 
 // NFC PN532 Pin Configuration (SPI)
 #define PN532_SCK  (14)
@@ -53,6 +81,11 @@
 #define PN532_SS   (15)
 #define PN532_MISO (12)
 
+// Additional readers (far side of the pallet) share SCK/MOSI/MISO and use
+// their own chip-select; wire IRQ to make a reader fully asynchronous.
+// #define PN532_SS_2  (4)
+// #define PN532_IRQ_2 (34)
+
 // LED Pin Configuration
 #define LED_RED_PIN    25
 #define LED_GREEN_PIN  26
@@ -60,97 +93,345 @@
 
 // Calibration weight configuration
 #define weight_of_object_for_calibration 172
-#define BOTTLE_WEIGHT 275
+#define BOTTLE_WEIGHT 275               // Default; set_unit_weight overrides it (device_config.h)
 
 // NFC Configuration
-#define NFC_TIMEOUT 1000  // 1 second timeout for NFC operations
 #define DOUBLE_TAP_WINDOW 3000  // 3 seconds window for double tap detection
 
-// MQTT Topics
+// Telemetry Configuration - each cycle publishes one binary frame on
+// mqtt_topic_frame. Build with -DMQTT_LEGACY_TOPICS=1 to also publish the
+// old per-field text topics, at their old shared names, for consumers that
+// have not moved to the frame.
+#ifndef MQTT_LEGACY_TOPICS
+#define MQTT_LEGACY_TOPICS 0
+#endif
+
+// Report-by-exception - a frame goes out when the bottle count, status or
+// NFC state changes or the weight drifts past the deadband; otherwise only
+// a heartbeat. Set the heartbeat to 3000 for the old fixed 3 s clock.
+#define REPORT_WEIGHT_DEADBAND 50          // grams of drift reported without a count change
+#define REPORT_HEARTBEAT_INTERVAL 300000   // Publish at least every 5 minutes
+#define REPORT_MIN_INTERVAL 1000           // At most one change report per second
+// The deadband and heartbeat above are defaults; set_deadband and
+// set_interval change them at runtime (remote_commands.h)
+
+// Remote commands
+#define REMOTE_CALIBRATION_MIN_COUNTS 1000 // HX711 counts above the tare a reference weight must give
+#define REMOTE_REBOOT_DELAY 2000           // ms for the reboot response to go out first
+#define REMOTE_RESPONSE_JSON_CAPACITY 768  // StaticJsonDocument pool for the largest response (stats)
+
+// Sample batching - build with -DSAMPLE_BATCHING=1 to also publish every
+// HX711 conversion, in fixed windows with min/max/mean/variance, on
+// mqtt_topic_samples (layout in sample_window.h). The HX711 converts at
+// 10 SPS with its RATE pin low and 80 SPS with it high; the acquisition task
+// then averages the newest conversions instead of taking its own.
+#ifndef SAMPLE_BATCHING
+#define SAMPLE_BATCHING 0
+#endif
+#define SAMPLE_WINDOW_DURATION 1000        // ms per window
+#define SAMPLE_BATCH_UNIT SAMPLE_UNIT_DECIGRAM  // SAMPLE_UNIT_RAW for counts before tare/scale
+#define SAMPLE_AVERAGE_COUNT 3             // Conversions per weight reading, as get_units(3)
+
+// Diagnostics on mqtt_topic_diag every DIAG_REPORT_INTERVAL: the heap
+// (free, low watermark, largest free block) and, built with
+// -DSTAGE_TIMING=1, the histograms of the HX711, NFC, display and MQTT
+// stages (stage_timer.h) since the last report
+#define DIAG_REPORT_INTERVAL 60000
+#define HEAP_LOW_BLOCK 8192                // Warn when the largest free block shrinks below this
+
+// Event trace - build with -DEVENT_TRACE=1 to record begin/end events of the
+// HX711 reads, NFC polls, MQTT publishes, OLED flushes and WiFi changes
+// (event_trace.h). 'T' on the serial console dumps the whole ring; the
+// trace remote command publishes the newest events on mqtt_topic_trace,
+// never filling more than half the outbox so telemetry is not overwritten.
+#define TRACE_MQTT_EVENTS 2048             // Default for the trace command
+#define TRACE_UPLOAD_WAIT 20               // ms between outbox checks
+#define TRACE_UPLOAD_TIMEOUT 5000          // Gives up when the outbox stays half full this long
+
+// FreeRTOS tasks - each subsystem runs on its own task, and they share
+// nothing but scale_queue, system_events and the HX711 mutex:
+//   acquisition  HX711 conversions, one weight reading per hx711ReadingInterval
+//   nfc          readers, transactions, bottle count and telemetry; owns the inventory state
+//   console      serial P/C calibration and remote commands
+//   network      MQTT on core 0 (mqtt_link.h)
+//   ui           OLED drawing (oled_task.h)
+// Acquisition has the highest priority so a reading starts when it falls
+// due whatever the others are doing. It sleeps between DOUT checks, so the
+// core is free while the HX711 converts.
+#define ACQUISITION_TASK_PRIORITY 5
+#define NFC_TASK_PRIORITY 4
+#define CONSOLE_TASK_PRIORITY 2            // Above the OLED task only
+#define APP_TASK_CORE 1                    // Application core; the WiFi stack and MQTT task have core 0
+#define ACQUISITION_TASK_STACK_SIZE 4096
+#define NFC_TASK_STACK_SIZE 8192
+#define CONSOLE_TASK_STACK_SIZE 8192       // Holds the command response document
+#define SCALE_QUEUE_LENGTH 8               // Readings and scale changes waiting for the NFC task
+#define HX711_READY_POLL 2                 // ms between DOUT checks while a conversion is pending
+#define HX711_READY_TIMEOUT 500            // ms a conversion may take before the reading fails
+#define NFC_TASK_WAIT 20                   // ms the NFC task waits for a reading between reader polls
+#define NFC_EXPIRY_INTERVAL 250            // ms between transaction resolve/expiry passes
+#define CONSOLE_POLL_INTERVAL 50           // ms between serial input checks
+
+// system_events bits
+#define EVENT_CALIBRATED (1 << 0)          // Scale has a factor; NFC taps are accepted
+#define EVENT_WEIGHING (1 << 1)            // Acquisition takes readings; cleared while the console has the HX711
+#define EVENT_SCALE_CHANGED (1 << 2)       // Tare or factor changed; conversions from before are stale
+#define EVENT_COMMAND_QUEUED (1 << 3)      // Remote command waiting for the console task
+
+// MQTT Topics - bottle-scale/<site>/<pallet>/<stream>, where <pallet> is
+// the client ID. Consumers choose with wildcards: bottle-scale/+/+/frame
+// for every pallet's frames, bottle-scale/<site>/<pallet>/# for one pallet.
+// A pallet subscribes only to its own nfc/ack and cmd topics and to the
+// site-wide all/cmd, never to other pallets' telemetry.
+#ifndef MQTT_SITE
+#define MQTT_SITE "main"                   // Build with -DMQTT_SITE='"dock-2"' per site
+#endif
+#define MQTT_TOPIC_ROOT "bottle-scale/" MQTT_SITE "/"
+#define MQTT_TOPIC_SIZE 96
+// PubSubClient packet buffer: fits a full sample window or command response
+// plus its per-pallet topic (the library default is 256 bytes)
+#define MQTT_BUFFER_SIZE 576
+
 const char* mqtt_client_id = "BottleScale_"; // Will append unique ID
+char mqtt_client_id_full[32];                // Prefix + MAC, built in setupMQTT()
+// MQTT_TOPIC_ROOT + client ID + stream, all built in setupMQTT()
+char mqtt_topic_frame[MQTT_TOPIC_SIZE];
+char mqtt_topic_samples[MQTT_TOPIC_SIZE];
+char mqtt_topic_diag[MQTT_TOPIC_SIZE];
+char mqtt_topic_trace[MQTT_TOPIC_SIZE];
+char mqtt_topic_nfc_vehicle[MQTT_TOPIC_SIZE];
+char mqtt_topic_nfc_transaction[MQTT_TOPIC_SIZE];
+char mqtt_topic_nfc_status[MQTT_TOPIC_SIZE];
+// The backend acknowledges each transaction by publishing its tx_id here
+char mqtt_topic_nfc_ack[MQTT_TOPIC_SIZE];
+// Remote commands (remote_commands.h): this pallet's and the whole site's,
+// with the responses on this pallet's cmd-response
+const char* mqtt_topic_command_all = MQTT_TOPIC_ROOT "all/cmd";
+char mqtt_topic_command[MQTT_TOPIC_SIZE];
+char mqtt_topic_command_response[MQTT_TOPIC_SIZE];
+#if MQTT_LEGACY_TOPICS
 const char* mqtt_topic_weight = "bottle-scale/weight";
 const char* mqtt_topic_bottles = "bottle-scale/bottles";
 const char* mqtt_topic_status = "bottle-scale/status";
 const char* mqtt_topic_data = "bottle-scale/data";
-const char* mqtt_topic_nfc_vehicle = "bottle-scale/nfc/vehicle-id";
-const char* mqtt_topic_nfc_transaction = "bottle-scale/nfc/transaction";
-const char* mqtt_topic_nfc_status = "bottle-scale/nfc/status";
+#endif
+
+// JSON payloads are laid out once and patched in place (json_template.h);
+// the schemas are shared with the test sketch and tools (pallet_payloads.h)
+static_assert(PAYLOAD_TX_ID_LENGTH == TXQ_ID_LENGTH - 1, "tx_id slot must fit a transaction ID");
+static_assert(PAYLOAD_VEHICLE_ID_LENGTH == NFC_UID_MAX_LENGTH * 2, "vehicle_id slot must fit a UID");
+static char nfc_transaction_json[JSON_TEMPLATE_SIZE(nfc_transaction_schema)];
+JsonTemplate nfc_transaction_payload(nfc_transaction_schema, nfc_transaction_json,
+                                     sizeof(nfc_transaction_json));
+// Same payload for the NFC task when the flash queue is unavailable; the
+// one above belongs to the network task
+static char nfc_direct_json[JSON_TEMPLATE_SIZE(nfc_transaction_schema)];
+JsonTemplate nfc_direct_payload(nfc_transaction_schema, nfc_direct_json, sizeof(nfc_direct_json));
+
+#if MQTT_LEGACY_TOPICS
+static char data_json[JSON_TEMPLATE_SIZE(data_schema)];
+JsonTemplate data_payload(data_schema, data_json, sizeof(data_json));
+#endif
+
+// OLED screens - fixed layouts of text fields (oled_screen.h); a refresh
+// redraws only the fields whose text changed and sends only the changed
+// bytes to the panel (oled_panel.h)
+enum WeightScreenField {
+  WEIGHT_SCREEN_TITLE, WEIGHT_SCREEN_WEIGHT_LABEL, WEIGHT_SCREEN_WEIGHT, WEIGHT_SCREEN_BOTTLES_LABEL,
+  WEIGHT_SCREEN_BOTTLES, WEIGHT_SCREEN_STATUS_LABEL, WEIGHT_SCREEN_STATUS, WEIGHT_SCREEN_NFC,
+  WEIGHT_SCREEN_VEHICLE
+};
+static constexpr OledField weight_screen[] = {
+  { 0, 0, 1, 21, "== SMART INVENTORY ==" },
+  { 0, 12, 1, 8, "Weight: " },
+  { 48, 12, 1, 13, NULL },
+  { 0, 22, 1, 9, "Bottles: " },
+  { 54, 22, 1, 12, NULL },
+  { 0, 32, 1, 8, "Status: " },
+  { 48, 32, 1, 13, NULL },
+  { 0, 42, 1, 21, NULL },                  // NFC state, blank when idle
+  { 0, 52, 1, 21, NULL },                  // Vehicle ID, first 8 characters
+};
+enum NFCScreenField { NFC_SCREEN_TITLE, NFC_SCREEN_VEHICLE, NFC_SCREEN_STATE, NFC_SCREEN_BOTTLES };
+static constexpr OledField nfc_screen[] = {
+  { 0, 0, 1, 21, "=== NFC SYSTEM ===" },
+  { 0, 16, 1, 21, NULL },
+  { 0, 24, 1, 21, NULL },
+  { 0, 40, 1, 21, NULL },
+};
+enum CalibrationScreenField { CALIBRATION_SCREEN_TITLE, CALIBRATION_SCREEN_STATUS, CALIBRATION_SCREEN_COUNTDOWN };
+static constexpr OledField calibration_screen[] = {
+  { 0, 0, 1, 21, "=== CALIBRATION ===" },
+  { 0, 16, 1, 21, NULL },
+  { 60, 32, 2, 3, NULL },
+};
+enum CalibratedScreenField { CALIBRATED_SCREEN_TITLE, CALIBRATED_SCREEN_FACTOR };
+static constexpr OledField calibrated_screen[] = {
+  { 0, 0, 1, 21, "=== CALIBRATED! ===" },
+  { 0, 16, 1, 21, NULL },
+  { 0, 32, 1, 21, "Scale ready!" },
+  { 0, 40, 1, 21, "Weighing bottles..." },
+};
+enum WelcomeScreenField { WELCOME_SCREEN_TITLE, WELCOME_SCREEN_CALIBRATION, WELCOME_SCREEN_BOTTLE };
+static constexpr OledField welcome_screen[] = {
+  { 0, 0, 1, 21, "== SMART INVENTORY ==" },
+  { 0, 16, 1, 21, "Calibration: 172g" },
+  { 0, 24, 1, 21, NULL },
+  { 0, 40, 1, 21, "Send 'P' to prepare" },
+  { 0, 48, 1, 21, "Send 'C' to calibrate" },
+};
+static constexpr OledField startup_screen[] = {
+  { 0, 0, 1, 21, "HX711 Scale System" },
+  { 0, 8, 1, 21, "Initializing..." },
+};
+static constexpr OledField hx711_error_screen[] = {
+  { 0, 20, 1, 21, "HX711 Communication" },
+  { 0, 28, 1, 21, "Error - Retrying..." },
+};
+
+// What the display task draws (oled_task.h): the posting task fills one on
+// its stack and posts a copy, the display task renders its own copy
+enum DisplayScreen {
+  DISPLAY_STARTUP, DISPLAY_WELCOME, DISPLAY_CALIBRATION, DISPLAY_CALIBRATED, DISPLAY_WEIGHT,
+  DISPLAY_NFC, DISPLAY_HX711_ERROR
+};
+struct DisplayState {
+  DisplayScreen screen;
+  NFCTransactionState nfc_state;
+  int32_t weight_g;
+  int32_t bottles;
+  int32_t unit_weight_g;
+  int32_t countdown;                       // Calibration countdown, 0 for none
+  float cal_factor;
+  uint8_t status;                          // current_status
+  char vehicle_id[VEHICLE_ID_LENGTH];
+  char message[OLED_FIELD_MAX_CHARS + 1];  // Calibration step
+};
+
+// Handed to the NFC task: readings from the acquisition task, scale
+// changes from the console
+enum ScaleEventType {
+  SCALE_READING,
+  SCALE_ZEROED,                            // Tared: count from zero
+  SCALE_CONFIG_CHANGED                     // Deadband, heartbeat or unit weight set
+};
+struct ScaleEvent {
+  ScaleEventType type;
+  long weight_g;
+  unsigned long sample_time;               // Middle of the conversion window, for tap-time lookups
+  uint32_t due_us;                         // micros() when the reading fell due
+};
+
+// Sample-to-publish latency: from the moment a reading falls due to its
+// frame being handed to the MQTT task (stats command)
+struct PublishLatency {
+  uint32_t frames;
+  uint32_t last_us;
+  uint32_t max_us;
+};
 
 // Variables for sensor readings and calibration
 long sensor_Reading_Results; 
 float CALIBRATION_FACTOR;
-bool show_Weighing_Results = false;
-bool calibration_completed = false;
+bool scale_tared = false;                    // Offset taken with an empty scale this boot
 int weight_In_g;
 float weight_In_oz;
 int bottle_count;
+int32_t count_unit_weight_g;                 // Unit weight bottle_count and the history use (NFC task)
 
 // Status tracking variables
 int previous_bottle_count = 0;
-String current_status = "idle";
+uint8_t current_status = TELEMETRY_STATUS_IDLE;  // TelemetryStatus, named by telemetryStatusName()
 bool status_changed = false;
 
-// NFC Transaction States
-enum NFCTransactionState {
-  NFC_IDLE,
-  NFC_LOAD_READY,
-  NFC_LOAD_COMPLETE,
-  NFC_UNLOAD_READY,
-  NFC_UNLOAD_COMPLETE
-};
-
-// NFC Variables
+// NFC Variables - open transactions live in the table (nfc_transactions.h);
+// these mirror the most recently tapped entry for display and telemetry
 NFCTransactionState nfc_state = NFC_IDLE;
-String current_vehicle_id = "";
-unsigned long last_nfc_tap_time = 0;
-unsigned long transaction_start_time = 0;
-int transaction_start_bottles = 0;
-bool waiting_for_double_tap = false;
-unsigned long double_tap_start_time = 0;
+char current_vehicle_id[VEHICLE_ID_LENGTH] = "";
 
 // Initialize libraries
 HX711 LOADCELL_HX711;
 Preferences preferences;
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, OLED_I2C_CLOCK, OLED_I2C_CLOCK);
+OledScreen screen(&display);
 Adafruit_PN532 nfc(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS);
+// Adafruit_PN532 nfc_rear(PN532_SCK, PN532_MISO, PN532_MOSI, PN532_SS_2);
 
-// MQTT Configuration - Fixed initialization
-WiFiClient espClient;
-PubSubClient mqttClient(espClient);  // Pass WiFi client to MQTT
+// PN532 readers polled round-robin (up to MAX_NFC_READERS)
+NFCReader nfc_readers[] = {
+  { "front", &nfc, NFC_NO_IRQ },
+  // { "rear", &nfc_rear, PN532_IRQ_2 },
+};
+const int nfc_reader_count = sizeof(nfc_readers) / sizeof(nfc_readers[0]);
 
 // Timing variables
-unsigned long lastDisplayUpdate = 0;
-unsigned long lastMQTTCheck = 0;
-unsigned long lastMQTTPublish = 0;
-unsigned long lastHX711Reading = 0;
-const unsigned long displayUpdateInterval = 1000;   // Slower display updates
-const unsigned long mqttCheckInterval = 10000;      // Check MQTT less frequently (10 seconds)
-const unsigned long mqttPublishInterval = 3000;     // Publish every 3 seconds
+const unsigned long displayUpdateInterval = 100;    // Only changed fields reach the panel
 const unsigned long hx711ReadingInterval = 800;     // HX711 reading interval
 
-// HX711 error handling
+// Task communication (see the task list at the top)
+QueueHandle_t scale_queue = NULL;            // ScaleEvent, to the NFC task
+EventGroupHandle_t system_events = NULL;     // EVENT_* bits
+SemaphoreHandle_t hx711_mutex = NULL;        // Held for one conversion, or by the console while calibrating
+
+// HX711 error handling (acquisition task)
 static int consecutive_failures = 0;
 const int MAX_CONSECUTIVE_FAILURES = 3;  // Reduced threshold
-
-// HX711 timing protection
-bool hx711_busy = false;
+uint32_t readings_dropped = 0;               // Scale queue full
+
+// Telemetry report-by-exception state and counters (NFC task)
+ReportPolicy report_policy;
+uint32_t frame_sequence = 0;                 // Snapshot frames built this boot
+PublishLatency publish_latency;
+uint32_t reading_due_us = 0;                 // Due time of the reading being reported
+
+// Remote command state (console task only)
+unsigned long reboot_requested_at = 0;       // 0 = no reboot pending
+
+#if SAMPLE_BATCHING
+// Window being filled, plus the newest conversions in grams for the
+// regular weight reading (acquisition task)
+SampleWindow sample_window;
+uint32_t sample_windows_published = 0;
+uint32_t sample_windows_dropped = 0;
+float recent_grams[SAMPLE_AVERAGE_COUNT];
+unsigned long recent_times[SAMPLE_AVERAGE_COUNT];
+int recent_count = 0;                    // Conversions since the last weight reading
+#endif
 
 // Function declarations
 void setupMQTT();
-void connectToBroker();
+void buildTopic(char* topic, const char* stream);
 void setupWiFi();
-void receviveCallback(char* topic, byte* payload, unsigned int length);
+void receviveCallback(char* topic, byte* payload, unsigned int length);  // Network task
+void drainTransactionQueue();                                           // Network task
+bool processRemoteCommand();
+void executeRemoteCommand(const RemoteCommand* command, JsonObject result, const char** error);
+void publishCommandResponse(const RemoteCommand* command, JsonDocument& response);
+#if EVENT_TRACE
+bool uploadTrace(uint32_t max_events, uint32_t* events, uint32_t* messages);
+#endif
 void updateStatus(int current_bottles);
-void publishMQTTData();
+bool readConversion(long* raw, float* grams, unsigned long timeout_ms);
+bool publishMQTTData(ReportReason reason);
+void reportTelemetry();
+#if SAMPLE_BATCHING
+void pollSampleBatch();
+void publishSampleWindow();
+#endif
 
 // NFC Function declarations
 void initializeNFC();
 void setLED(bool red, bool green, bool yellow);
 void clearAllLEDs();
-String readNFCCard();
-void processNFCTransaction(String vehicle_id);
-void handleNFCDoubleTap(String vehicle_id);
-void publishNFCTransaction(String vehicle_id, String transaction_type, int bottle_difference);
+void processNFCTransaction(const char* vehicle_id);
+void handleNFCDoubleTap(NFCTransaction* tx);
+void publishNFCStatus(const char* vehicle_id, const char* transaction_type);
+bool publishQueuedTransaction(const QueuedTransaction* tx);
+void formatTransactionPayload(JsonTemplate* payload, const QueuedTransaction* tx);
+void handleNFCTransactionComplete(const NFCTransaction* tx);
+void handleNFCTransactionTimeout(const NFCTransaction* tx);
+void handleNFCCardRemoved(const char* vehicle_id, unsigned long dwell_ms);
+void updateNFCIndicators();
 void displayNFCStatus();
 
 // LED Control Functions
@@ -172,43 +453,9 @@ void initializeNFC() {
   // Give module time to power up
   delay(1000);
   
-  nfc.begin();
-  delay(500);
-  
-  // Try multiple times with different approaches
-  bool nfc_found = false;
-  
-  for (int attempts = 0; attempts < 3; attempts++) {
-    Serial.print("NFC initialization attempt ");
-    Serial.print(attempts + 1);
-    Serial.println("/3...");
-    
-    uint32_t versiondata = nfc.getFirmwareVersion();
-    if (versiondata) {
-      Serial.println("✅ SUCCESS: PN532 found!");
-      Serial.print("Chip: PN5"); Serial.println((versiondata>>24) & 0xFF, HEX); 
-      Serial.print("Firmware version: "); Serial.print((versiondata>>16) & 0xFF, DEC); 
-      Serial.print('.'); Serial.println((versiondata>>8) & 0xFF, DEC);
-      
-      // Configure board to read RFID tags
-      nfc.SAMConfig();
-      Serial.println("NFC PN532 initialized successfully");
-      nfc_found = true;
-      break;
-    }
-    
-    Serial.println("❌ PN532 not found, retrying...");
-    
-    // Power cycle attempt
-    if (attempts == 1) {
-      Serial.println("Trying power cycle...");
-      delay(2000);
-      nfc.begin();
-      delay(1000);
-    }
-    
-    delay(1000);
-  }
+  int readers_found = nfcReadersBegin(nfc_readers, nfc_reader_count);
+  Serial.printf("NFC readers online: %d/%d\n", readers_found, nfc_reader_count);
+  bool nfc_found = readers_found > 0;
   
   if (!nfc_found) {
     Serial.println("❌ CRITICAL: PN532 not found after 3 attempts!");
@@ -238,217 +485,469 @@ void initializeNFC() {
   }
 }
 
-String readNFCCard() {
-  // Check if PN532 is available first
-  static bool nfc_available = true;
-  static unsigned long last_check = 0;
-  
-  // Check PN532 availability every 30 seconds if it was previously unavailable
-  if (!nfc_available && (millis() - last_check > 30000)) {
-    uint32_t versiondata = nfc.getFirmwareVersion();
-    if (versiondata) {
-      Serial.println("PN532 reconnected!");
-      nfc_available = true;
+void processNFCTransaction(const char* vehicle_id) {
+  unsigned long current_time = millis();
+  NFCTransaction* tx = nfcTransactionFind(vehicle_id);
+  
+  if (nfcTransactionIsOpen(tx)) {
+    if (tx->state == NFC_LOAD_READY && current_time - tx->start_time < DOUBLE_TAP_WINDOW) {
+      // Second tap shortly after opening - this vehicle is unloading
+      handleNFCDoubleTap(tx);
+    } else {
+      // Closing tap - the result is published once the weight at this tap
+      // has been looked up (next sample), see handleNFCTransactionComplete()
+      nfcTransactionClose(tx, current_time, bottle_count);
+      Serial.printf("%s TRANSACTION CLOSED\n", nfcTransactionType(tx));
+      Serial.printf("Vehicle ID: %s\n", vehicle_id);
     }
-    last_check = millis();
-  }
-  
-  if (!nfc_available) {
-    return "";
+  } else {
+    // First tap - initiate loading transaction
+    tx = nfcTransactionOpen(vehicle_id, NFC_LOAD_READY, current_time, bottle_count);
+    if (tx == NULL) {
+      Serial.printf("Transaction table full (%d open) - tap ignored\n", MAX_OPEN_TRANSACTIONS);
+      return;
+    }
+    
+    Serial.println("LOAD TRANSACTION STARTED");
+    Serial.printf("Vehicle ID: %s\n", vehicle_id);
+    Serial.printf("Open transactions: %d\n", nfcTransactionsOpenCount());
+    Serial.println("Ready to load bottles...");
   }
   
-  uint8_t success;
-  uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0 };
-  uint8_t uidLength;
-  
-  success = nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, NFC_TIMEOUT);
+  updateNFCIndicators();
+}
+
+void handleNFCDoubleTap(NFCTransaction* tx) {
+  // Double tap detected - the transaction opened by the first tap becomes an
+  // unload; its start snapshot and attributed changes are kept
+  tx->state = NFC_UNLOAD_READY;
+  tx->last_tap_time = millis();
   
-  if (success) {
-    String vehicle_id = "";
-    for (uint8_t i = 0; i < uidLength; i++) {
-      if (uid[i] < 0x10) vehicle_id += "0";
-      vehicle_id += String(uid[i], HEX);
-    }
-    vehicle_id.toUpperCase();
-    return vehicle_id;
+  Serial.println("UNLOAD TRANSACTION STARTED");
+  Serial.printf("Vehicle ID: %s\n", tx->vehicle_id);
+  Serial.println("Ready to unload bottles...");
+}
+
+void handleNFCTransactionComplete(const NFCTransaction* tx) {
+  int bottle_difference = nfcTransactionBottleDifference(tx);
+  const char* transaction_type = nfcTransactionType(tx);
+  
+  Serial.printf("%s TRANSACTION COMPLETED\n", transaction_type);
+  Serial.printf("Vehicle ID: %s\n", tx->vehicle_id);
+  Serial.printf("Bottles %s: %d (count %d -> %d%s)\n",
+                tx->state == NFC_LOAD_COMPLETE ? "loaded" : "unloaded", bottle_difference,
+                tx->start_bottles, tx->end_bottles, tx->overlapped ? ", shared pallet" : "");
+  
+  publishNFCStatus(tx->vehicle_id, transaction_type);
+  
+  // Results go to flash first and are published from the queue, so one
+  // completed during a WiFi dropout or before a reboot is not lost
+  QueuedTransaction queued;
+  queued.completed_at = tx->end_time;      // The closing tap, not when the result settled
+  queued.completed_epoch_ms = deviceClockEpochMs(queued.completed_at);
+  queued.boot_tag = (uint8_t)deviceClockBootCount();
+  strncpy(queued.vehicle_id, tx->vehicle_id, VEHICLE_ID_LENGTH - 1);
+  queued.vehicle_id[VEHICLE_ID_LENGTH - 1] = '\0';
+  queued.type = (tx->state == NFC_UNLOAD_COMPLETE) ? TXQ_UNLOAD : TXQ_LOAD;
+  queued.bottle_count = bottle_difference;
+  queued.total_bottles = bottle_count;
+  
+  if (txQueueAppend(&queued)) {
+    Serial.printf("Transaction #%lu queued (%lu pending)\n", (unsigned long)queued.sequence,
+                  (unsigned long)txQueuePending());
   } else {
-    // Check if PN532 is still responding
-    static unsigned long last_health_check = 0;
-    if (millis() - last_health_check > 10000) { // Check every 10 seconds
-      uint32_t versiondata = nfc.getFirmwareVersion();
-      if (!versiondata) {
-        Serial.println("PN532 communication lost!");
-        nfc_available = false;
-      }
-      last_health_check = millis();
+    // Flash queue unavailable - hand it to the network task, which never
+    // drops transactions from its outbox (only a reboot can lose it now)
+    Serial.println("⚠️ Transaction could not be queued - publishing directly");
+    queued.sequence = 0;
+    formatTransactionPayload(&nfc_direct_payload, &queued);
+    if (!mqttLinkPublish(mqtt_topic_nfc_transaction, nfc_direct_payload.c_str(), MQTT_TRANSACTION)) {
+      Serial.println("❌ MQTT outbox full of transactions - result not sent");
     }
   }
+}
+
+void handleNFCTransactionTimeout(const NFCTransaction* tx) {
+  Serial.printf("%s TRANSACTION TIMED OUT - Vehicle ID: %s\n", nfcTransactionType(tx), tx->vehicle_id);
   
-  return "";
+  if (mqttLinkConnected()) {
+    char nfc_status[24];
+    snprintf(nfc_status, sizeof(nfc_status), "%s_TIMEOUT", nfcTransactionType(tx));
+    mqttLinkPublish(mqtt_topic_nfc_status, nfc_status, MQTT_TELEMETRY);
+  }
 }
 
-void processNFCTransaction(String vehicle_id) {
-  unsigned long current_time = millis();
+void handleNFCCardRemoved(const char* vehicle_id, unsigned long dwell_ms) {
+  Serial.printf("NFC Card removed: %s (on reader %lu ms)\n", vehicle_id, dwell_ms);
+}
+
+void updateNFCIndicators() {
+  // LEDs, display and telemetry follow the most recently tapped vehicle
+  NFCTransaction* latest = nfcTransactionLatest();
+  
+  if (latest == NULL) {
+    nfc_state = NFC_IDLE;
+    current_vehicle_id[0] = '\0';
+    clearAllLEDs();
+    return;
+  }
+  
+  nfc_state = latest->state;
+  snprintf(current_vehicle_id, sizeof(current_vehicle_id), "%s", latest->vehicle_id);
   
   switch (nfc_state) {
-    case NFC_IDLE:
-      // First tap - initiate loading transaction
-      nfc_state = NFC_LOAD_READY;
-      current_vehicle_id = vehicle_id;
-      transaction_start_time = current_time;
-      transaction_start_bottles = bottle_count;
-      setLED(false, false, true); // Yellow LED on
-      
-      Serial.println("LOAD TRANSACTION STARTED");
-      Serial.println("Vehicle ID: " + vehicle_id);
-      Serial.println("Ready to load bottles...");
-      
-      // Check for double tap window
-      if (current_time - last_nfc_tap_time < DOUBLE_TAP_WINDOW) {
-        handleNFCDoubleTap(vehicle_id);
-        return;
-      }
-      break;
-      
     case NFC_LOAD_READY:
-      if (vehicle_id == current_vehicle_id) {
-        // Second tap - complete loading transaction
-        nfc_state = NFC_LOAD_COMPLETE;
-        int bottle_difference = transaction_start_bottles - bottle_count;
-        
-        setLED(false, true, false); // Green LED on
-        Serial.println("LOAD TRANSACTION COMPLETED");
-        Serial.println("Bottles loaded: " + String(bottle_difference));
-        
-        publishNFCTransaction(vehicle_id, "LOAD", bottle_difference);
-        
-        // Reset after 3 seconds
-        delay(3000);
-        nfc_state = NFC_IDLE;
-        current_vehicle_id = "";
-        clearAllLEDs();
-      }
+      setLED(false, false, true); // Yellow LED on
       break;
-      
     case NFC_UNLOAD_READY:
-      if (vehicle_id == current_vehicle_id) {
-        // Complete unloading transaction
-        nfc_state = NFC_UNLOAD_COMPLETE;
-        int bottle_difference = bottle_count - transaction_start_bottles;
-        
-        setLED(false, true, false); // Green LED on
-        Serial.println("UNLOAD TRANSACTION COMPLETED");
-        Serial.println("Bottles unloaded: " + String(bottle_difference));
-        
-        publishNFCTransaction(vehicle_id, "UNLOAD", bottle_difference);
-        
-        // Reset after 3 seconds
-        delay(3000);
-        nfc_state = NFC_IDLE;
-        current_vehicle_id = "";
-        clearAllLEDs();
-      }
+      setLED(true, false, false); // Red LED on
+      break;
+    case NFC_LOAD_COMPLETE:
+    case NFC_UNLOAD_COMPLETE:
+      setLED(false, true, false); // Green LED on
       break;
-      
     default:
+      clearAllLEDs();
       break;
   }
-  
-  last_nfc_tap_time = current_time;
-}
-
-void handleNFCDoubleTap(String vehicle_id) {
-  // Double tap detected - initiate unloading transaction
-  nfc_state = NFC_UNLOAD_READY;
-  current_vehicle_id = vehicle_id;
-  transaction_start_time = millis();
-  transaction_start_bottles = bottle_count;
-  setLED(true, false, false); // Red LED on
-  
-  Serial.println("UNLOAD TRANSACTION STARTED");
-  Serial.println("Vehicle ID: " + vehicle_id);
-  Serial.println("Ready to unload bottles...");
 }
 
-void publishNFCTransaction(String vehicle_id, String transaction_type, int bottle_difference) {
-  if (!mqttClient.connected() || WiFi.status() != WL_CONNECTED) {
+void publishNFCStatus(const char* vehicle_id, const char* transaction_type) {
+  if (!mqttLinkConnected()) {
     return;
   }
   
   // Publish vehicle ID
-  mqttClient.publish(mqtt_topic_nfc_vehicle, vehicle_id.c_str());
+  mqttLinkPublish(mqtt_topic_nfc_vehicle, vehicle_id, MQTT_TELEMETRY);
   
   // Publish NFC status
-  String nfc_status = transaction_type + "_COMPLETE";
-  mqttClient.publish(mqtt_topic_nfc_status, nfc_status.c_str());
-  
-  // Create detailed transaction JSON
-  String transaction_json = "{\"vehicle_id\":\"" + vehicle_id + 
-                           "\",\"transaction_type\":\"" + transaction_type + 
-                           "\",\"bottle_count\":" + String(bottle_difference) + 
-                           ",\"total_bottles\":" + String(bottle_count) + 
-                           ",\"timestamp\":" + String(millis()) + "}";
-  
-  mqttClient.publish(mqtt_topic_nfc_transaction, transaction_json.c_str());
+  char nfc_status[24];
+  snprintf(nfc_status, sizeof(nfc_status), "%s_COMPLETE", transaction_type);
+  mqttLinkPublish(mqtt_topic_nfc_status, nfc_status, MQTT_TELEMETRY);
+}
+
+// Detailed transaction JSON; timestamp is millis() when the result was
+// final (on an earlier boot for records queued before a restart) and
+// epoch_ms the same moment in Unix time, 0 if the clock was never synced
+void formatTransactionPayload(JsonTemplate* payload, const QueuedTransaction* tx) {
+  uint64_t epoch_ms = tx->completed_epoch_ms;
+  if (epoch_ms == 0 && tx->boot_tag == (uint8_t)deviceClockBootCount()) {
+    // Completed before the first sync of this boot - convert now
+    epoch_ms = deviceClockEpochMs(tx->completed_at);
+  }
+
+  char tx_id[TXQ_ID_LENGTH] = "";
+  if (tx->sequence != 0) {
+    txQueueTransactionId(tx->sequence, tx_id);
+  }
+  payload->setString(TX_JSON_DEVICE_ID, mqtt_client_id_full);
+  payload->setString(TX_JSON_TX_ID, tx_id);
+  payload->setUnsigned(TX_JSON_SEQUENCE, tx->sequence);
+  payload->setString(TX_JSON_VEHICLE_ID, tx->vehicle_id);
+  payload->setString(TX_JSON_TYPE, txQueueTypeName(tx->type));
+  payload->setInt(TX_JSON_BOTTLE_COUNT, tx->bottle_count);
+  payload->setInt(TX_JSON_TOTAL_BOTTLES, tx->total_bottles);
+  payload->setUnsigned(TX_JSON_TIMESTAMP, tx->completed_at);
+  payload->setUnsigned(TX_JSON_EPOCH_MS, epoch_ms);
+}
+
+// Send callback for the transaction queue, on the network task. The record
+// stays in flash (and is resent) until the backend acknowledges its tx_id
+// on mqtt_topic_nfc_ack. False leaves it unsent until the next pass.
+bool publishQueuedTransaction(const QueuedTransaction* tx) {
+  formatTransactionPayload(&nfc_transaction_payload, tx);
+  if (!mqttLinkPublishNow(mqtt_topic_nfc_transaction, (const uint8_t*)nfc_transaction_payload.c_str(),
+                          nfc_transaction_payload.length())) {
+    return false;
+  }
   
-  Serial.println("NFC Transaction published to MQTT");
+  Serial.printf("NFC Transaction #%lu published to MQTT, awaiting ack\n", (unsigned long)tx->sequence);
+  return true;
 }
 
 void updateStatus(int current_bottles) {
-  String new_status = "idle";
+  uint8_t new_status;
   
   if (current_bottles > previous_bottle_count) {
-    new_status = "unloading";  // Bottles increased = unloading to scale
+    new_status = TELEMETRY_STATUS_UNLOADING;  // Bottles increased = unloading to scale
   } else if (current_bottles < previous_bottle_count) {
-    new_status = "loading";    // Bottles decreased = loading from scale
+    new_status = TELEMETRY_STATUS_LOADING;    // Bottles decreased = loading from scale
   } else {
-    new_status = "idle";       // No change
+    new_status = TELEMETRY_STATUS_IDLE;       // No change
   }
   
   if (new_status != current_status) {
     current_status = new_status;
     status_changed = true;
-    Serial.print("Status changed to: ");
-    Serial.println(current_status);
+    Serial.printf("Status changed to: %s\n", telemetryStatusName(current_status));
   }
   
   previous_bottle_count = current_bottles;
 }
 
-void publishMQTTData() {
-  if (!mqttClient.connected() || WiFi.status() != WL_CONNECTED) {
-    return;
+bool publishMQTTData(ReportReason reason) {
+  if (!mqttLinkConnected()) {
+    return false;
   }
   
-  // Create JSON payload for bottle-scale/data topic
-  String nfc_state_str = "";
-  switch(nfc_state) {
-    case NFC_IDLE: nfc_state_str = "idle"; break;
-    case NFC_LOAD_READY: nfc_state_str = "load_ready"; break;
-    case NFC_LOAD_COMPLETE: nfc_state_str = "load_complete"; break;
-    case NFC_UNLOAD_READY: nfc_state_str = "unload_ready"; break;
-    case NFC_UNLOAD_COMPLETE: nfc_state_str = "unload_complete"; break;
+  // Whole snapshot in one binary frame (see telemetry_frame.h for the layout)
+  TelemetrySnapshot snapshot;
+  snapshot.timestamp_ms = millis();
+  snapshot.weight_g = weight_In_g;
+  snapshot.bottles = bottle_count;
+  snapshot.status = current_status;
+  snapshot.nfc_state = (uint8_t)nfc_state;
+  snapshot.open_transactions = (uint8_t)nfcTransactionsOpenCount();
+  snapshot.vehicle_uid_length = telemetryParseUID(current_vehicle_id, snapshot.vehicle_uid);
+  snapshot.report_reason = (uint8_t)reason;
+  snapshot.suppressed = report_policy.suppressed;
+  
+  // Wall-clock time and numbering so the backend can merge pallets and spot gaps
+  DeviceClockStatus clock_status = deviceClockStatus();
+  snapshot.epoch_ms = deviceClockEpochMs(snapshot.timestamp_ms);
+  snapshot.boot_count = clock_status.boot_count;
+  snapshot.sequence = ++frame_sequence;
+  snapshot.clock_age_s = clock_status.sync_age_ms / 1000 < TELEMETRY_CLOCK_AGE_UNKNOWN
+                             ? (uint16_t)(clock_status.sync_age_ms / 1000) : TELEMETRY_CLOCK_AGE_UNKNOWN;
+  snapshot.drift_ppm = (int16_t)constrain(clock_status.drift_ppm, -32768, 32767);
+  
+  uint8_t frame[TELEMETRY_SNAPSHOT_SIZE];
+  size_t frame_length = telemetryEncodeSnapshot(&snapshot, frame, sizeof(frame));
+  if (!mqttLinkPublish(mqtt_topic_frame, frame, frame_length, MQTT_TELEMETRY)) {
+    return false;
   }
   
-  String json_payload = "{\"weight_g\":" + String(weight_In_g) + 
-                       ",\"weight_oz\":" + String(weight_In_oz, 2) + 
-                       ",\"bottles\":" + String(bottle_count) + 
-                       ",\"status\":\"" + current_status + "\"" +
-                       ",\"nfc_state\":\"" + nfc_state_str + "\"" +
-                       ",\"vehicle_id\":\"" + current_vehicle_id + "\"" +
-                       ",\"timestamp\":" + String(millis()) + "}";
+#if MQTT_LEGACY_TOPICS
+  // JSON payload for bottle-scale/data
+  data_payload.setInt(DATA_JSON_WEIGHT_G, weight_In_g);
+  data_payload.setFloat(DATA_JSON_WEIGHT_OZ, weight_In_oz, 2);
+  data_payload.setInt(DATA_JSON_BOTTLES, bottle_count);
+  data_payload.setString(DATA_JSON_STATUS, telemetryStatusName(current_status));
+  data_payload.setString(DATA_JSON_NFC_STATE, nfcStateName(nfc_state));
+  data_payload.setString(DATA_JSON_VEHICLE_ID, current_vehicle_id);
+  data_payload.setInt(DATA_JSON_OPEN_TRANSACTIONS, snapshot.open_transactions);
+  data_payload.setUnsigned(DATA_JSON_TIMESTAMP, snapshot.timestamp_ms);
+  data_payload.setUnsigned(DATA_JSON_EPOCH_MS, snapshot.epoch_ms);
+  data_payload.setUnsigned(DATA_JSON_BOOT, snapshot.boot_count);
+  data_payload.setUnsigned(DATA_JSON_SEQUENCE, snapshot.sequence);
+  
+  // Individual topics and the weight_count CSV, formatted without the heap
+  char weight_text[12];
+  char bottles_text[8];
+  char oz_text[12];
+  char csv_payload[36];
+  snprintf(weight_text, sizeof(weight_text), "%d", weight_In_g);
+  snprintf(bottles_text, sizeof(bottles_text), "%d", bottle_count);
+  jsonFormatDecimal(oz_text, sizeof(oz_text), weight_In_oz, 2);
+  snprintf(csv_payload, sizeof(csv_payload), "%s,%s,%s", weight_text, oz_text, bottles_text);
   
   // Publish individual topics
-  mqttClient.publish(mqtt_topic_weight, String(weight_In_g).c_str());
-  mqttClient.publish(mqtt_topic_bottles, String(bottle_count).c_str());
-  mqttClient.publish(mqtt_topic_status, current_status.c_str());
+  mqttLinkPublish(mqtt_topic_weight, weight_text, MQTT_TELEMETRY);
+  mqttLinkPublish(mqtt_topic_bottles, bottles_text, MQTT_TELEMETRY);
+  mqttLinkPublish(mqtt_topic_status, telemetryStatusName(current_status), MQTT_TELEMETRY);
   
   // Publish JSON data to bottle-scale/data topic
-  mqttClient.publish(mqtt_topic_data, json_payload.c_str());
+  mqttLinkPublish(mqtt_topic_data, data_payload.c_str(), MQTT_TELEMETRY);
   
   // Keep backward compatibility with weight_count topic (CSV format)
-  String csv_payload = String(weight_In_g) + "," + String(weight_In_oz, 2) + "," + String(bottle_count);
-  mqttClient.publish("weight_count", csv_payload.c_str());
+  mqttLinkPublish("weight_count", csv_payload, MQTT_TELEMETRY);
+#endif
+  return true;
+}
+
+void reportTelemetry() {
+  // Called after every sample; publishes only when something changed
+  ReportSample sample;
+  sample.weight = weight_In_g;
+  sample.count = bottle_count;
+  sample.status = current_status;
+  sample.nfc_state = (uint8_t)nfc_state;
+  
+  unsigned long now = millis();
+  ReportReason reason = reportCheck(&report_policy, &sample, now);
+  if (reason == REPORT_NONE) {
+    return;
+  }
+  
+  if (publishMQTTData(reason)) {
+    uint32_t latency = micros() - reading_due_us;
+    publish_latency.frames++;
+    publish_latency.last_us = latency;
+    if (latency > publish_latency.max_us) {
+      publish_latency.max_us = latency;
+    }
+    reportSent(&report_policy, &sample, reason, now);
+    Serial.printf("  %dg | %.1foz | %d bottles | %s | %s (%lu suppressed)\n",
+                  weight_In_g, weight_In_oz, bottle_count, telemetryStatusName(current_status),
+                  reportReasonName(reason), (unsigned long)report_policy.suppressed);
+  }
+}
+
+#if SAMPLE_BATCHING
+void pollSampleBatch() {
+  // Close the window on time even if the HX711 has stopped converting
+  if (sampleWindowDue(&sample_window, millis(), SAMPLE_WINDOW_DURATION)) {
+    publishSampleWindow();
+  }
+  
+  // Waits at most HX711_READY_POLL for the next conversion
+  long raw;
+  float grams;
+  if (!readConversion(&raw, &grams, HX711_READY_POLL)) {
+    return;
+  }
+  unsigned long now = millis();
+  if (xEventGroupClearBits(system_events, EVENT_SCALE_CHANGED) & EVENT_SCALE_CHANGED) {
+    recent_count = 0;                    // Conversions before the new zero or factor are stale
+  }
+  
+  int32_t value = SAMPLE_BATCH_UNIT == SAMPLE_UNIT_RAW ? (int32_t)raw : (int32_t)lroundf(grams * 10.0f);
+  if (!sampleWindowAdd(&sample_window, value, now)) {
+    publishSampleWindow();
+    sampleWindowAdd(&sample_window, value, now);
+  }
+  
+  recent_grams[recent_count % SAMPLE_AVERAGE_COUNT] = grams;
+  recent_times[recent_count % SAMPLE_AVERAGE_COUNT] = now;
+  recent_count++;
+}
+
+void publishSampleWindow() {
+  static uint8_t message[SAMPLE_WINDOW_MAX_SIZE];
+  
+  // Full-rate data is best effort: a window that cannot go out now is
+  // dropped, and the gap shows up in the window sequence
+  sample_window.boot_count = deviceClockBootCount();
+  sample_window.start_epoch_ms = deviceClockEpochMs(sample_window.start_ms);
+  size_t length = sampleWindowEncode(&sample_window, message, sizeof(message));
+  if (length > 0 && mqttLinkConnected() &&
+      mqttLinkPublish(mqtt_topic_samples, message, length, MQTT_TELEMETRY)) {
+    sample_windows_published++;
+  } else {
+    sample_windows_dropped++;
+  }
+  sampleWindowReset(&sample_window);
+}
+#endif
+
+// Fills a snapshot and hands it to the display task; returns without
+// waiting for drawing or I2C
+void postDisplay(DisplayScreen which, const char* message = "", int32_t countdown = 0, float cal_factor = 0) {
+  DisplayState state;
+  memset(&state, 0, sizeof(state));
+  state.screen = which;
+  state.unit_weight_g = deviceConfig()->unit_weight_g;
+  state.countdown = countdown;
+  state.cal_factor = cal_factor;
+  snprintf(state.message, sizeof(state.message), "%s", message);
+  // The readings belong to the NFC task, the only one posting the screens
+  // that show them
+  if (which == DISPLAY_WEIGHT || which == DISPLAY_NFC) {
+    state.weight_g = weight_In_g;
+    state.bottles = bottle_count;
+    state.nfc_state = nfc_state;
+    state.status = current_status;
+    memcpy(state.vehicle_id, current_vehicle_id, sizeof(state.vehicle_id));
+  }
+  oledTaskPost(&state);
+}
+
+// Display task: sets the fields of the screen a snapshot asks for; the
+// task then draws what changed and sends the changed bytes
+void renderDisplay(const void* snapshot) {
+  const DisplayState* state = (const DisplayState*)snapshot;
+  switch (state->screen) {
+    case DISPLAY_STARTUP:
+      screen.show(startup_screen);
+      break;
+    
+    case DISPLAY_WELCOME:
+      screen.show(welcome_screen);
+      screen.printf(WELCOME_SCREEN_BOTTLE, "Bottle: %ldg each", (long)state->unit_weight_g);
+      break;
+    
+    case DISPLAY_CALIBRATION:
+      screen.show(calibration_screen);
+      screen.setText(CALIBRATION_SCREEN_STATUS, state->message);
+      if (state->countdown > 0) {
+        screen.setInt(CALIBRATION_SCREEN_COUNTDOWN, state->countdown);
+      } else {
+        screen.setText(CALIBRATION_SCREEN_COUNTDOWN, "");
+      }
+      break;
+    
+    case DISPLAY_CALIBRATED:
+      screen.show(calibrated_screen);
+      screen.printf(CALIBRATED_SCREEN_FACTOR, "Factor: %.2f", state->cal_factor);
+      break;
+    
+    case DISPLAY_WEIGHT: {
+      screen.show(weight_screen);
+      screen.printf(WEIGHT_SCREEN_WEIGHT, "%ld g", (long)state->weight_g);
+      screen.setInt(WEIGHT_SCREEN_BOTTLES, state->bottles);
+      screen.setText(WEIGHT_SCREEN_STATUS, telemetryStatusName(state->status));
+      
+      // Show NFC information if active
+      const char* nfc_text = "";
+      switch (state->nfc_state) {
+        case NFC_IDLE:
+          break;
+        case NFC_LOAD_READY:
+          nfc_text = "NFC: LOAD READY";
+          break;
+        case NFC_UNLOAD_READY:
+          nfc_text = "NFC: UNLOAD READY";
+          break;
+        case NFC_LOAD_COMPLETE:
+          nfc_text = "NFC: LOAD DONE";
+          break;
+        case NFC_UNLOAD_COMPLETE:
+          nfc_text = "NFC: UNLOAD DONE";
+          break;
+        default:
+          nfc_text = "NFC: ACTIVE";
+          break;
+      }
+      screen.setText(WEIGHT_SCREEN_NFC, nfc_text);
+      if (state->nfc_state != NFC_IDLE && state->vehicle_id[0] != '\0') {
+        screen.printf(WEIGHT_SCREEN_VEHICLE, "ID: %.8s", state->vehicle_id);  // Show first 8 chars
+      } else {
+        screen.setText(WEIGHT_SCREEN_VEHICLE, "");
+      }
+      break;
+    }
+    
+    case DISPLAY_NFC:
+      screen.show(nfc_screen);
+      if (state->vehicle_id[0] != '\0') {
+        screen.printf(NFC_SCREEN_VEHICLE, "Vehicle: %.10s", state->vehicle_id);
+      } else {
+        screen.setText(NFC_SCREEN_VEHICLE, "Vehicle: None");
+      }
+      switch (state->nfc_state) {
+        case NFC_IDLE:
+          screen.setText(NFC_SCREEN_STATE, "State: IDLE");
+          break;
+        case NFC_LOAD_READY:
+          screen.setText(NFC_SCREEN_STATE, "State: LOAD READY");
+          break;
+        case NFC_LOAD_COMPLETE:
+          screen.setText(NFC_SCREEN_STATE, "State: LOAD COMPLETE");
+          break;
+        case NFC_UNLOAD_READY:
+          screen.setText(NFC_SCREEN_STATE, "State: UNLOAD READY");
+          break;
+        case NFC_UNLOAD_COMPLETE:
+          screen.setText(NFC_SCREEN_STATE, "State: UNLOAD COMPLETE");
+          break;
+      }
+      screen.printf(NFC_SCREEN_BOTTLES, "Bottles: %ld", (long)state->bottles);
+      break;
+    
+    case DISPLAY_HX711_ERROR:
+      screen.show(hx711_error_screen);
+      break;
+  }
 }
 
 void initializeDisplay() {
@@ -456,166 +955,576 @@ void initializeDisplay() {
     Serial.println(F("SSD1306 allocation failed"));
     return;
   }
+  // From here on only the display task touches the display
+  oledPanelBegin(&display, &Wire, SCREEN_ADDRESS, OLED_I2C_CLOCK);
+  oledTaskBegin(&screen, sizeof(DisplayState), renderDisplay);
   
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.setCursor(0, 0);
-  display.println(F("HX711 Scale System"));
-  display.println(F("Initializing..."));
-  display.display();
+  postDisplay(DISPLAY_STARTUP);
   delay(2000);
 }
 
 void displayWelcomeScreen() {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  
-  display.setCursor(0, 0);
-  display.println(F("=== SMART INVENTORY PALATE ==="));
-  display.println();
-  display.println(F("Calibration: 172g"));
-  display.println(F("Bottle: 275g each"));
-  display.println();
-  display.println(F("Send 'P' to prepare"));
-  display.println(F("Send 'C' to calibrate"));
-  
-  display.display();
+  postDisplay(DISPLAY_WELCOME);
 }
 
-void displayCalibrationStatus(String status, int countdown = -1) {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  
-  display.setCursor(0, 0);
-  display.println(F("=== CALIBRATION ==="));
-  display.println();
-  display.println(status);
+void displayCalibrationStatus(const char* status, int countdown = -1) {
+  postDisplay(DISPLAY_CALIBRATION, status, countdown);
+}
+
+void displayWeight() {
+  postDisplay(DISPLAY_WEIGHT);
+}
+
+void displayNFCStatus() {
+  postDisplay(DISPLAY_NFC);
+}
+
+void displayCalibrationComplete(float cal_factor) {
+  postDisplay(DISPLAY_CALIBRATED, "", 0, cal_factor);
+  delay(3000);
+}
+
+// Acquisition task: reads one conversion once DOUT signals it, sleeping
+// between checks so the tasks below keep the core. The mutex is held only
+// for the read; no conversion is read while the console has the HX711.
+bool readConversion(long* raw, float* grams, unsigned long timeout_ms) {
+  unsigned long start = millis();
+  for (;;) {
+    xSemaphoreTake(hx711_mutex, portMAX_DELAY);
+    bool ready = (xEventGroupGetBits(system_events) & EVENT_WEIGHING) && LOADCELL_HX711.is_ready();
+    if (ready) {
+      STAGE_TIMER("hx711_read");
+      TRACE_SCOPE("hx711_read");
+      *raw = LOADCELL_HX711.read();
+      *grams = (*raw - LOADCELL_HX711.get_offset()) / LOADCELL_HX711.get_scale();
+    }
+    xSemaphoreGive(hx711_mutex);
+    if (ready) {
+      return true;
+    }
+    if (millis() - start >= timeout_ms) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(HX711_READY_POLL));
+  }
+}
+
+void recordAcquisitionFailure() {
+  // A reading stopped by the console is not a failure
+  if (!(xEventGroupGetBits(system_events) & EVENT_WEIGHING)) {
+    return;
+  }
+  consecutive_failures++;
   
-  if (countdown > 0) {
-    display.println();
-    display.setTextSize(2);
-    display.print(F("     "));
-    display.println(countdown);
+  if (consecutive_failures >= MAX_CONSECUTIVE_FAILURES) {
+    postDisplay(DISPLAY_HX711_ERROR);
+    Serial.println("HX711 communication error - retrying...");
+    
+    // Try to reinitialize HX711
+    vTaskDelay(pdMS_TO_TICKS(500));
+    xSemaphoreTake(hx711_mutex, portMAX_DELAY);
+    LOADCELL_HX711.begin(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN);
+    xSemaphoreGive(hx711_mutex);
+    vTaskDelay(pdMS_TO_TICKS(500));
+    
+    consecutive_failures = 0;
   }
+}
+
+void sendReading(float grams, unsigned long sample_time, uint32_t due_us) {
+  long reading = (long)grams;
   
-  display.display();
+  // Only pass on a reading that seems valid
+  if (abs(reading) >= 50000) {  // Reasonable bounds check
+    Serial.printf("Invalid HX711 reading: %ld\n", reading);
+    consecutive_failures++;
+    return;
+  }
+  consecutive_failures = 0;
+  
+  ScaleEvent event;
+  event.type = SCALE_READING;
+  event.weight_g = reading;
+  event.sample_time = sample_time;
+  event.due_us = due_us;
+  if (xQueueSend(scale_queue, &event, 0) != pdTRUE) {
+    readings_dropped++;
+  }
 }
 
-void displayWeight() {
-  display.clearDisplay();
-  
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.setCursor(0, 0);
-  display.println(F("=== SMART INVENTORY PALATE ==="));
-  
-  display.setTextSize(1);
-  display.setCursor(0, 12);
-  display.print(F("Weight: "));
-  display.print(weight_In_g);
-  display.println(F(" g"));
-  
-  display.setCursor(0, 22);
-  display.print(F("Bottles: "));
-  display.println(bottle_count);
-  
-  display.setCursor(0, 32);
-  display.print(F("Status: "));
-  display.println(current_status);
-  
-  // Show NFC information if active
-  if (nfc_state != NFC_IDLE) {
-    display.setCursor(0, 42);
-    display.print(F("NFC: "));
-    switch(nfc_state) {
-      case NFC_LOAD_READY:
-        display.println(F("LOAD READY"));
-        break;
-      case NFC_UNLOAD_READY:
-        display.println(F("UNLOAD READY"));
-        break;
-      case NFC_LOAD_COMPLETE:
-        display.println(F("LOAD DONE"));
-        break;
-      case NFC_UNLOAD_COMPLETE:
-        display.println(F("UNLOAD DONE"));
-        break;
-      default:
-        display.println(F("ACTIVE"));
-        break;
+// One weight reading; the sample is stamped with the middle of the
+// conversion window for tap-time lookups
+void takeReading(uint32_t due_us) {
+  STAGE_TIMER("hx711_reading");
+#if SAMPLE_BATCHING
+  // The batch poller owns the conversions; average the newest ones
+  if (recent_count < SAMPLE_AVERAGE_COUNT) {
+    recordAcquisitionFailure();
+    return;
+  }
+  float grams_sum = 0;
+  for (int i = 0; i < SAMPLE_AVERAGE_COUNT; i++) {
+    grams_sum += recent_grams[i];
+  }
+  unsigned long sample_time = recent_times[(recent_count - 1 - SAMPLE_AVERAGE_COUNT / 2) % SAMPLE_AVERAGE_COUNT];
+  recent_count = 0;
+#else
+  // As get_units(3), but each conversion is read as soon as it is ready
+  xEventGroupClearBits(system_events, EVENT_SCALE_CHANGED);
+  unsigned long conversion_start = millis();
+  float grams_sum = 0;
+  for (int i = 0; i < SAMPLE_AVERAGE_COUNT; i++) {
+    long raw;
+    float grams;
+    if (!readConversion(&raw, &grams, HX711_READY_TIMEOUT)) {
+      recordAcquisitionFailure();
+      return;
+    }
+    grams_sum += grams;
+  }
+  // A tare or new factor in the middle mixes two scales
+  if (xEventGroupGetBits(system_events) & EVENT_SCALE_CHANGED) {
+    return;
+  }
+  unsigned long sample_time = conversion_start + (millis() - conversion_start) / 2;
+#endif
+  sendReading(grams_sum / SAMPLE_AVERAGE_COUNT, sample_time, due_us);
+}
+
+void acquisitionTask(void* parameter) {
+  (void)parameter;
+  TickType_t last_due = xTaskGetTickCount();
+  const TickType_t interval = pdMS_TO_TICKS(hx711ReadingInterval);
+  for (;;) {
+    // Idle until calibrated, and while the console has the HX711
+    if (!(xEventGroupGetBits(system_events) & EVENT_WEIGHING)) {
+      xEventGroupWaitBits(system_events, EVENT_WEIGHING, pdFALSE, pdTRUE, portMAX_DELAY);
+      last_due = xTaskGetTickCount();
     }
     
-    if (current_vehicle_id.length() > 0) {
-      display.setCursor(0, 52);
-      display.print(F("ID: "));
-      display.println(current_vehicle_id.substring(0, 8)); // Show first 8 chars
+#if SAMPLE_BATCHING
+    // Every conversion goes into the current sample window
+    pollSampleBatch();
+    if (xTaskGetTickCount() - last_due < interval) {
+      continue;
     }
+    last_due += interval;
+#else
+    vTaskDelayUntil(&last_due, interval);
+#endif
+    takeReading(micros());
   }
-  
-  display.display();
 }
 
-void displayNFCStatus() {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
+// NFC task: the weight, bottle count, status and transactions change only here
+void processReading(const ScaleEvent* reading) {
+  STAGE_TIMER("inventory");
+  weight_In_g = reading->weight_g;
   
-  display.setCursor(0, 0);
-  display.println(F("=== NFC SYSTEM ==="));
-  display.println();
+  if (weight_In_g < 0) weight_In_g = 0;
   
-  display.print(F("Vehicle: "));
-  if (current_vehicle_id.length() > 0) {
-    display.println(current_vehicle_id.substring(0, 10));
-  } else {
-    display.println(F("None"));
+  weight_In_oz = (float)weight_In_g / 28.34952;
+  
+  bottle_count = round((float)weight_In_g / count_unit_weight_g);
+  if (bottle_count < 0) bottle_count = 0;
+  
+  // Record the sample, credit count changes to the vehicle working the
+  // pallet at this sample and settle transactions waiting on it
+  weightHistoryAdd(reading->sample_time, weight_In_g, bottle_count);
+  int bottle_delta = bottle_count - previous_bottle_count;
+  if (bottle_delta != 0) {
+    nfcTransactionsAttribute(bottle_delta, reading->sample_time);
   }
+  nfcTransactionsResolve(millis(), handleNFCTransactionComplete);
   
-  display.print(F("State: "));
-  switch(nfc_state) {
-    case NFC_IDLE:
-      display.println(F("IDLE"));
-      break;
-    case NFC_LOAD_READY:
-      display.println(F("LOAD READY"));
-      break;
-    case NFC_LOAD_COMPLETE:
-      display.println(F("LOAD COMPLETE"));
+  // Update status based on bottle count changes
+  updateStatus(bottle_count);
+  
+  // Publish by exception (count/state change, weight past the deadband,
+  // or heartbeat)
+  reading_due_us = reading->due_us;
+  reportTelemetry();
+}
+
+void handleScaleEvent(const ScaleEvent* event) {
+  switch (event->type) {
+    case SCALE_READING:
+      processReading(event);
       break;
-    case NFC_UNLOAD_READY:
-      display.println(F("UNLOAD READY"));
+    
+    case SCALE_ZEROED:
+      // Start the count from the new zero so it is not reported as unloading
+      weight_In_g = 0;
+      weight_In_oz = 0;
+      bottle_count = 0;
+      previous_bottle_count = 0;
+      // Samples and tap counts from before the tare are on the old zero
+      weightHistoryClear();
+      nfcTransactionsRebase();
       break;
-    case NFC_UNLOAD_COMPLETE:
-      display.println(F("UNLOAD COMPLETE"));
+    
+    case SCALE_CONFIG_CHANGED: {
+      // Apply now; the policy keeps its baseline, so no report is forced
+      const DeviceConfig* config = deviceConfig();
+      report_policy.heartbeat_interval = config->publish_interval;
+      report_policy.weight_deadband = config->weight_deadband;
+      // Only a new unit weight changes the count; recount without treating
+      // the difference as a load. Samples and credited changes so far are in
+      // the old unit.
+      if (config->unit_weight_g != count_unit_weight_g) {
+        nfcTransactionsRescale(count_unit_weight_g, config->unit_weight_g);
+        weightHistoryClear();
+        count_unit_weight_g = config->unit_weight_g;
+        bottle_count = round((float)weight_In_g / count_unit_weight_g);
+        previous_bottle_count = bottle_count;
+      }
       break;
+    }
   }
-  
-  display.println();
-  display.print(F("Bottles: "));
-  display.println(bottle_count);
-  
-  display.display();
 }
 
-void displayCalibrationComplete(float cal_factor) {
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  
-  display.setCursor(0, 0);
-  display.println(F("=== CALIBRATED! ==="));
-  display.println();
-  display.print(F("Factor: "));
-  display.println(cal_factor, 2);
-  display.println();
-  display.println(F("Scale ready!"));
-  display.println(F("Weighing bottles..."));
-  
-  display.display();
-  delay(3000);
+// Console task: hands a scale change to the NFC task
+void sendScaleEvent(ScaleEventType type) {
+  ScaleEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = type;
+  xQueueSend(scale_queue, &event, portMAX_DELAY);
+}
+
+void nfcTask(void* parameter) {
+  (void)parameter;
+  unsigned long last_expiry = 0;
+  unsigned long last_display = 0;
+  unsigned long last_welcome = 0;
+  for (;;) {
+    // A reading is handled as soon as it arrives; without one the wait
+    // paces the reader polls
+    ScaleEvent event;
+    if (xQueueReceive(scale_queue, &event, pdMS_TO_TICKS(NFC_TASK_WAIT)) == pdTRUE) {
+      do {
+        handleScaleEvent(&event);
+      } while (xQueueReceive(scale_queue, &event, 0) == pdTRUE);
+    }
+    
+    // Expire completed and abandoned NFC transactions
+    unsigned long now = millis();
+    if (now - last_expiry >= NFC_EXPIRY_INTERVAL) {
+      nfcTransactionsResolve(now, handleNFCTransactionComplete);
+      nfcTransactionsExpire(now, handleNFCTransactionTimeout);
+      updateNFCIndicators();
+      last_expiry = now;
+    }
+    
+    EventBits_t events = xEventGroupGetBits(system_events);
+    
+    // Handle NFC card detection once the scale is calibrated. One reader
+    // per pass; repeated reads of a card resting on a reader collapse into
+    // one tap
+    if (events & EVENT_CALIBRATED) {
+      char detected_card[VEHICLE_ID_LENGTH];
+      int reader_index;
+      if (nfcReadersPoll(detected_card, &reader_index) &&
+          nfcPresenceSeen(detected_card, millis()) == NFC_CARD_PRESENT) {
+        Serial.printf("NFC Card detected: %s (reader %s)\n", detected_card, nfc_readers[reader_index].name);
+        processNFCTransaction(detected_card);
+      }
+      nfcPresenceExpire(millis(), handleNFCCardRemoved);
+    }
+    
+    // Only changed fields are redrawn and sent, so the screen can follow
+    // NFC state changes between weight readings; posting never waits
+    now = millis();
+    if (events & EVENT_WEIGHING) {
+      if (now - last_display >= displayUpdateInterval) {
+        displayWeight();
+        last_display = now;
+      }
+    } else if (!(events & EVENT_CALIBRATED)) {
+      if (now - last_welcome >= 5000) {
+        displayWelcomeScreen();
+        last_welcome = now;
+      }
+    }
+  }
+}
+
+// The console borrows the HX711: readings stop, and the acquisition task
+// reads no conversion until scaleRelease(). Returns the event bits from
+// before, so the caller can restore weighing.
+EventBits_t scaleAcquire() {
+  EventBits_t events = xEventGroupClearBits(system_events, EVENT_WEIGHING);
+  xSemaphoreTake(hx711_mutex, portMAX_DELAY);
+  return events;
+}
+
+void scaleRelease(bool weighing) {
+  xEventGroupSetBits(system_events, EVENT_SCALE_CHANGED);
+  xSemaphoreGive(hx711_mutex);
+  if (weighing) {
+    xEventGroupSetBits(system_events, EVENT_WEIGHING);
+  }
+}
+
+#if EVENT_TRACE
+struct TraceUpload {
+  char payload[MQTT_OUTBOX_MAX_PAYLOAD];
+  size_t length;
+  uint32_t messages;
+  bool stalled;                            // A message could not be queued
+};
+
+static bool printTraceLine(const char* line, void* context) {
+  (void)context;
+  Serial.println(line);
+  return true;
+}
+
+// Waits until the outbox is at most half full, then queues the lines
+// gathered so far as one message
+static bool sendTraceChunk(TraceUpload* upload) {
+  unsigned long start = millis();
+  while (mqttLinkDepth() >= MQTT_OUTBOX_SLOTS / 2) {
+    if (!mqttLinkConnected() || millis() - start >= TRACE_UPLOAD_TIMEOUT) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(TRACE_UPLOAD_WAIT));
+  }
+  if (!mqttLinkPublish(mqtt_topic_trace, (const uint8_t*)upload->payload, upload->length,
+                       MQTT_TELEMETRY)) {
+    return false;
+  }
+  upload->messages++;
+  upload->length = 0;
+  return true;
+}
+
+static bool uploadTraceLine(const char* line, void* context) {
+  TraceUpload* upload = (TraceUpload*)context;
+  size_t length = strlen(line);
+  if (upload->length + length + 1 > sizeof(upload->payload) && !sendTraceChunk(upload)) {
+    upload->stalled = true;
+    return false;
+  }
+  memcpy(upload->payload + upload->length, line, length);
+  upload->length += length;
+  upload->payload[upload->length++] = '\n';
+  return true;
+}
+
+// Newest max_events events as newline-separated dump lines, several per
+// message. False if the outbox did not drain or the link dropped before
+// the end line went out.
+bool uploadTrace(uint32_t max_events, uint32_t* events, uint32_t* messages) {
+  static TraceUpload upload;
+  upload.length = 0;
+  upload.messages = 0;
+  upload.stalled = false;
+  *events = eventTraceDump(uploadTraceLine, &upload, max_events);
+  bool complete = !upload.stalled && sendTraceChunk(&upload);
+  *messages = upload.messages;
+  return complete;
+}
+#endif
+
+void handleSerialCommand(char inChar) {
+  Serial.println();
+  Serial.print("Received: ");
+  Serial.println(inChar);
+
+#if EVENT_TRACE
+  if (inChar == 'T' || inChar == 't') {
+    eventTraceDump(printTraceLine, NULL, 0);
+    return;
+  }
+#endif
+
+  // PREPARATION PHASE
+  if (inChar == 'P' || inChar == 'p') {
+    // Weighing stays off until calibration
+    scaleAcquire();
+    delay(1000);
+    
+    // Check HX711 multiple times with longer delays
+    bool hx711_ready = false;
+    for (int i = 0; i < 20; i++) {
+      if (LOADCELL_HX711.is_ready()) {
+        hx711_ready = true;
+        break;
+      }
+      delay(200);  // Longer delay between checks
+    }
+    
+    if (hx711_ready) {  
+      Serial.println("PREPARATION PHASE");
+      Serial.println("Remove all objects from scale!");
+      
+      displayCalibrationStatus("Remove all objects", 0);
+      delay(3000);  // Longer delay for stability
+      
+      for (byte i = 5; i > 0; i--) {
+        Serial.printf("   %d...\n", i);
+        displayCalibrationStatus("Preparing...", i);
+        delay(1500);  // Longer delays during calibration
+      }
+      
+      LOADCELL_HX711.set_scale(); 
+      Serial.println("Setting baseline...");
+      displayCalibrationStatus("Setting baseline...");
+      delay(2000);  // Extra time for baseline
+      
+      LOADCELL_HX711.tare();
+      scale_tared = true;
+      Serial.println("Scale zeroed");
+      Serial.printf("Place %d gram weight\n", weight_of_object_for_calibration);
+      
+      displayCalibrationStatus("Place 172g weight");
+      delay(3000);
+      
+      for (byte i = 5; i > 0; i--) {
+        Serial.printf("   %d...\n", i);
+        displayCalibrationStatus("Wait...", i);
+        delay(1500);
+      }
+      
+      Serial.println("Send 'C' to calibrate...");
+      displayCalibrationStatus("Send 'C' to start");
+    } else {
+      Serial.println("HX711 not ready!");
+      displayCalibrationStatus("HX711 ERROR!");
+    }
+    scaleRelease(false);
+  }
+
+  // CALIBRATION PHASE
+  if (inChar == 'C' || inChar == 'c') {
+    EventBits_t events = scaleAcquire();
+    
+    // Check HX711 multiple times with longer delays
+    bool hx711_ready = false;
+    for (int i = 0; i < 20; i++) {
+      if (LOADCELL_HX711.is_ready()) {
+        hx711_ready = true;
+        break;
+      }
+      delay(200);
+    }
+    
+    if (hx711_ready) {
+      Serial.println("CALIBRATION PHASE");
+      Serial.println("Taking readings...");
+      
+      displayCalibrationStatus("Calibrating...");
+      
+      for (byte i = 0; i < 5; i++) {
+        delay(1000);  // Wait before each reading
+        sensor_Reading_Results = LOADCELL_HX711.get_units(15);  // More averaging for calibration
+        Serial.printf("Reading %d: %ld\n", i+1, sensor_Reading_Results);
+        delay(1000);  // Wait after each reading
+      }
+
+      CALIBRATION_FACTOR = (float)sensor_Reading_Results / weight_of_object_for_calibration; 
+
+      Serial.println("Saving to flash...");
+      preferences.putFloat("CFVal", CALIBRATION_FACTOR); 
+      delay(500);
+
+      Serial.println("Loading from flash...");
+      float LOAD_CALIBRATION_FACTOR = preferences.getFloat("CFVal", 0);
+      LOADCELL_HX711.set_scale(LOAD_CALIBRATION_FACTOR);
+      delay(1000);  // Extra time for scale setting
+
+      Serial.printf("CALIBRATION FACTOR: %.6f\n", LOAD_CALIBRATION_FACTOR);
+
+      xEventGroupSetBits(system_events, EVENT_CALIBRATED);
+      scaleRelease(true);
+
+      Serial.println("CALIBRATION COMPLETE!");
+      Serial.println("Ready for bottle counting!");
+      
+      displayCalibrationComplete(LOAD_CALIBRATION_FACTOR);
+    } else {
+      Serial.println("HX711 not ready!");
+      displayCalibrationStatus("HX711 ERROR!");
+      scaleRelease(events & EVENT_WEIGHING);
+    }
+  }
+}
+
+// {"boot":..,"uptime":..,"window_s":..,"heap":..,"heap_min":..,"heap_max_block":..,
+//  "stages":{"name":[count,min,p50,p99,max],...}} with the durations in us;
+// the histograms start over after each report. A largest free block well
+// under the free heap means fragmentation.
+void publishDiagnostics(unsigned long window_ms) {
+  static char report[MQTT_OUTBOX_MAX_PAYLOAD];
+  uint32_t heap = ESP.getFreeHeap();
+  uint32_t heap_max_block = ESP.getMaxAllocHeap();
+  int length = snprintf(report, sizeof(report),
+                        "{\"boot\":%lu,\"uptime\":%lu,\"window_s\":%lu,\"heap\":%lu,\"heap_min\":%lu,"
+                        "\"heap_max_block\":%lu",
+                        (unsigned long)deviceClockBootCount(), millis() / 1000, window_ms / 1000,
+                        (unsigned long)heap, (unsigned long)ESP.getMinFreeHeap(),
+                        (unsigned long)heap_max_block);
+#if STAGE_TIMING
+  length += snprintf(report + length, sizeof(report) - length, ",\"stages\":");
+  length += stageTimerFormatJson(report + length, sizeof(report) - length - 1);
+  stageTimerReset();
+#endif
+  report[length++] = '}';
+  report[length] = '\0';
+  
+  if (heap_max_block < HEAP_LOW_BLOCK) {
+    Serial.printf("⚠️ Heap fragmented: largest free block %lu of %lu bytes free\n",
+                  (unsigned long)heap_max_block, (unsigned long)heap);
+  }
+  if (mqttLinkConnected()) {
+    mqttLinkPublish(mqtt_topic_diag, (const uint8_t*)report, length, MQTT_TELEMETRY);
+  }
+}
+
+void consoleTask(void* parameter) {
+  (void)parameter;
+  for (;;) {
+    // Woken at once by a remote command; serial input is checked every
+    // CONSOLE_POLL_INTERVAL
+    xEventGroupWaitBits(system_events, EVENT_COMMAND_QUEUED, pdTRUE, pdFALSE,
+                        pdMS_TO_TICKS(CONSOLE_POLL_INTERVAL));
+    
+    while (Serial.available()) {
+      handleSerialCommand((char)Serial.read());
+    }
+    
+    // Commands received over MQTT; the response is published before a
+    // requested reboot
+    while (processRemoteCommand()) {
+    }
+    if (reboot_requested_at != 0 && millis() - reboot_requested_at >= REMOTE_REBOOT_DELAY) {
+      Serial.println("🔄 Rebooting on remote command");
+      ESP.restart();
+    }
+    
+    static unsigned long last_diag_report = 0;
+    if (millis() - last_diag_report >= DIAG_REPORT_INTERVAL) {
+      publishDiagnostics(millis() - last_diag_report);
+      last_diag_report = millis();
+    }
+  }
+}
+
+// Acquisition, NFC and console tasks on the application core; the network
+// and display tasks are started by setupMQTT() and initializeDisplay()
+void startTasks() {
+  if (xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQUISITION_TASK_STACK_SIZE, NULL,
+                              ACQUISITION_TASK_PRIORITY, NULL, APP_TASK_CORE) != pdPASS) {
+    Serial.println("❌ Could not start the acquisition task");
+  }
+  if (xTaskCreatePinnedToCore(nfcTask, "nfc", NFC_TASK_STACK_SIZE, NULL, NFC_TASK_PRIORITY, NULL,
+                              APP_TASK_CORE) != pdPASS) {
+    Serial.println("❌ Could not start the NFC task");
+  }
+  if (xTaskCreatePinnedToCore(consoleTask, "console", CONSOLE_TASK_STACK_SIZE, NULL, CONSOLE_TASK_PRIORITY,
+                              NULL, APP_TASK_CORE) != pdPASS) {
+    Serial.println("❌ Could not start the console task");
+  }
 }
 
 void setup() {
@@ -623,6 +1532,15 @@ void setup() {
   Serial.println();
   delay(2000);
 
+#if EVENT_TRACE
+  eventTraceBegin();
+#endif
+
+  // Before any task starts: the network task signals commands from setupMQTT() on
+  system_events = xEventGroupCreate();
+  scale_queue = xQueueCreate(SCALE_QUEUE_LENGTH, sizeof(ScaleEvent));
+  hx711_mutex = xSemaphoreCreateMutex();
+
   // Initialize I2C for display
   Wire.begin();
   
@@ -634,6 +1552,23 @@ void setup() {
   
   // Initialize display first
   initializeDisplay();
+  
+  nfcTransactionsBegin();
+  nfcPresenceBegin();
+  
+  // Build-time settings are defaults; values set over MQTT are kept in NVS
+  DeviceConfig config_defaults;
+  config_defaults.publish_interval = REPORT_HEARTBEAT_INTERVAL;
+  config_defaults.weight_deadband = REPORT_WEIGHT_DEADBAND;
+  config_defaults.unit_weight_g = BOTTLE_WEIGHT;
+  deviceConfigBegin(&config_defaults);
+  count_unit_weight_g = deviceConfig()->unit_weight_g;
+  reportPolicyBegin(&report_policy, deviceConfig()->weight_deadband, deviceConfig()->publish_interval,
+                    REPORT_MIN_INTERVAL);
+  remoteCommandsBegin();
+#if SAMPLE_BATCHING
+  sampleWindowBegin(&sample_window, SAMPLE_BATCH_UNIT);
+#endif
 
   Serial.println("=== HX711 Bottle Scale System ===");
   Serial.println("Setup...");
@@ -641,6 +1576,9 @@ void setup() {
   // Initialize Preferences
   preferences.begin("CF", false);
   delay(100);
+  
+  // Completed NFC transactions waiting to be published survive reboots
+  txQueueBegin();
 
   Serial.println();
   Serial.println("IMPORTANT: Remove all objects from scale during setup!");
@@ -676,8 +1614,8 @@ void setup() {
     Serial.printf("Loading calibration factor: %.6f\n", stored_cal_factor);
     LOADCELL_HX711.set_scale(stored_cal_factor);
     LOADCELL_HX711.tare();
-    calibration_completed = true;
-    show_Weighing_Results = true;
+    scale_tared = true;
+    xEventGroupSetBits(system_events, EVENT_CALIBRATED | EVENT_WEIGHING);
     
     displayCalibrationComplete(stored_cal_factor);
   } else {
@@ -688,6 +1626,7 @@ void setup() {
   // Initialize WiFi AFTER HX711 setup
   Serial.println("Initializing WiFi...");
   setupWiFi();
+  deviceClockBegin();
 
   // Initialize MQTT AFTER WiFi
   Serial.println("Initializing MQTT...");
@@ -699,7 +1638,7 @@ void setup() {
 
   Serial.println("Setup complete.");
 
-  if (!calibration_completed) {
+  if (!(xEventGroupGetBits(system_events) & EVENT_CALIBRATED)) {
     Serial.println();
     Serial.println("=== CALIBRATION INSTRUCTIONS ===");
     Serial.println("Commands:");
@@ -707,251 +1646,18 @@ void setup() {
     Serial.println("   C - Start calibration");
     Serial.println();
     Serial.printf("Calibration weight: %d grams\n", weight_of_object_for_calibration);
-    Serial.printf("Bottle weight: %d grams each\n", BOTTLE_WEIGHT);
+    Serial.printf("Bottle weight: %ld grams each\n", (long)deviceConfig()->unit_weight_g);
     Serial.println();
     Serial.println("Send 'P' to begin...");
   }
+
+  startTasks();
 }
 
 void loop() {
-  unsigned long currentTime = millis();
-
-  // Handle MQTT with strict timing control - only when HX711 is not busy
-  if (!hx711_busy && currentTime - lastMQTTCheck >= mqttCheckInterval) {
-    if (!mqttClient.connected()) {
-      connectToBroker();
-    }
-    lastMQTTCheck = currentTime;
-  }
-  
-  // Process MQTT messages quickly - but not during HX711 operations
-  if (!hx711_busy) {
-    mqttClient.loop();
-  }
-
-  // Handle NFC card detection - only when HX711 is not busy and scale is calibrated
-  if (!hx711_busy && calibration_completed) {
-    String detected_card = readNFCCard();
-    if (detected_card.length() > 0) {
-      Serial.println("NFC Card detected: " + detected_card);
-      processNFCTransaction(detected_card);
-      
-      // Brief delay to prevent multiple rapid reads of the same card
-      delay(500);
-    }
-  }
-
-  // Handle serial commands
-  if(Serial.available()) {
-    char inChar = (char)Serial.read();
-    Serial.println();
-    Serial.print("Received: ");
-    Serial.println(inChar);
-
-    // PREPARATION PHASE
-    if (inChar == 'P' || inChar == 'p') {
-      show_Weighing_Results = false;
-      hx711_busy = true;  // Protect HX711 operations
-      delay(1000);
-      
-      // Check HX711 multiple times with longer delays
-      bool hx711_ready = false;
-      for (int i = 0; i < 20; i++) {
-        if (LOADCELL_HX711.is_ready()) {
-          hx711_ready = true;
-          break;
-        }
-        delay(200);  // Longer delay between checks
-      }
-      
-      if (hx711_ready) {  
-        Serial.println("PREPARATION PHASE");
-        Serial.println("Remove all objects from scale!");
-        
-        displayCalibrationStatus("Remove all objects", 0);
-        delay(3000);  // Longer delay for stability
-        
-        for (byte i = 5; i > 0; i--) {
-          Serial.printf("   %d...\n", i);
-          displayCalibrationStatus("Preparing...", i);
-          delay(1500);  // Longer delays during calibration
-        }
-        
-        LOADCELL_HX711.set_scale(); 
-        Serial.println("Setting baseline...");
-        displayCalibrationStatus("Setting baseline...");
-        delay(2000);  // Extra time for baseline
-        
-        LOADCELL_HX711.tare();
-        Serial.println("Scale zeroed");
-        Serial.printf("Place %d gram weight\n", weight_of_object_for_calibration);
-        
-        displayCalibrationStatus("Place 172g weight");
-        delay(3000);
-        
-        for (byte i = 5; i > 0; i--) {
-          Serial.printf("   %d...\n", i);
-          displayCalibrationStatus("Wait...", i);
-          delay(1500);
-        }
-        
-        Serial.println("Send 'C' to calibrate...");
-        displayCalibrationStatus("Send 'C' to start");
-      } else {
-        Serial.println("HX711 not ready!");
-        displayCalibrationStatus("HX711 ERROR!");
-      }
-      hx711_busy = false;  // Release protection
-    }
-
-    // CALIBRATION PHASE
-    if (inChar == 'C' || inChar == 'c') {
-      hx711_busy = true;  // Protect HX711 operations
-      
-      // Check HX711 multiple times with longer delays
-      bool hx711_ready = false;
-      for (int i = 0; i < 20; i++) {
-        if (LOADCELL_HX711.is_ready()) {
-          hx711_ready = true;
-          break;
-        }
-        delay(200);
-      }
-      
-      if (hx711_ready) {
-        Serial.println("CALIBRATION PHASE");
-        Serial.println("Taking readings...");
-        
-        displayCalibrationStatus("Calibrating...");
-        
-        for (byte i = 0; i < 5; i++) {
-          delay(1000);  // Wait before each reading
-          sensor_Reading_Results = LOADCELL_HX711.get_units(15);  // More averaging for calibration
-          Serial.printf("Reading %d: %ld\n", i+1, sensor_Reading_Results);
-          delay(1000);  // Wait after each reading
-        }
-
-        CALIBRATION_FACTOR = (float)sensor_Reading_Results / weight_of_object_for_calibration; 
-
-        Serial.println("Saving to flash...");
-        preferences.putFloat("CFVal", CALIBRATION_FACTOR); 
-        delay(500);
-
-        Serial.println("Loading from flash...");
-        float LOAD_CALIBRATION_FACTOR = preferences.getFloat("CFVal", 0);
-        LOADCELL_HX711.set_scale(LOAD_CALIBRATION_FACTOR);
-        delay(1000);  // Extra time for scale setting
-
-        Serial.printf("CALIBRATION FACTOR: %.6f\n", LOAD_CALIBRATION_FACTOR);
-
-        calibration_completed = true;
-        show_Weighing_Results = true;
-
-        Serial.println("CALIBRATION COMPLETE!");
-        Serial.println("Ready for bottle counting!");
-        
-        displayCalibrationComplete(LOAD_CALIBRATION_FACTOR);
-      } else {
-        Serial.println("HX711 not ready!");
-        displayCalibrationStatus("HX711 ERROR!");
-      }
-      hx711_busy = false;  // Release protection
-    }
-  }
-
-  // Display weight and bottle count with protected HX711 operations
-  if (show_Weighing_Results && calibration_completed && !hx711_busy) {
-    if (currentTime - lastHX711Reading >= hx711ReadingInterval) {
-      
-      hx711_busy = true;  // Protect this operation
-      
-      // Check if HX711 is ready with patience
-      bool hx711_ready = false;
-      for (int attempts = 0; attempts < 10; attempts++) {
-        if (LOADCELL_HX711.is_ready()) {
-          hx711_ready = true;
-          break;
-        }
-        delay(50);  // Short delay between ready checks
-      }
-      
-      if (hx711_ready) {
-        // Get weight readings with error handling
-        long raw_reading = LOADCELL_HX711.get_units(3);  // Less averaging for faster response
-        
-        // Only update if reading seems valid (not too far from previous)
-        if (abs(raw_reading) < 50000) {  // Reasonable bounds check
-          weight_In_g = raw_reading;
-          
-          if (weight_In_g < 0) weight_In_g = 0;
-          
-          weight_In_oz = (float)weight_In_g / 28.34952;
-          
-          bottle_count = round((float)weight_In_g / BOTTLE_WEIGHT);
-          if (bottle_count < 0) bottle_count = 0;
-          
-          // Update status based on bottle count changes
-          updateStatus(bottle_count);
-          
-          // Reset failure counter
-          consecutive_failures = 0;
-          
-          // Update display less frequently to reduce interference
-          if (currentTime - lastDisplayUpdate >= displayUpdateInterval) {
-            displayWeight();
-            lastDisplayUpdate = currentTime;
-          }
-          
-          // MQTT publish with separate timing and connection check
-          if (currentTime - lastMQTTPublish >= mqttPublishInterval) {
-            Serial.printf("  %dg | %.1foz | %d bottles | %s\n", 
-                         weight_In_g, weight_In_oz, bottle_count, current_status.c_str());
-            
-            // Publish MQTT data
-            publishMQTTData();
-            
-            lastMQTTPublish = currentTime;
-          }
-        } else {
-          Serial.printf("Invalid HX711 reading: %ld\n", raw_reading);
-          consecutive_failures++;
-        }
-        
-        lastHX711Reading = currentTime;
-      } else {
-        consecutive_failures++;
-        
-        if (consecutive_failures >= MAX_CONSECUTIVE_FAILURES) {
-          display.clearDisplay();
-          display.setTextSize(1);
-          display.setTextColor(SSD1306_WHITE);
-          display.setCursor(0, 20);
-          display.println("HX711 Communication");
-          display.println("Error - Retrying...");
-          display.display();
-          Serial.println("HX711 communication error - retrying...");
-          
-          // Try to reinitialize HX711
-          delay(500);
-          LOADCELL_HX711.begin(LOADCELL_DOUT_PIN, LOADCELL_SCK_PIN);
-          delay(500);
-          
-          consecutive_failures = 0;
-        }
-      }
-      
-      hx711_busy = false;  // Release protection
-    }
-  } else if (!calibration_completed) {
-    static unsigned long lastWelcomeUpdate = 0;
-    if (millis() - lastWelcomeUpdate >= 5000) {
-      displayWelcomeScreen();
-      lastWelcomeUpdate = millis();
-    }
-  }
-
-  // Minimal delay to prevent watchdog issues while allowing quick response
-  delay(10);
+  // Everything runs on the tasks started in setup(); the Arduino loop task
+  // only gives its stack back
+  vTaskDelete(NULL);
 }
 
 void setupWiFi() {
@@ -968,66 +1674,283 @@ void setupWiFi() {
   if (!res) {
     Serial.println("Failed to connect to WiFi");
     // Don't restart immediately, allow HX711 to continue working
-    Serial.println("Continuing without WiFi...");
+    Serial.println("Continuing without WiFi - retrying in the background...");
   } else {
     Serial.println("Connected to WiFi");
     Serial.print("IP Address: ");
     Serial.println(WiFi.localIP());
   }
+  
+  // From here on drops are retried from WiFi events with backoff
+  // (wifi_link.h), using the credentials WiFiManager stored
+  wifiLinkBegin(NULL, NULL);
 }
 
 void setupMQTT() {
-  mqttClient.setServer("broker.hivemq.com", 1883);
-  mqttClient.setCallback(receviveCallback);
-  
-  // Set shorter timeouts to avoid blocking
-  mqttClient.setSocketTimeout(5);  // 5 second timeout
+  // Unique client ID: prefix + MAC without separators
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(mqtt_client_id_full, sizeof(mqtt_client_id_full), "%s%02X%02X%02X%02X%02X%02X",
+           mqtt_client_id, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  
+  buildTopic(mqtt_topic_frame, "frame");
+  buildTopic(mqtt_topic_samples, "samples");
+  buildTopic(mqtt_topic_diag, "diag");
+  buildTopic(mqtt_topic_trace, "trace");
+  buildTopic(mqtt_topic_nfc_vehicle, "nfc/vehicle-id");
+  buildTopic(mqtt_topic_nfc_transaction, "nfc/transaction");
+  buildTopic(mqtt_topic_nfc_status, "nfc/status");
+  buildTopic(mqtt_topic_nfc_ack, "nfc/ack");
+  buildTopic(mqtt_topic_command, "cmd");
+  buildTopic(mqtt_topic_command_response, "cmd-response");
+  Serial.printf("📡 MQTT topics: %s%s/#\n", MQTT_TOPIC_ROOT, mqtt_client_id_full);
+  
+  // Only messages addressed to this pallet
+  static const char* const subscriptions[] = {
+    mqtt_topic_nfc_ack, mqtt_topic_command, mqtt_topic_command_all
+  };
+  
+  MqttLinkConfig config = {};
+  config.host = "broker.hivemq.com";
+  config.port = 1883;
+  config.client_id = mqtt_client_id_full;
+  config.subscriptions = subscriptions;
+  config.subscription_count = sizeof(subscriptions) / sizeof(subscriptions[0]);
+  config.on_message = receviveCallback;
+  config.on_idle = drainTransactionQueue;
+  config.buffer_size = MQTT_BUFFER_SIZE;
+  
+  mqttLinkBegin(&config);
+}
+
+// MQTT_TOPIC_ROOT + client ID + "/" + stream into a MQTT_TOPIC_SIZE buffer
+void buildTopic(char* topic, const char* stream) {
+  snprintf(topic, MQTT_TOPIC_SIZE, "%s%s/%s", MQTT_TOPIC_ROOT, mqtt_client_id_full, stream);
+}
+
+// Send (and resend) queued NFC transactions whenever the link is idle
+void drainTransactionQueue() {
+  if (txQueuePending() > 0) {
+    txQueueService(publishQueuedTransaction, millis());
+  }
 }
 
-void connectToBroker() {
-  // Only try to connect if WiFi is connected
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi not connected, skipping MQTT");
+void receviveCallback(char* topic, byte* payload, unsigned int length) {
+  // Transaction acknowledged by the backend: the payload is its tx_id
+  if (strcmp(topic, mqtt_topic_nfc_ack) == 0) {
+    char tx_id[TXQ_ID_LENGTH];
+    unsigned int id_length = length < TXQ_ID_LENGTH - 1 ? length : TXQ_ID_LENGTH - 1;
+    memcpy(tx_id, payload, id_length);
+    tx_id[id_length] = '\0';
+    if (txQueueAck(tx_id)) {
+      Serial.printf("✅ Transaction %s acknowledged (%lu pending)\n", tx_id,
+                    (unsigned long)txQueuePending());
+    }
     return;
   }
   
-  // Non-blocking connection attempt with longer intervals
-  static unsigned long lastConnectionAttempt = 0;
-  unsigned long currentTime = millis();
-  
-  if (currentTime - lastConnectionAttempt < 15000) {  // Wait 15 seconds between attempts
+  // Remote command: parsed here, executed by the console task
+  if (strcmp(topic, mqtt_topic_command) == 0 || strcmp(topic, mqtt_topic_command_all) == 0) {
+    if (remoteCommandReceive(payload, length)) {
+      xEventGroupSetBits(system_events, EVENT_COMMAND_QUEUED);
+    } else {
+      Serial.printf("⚠️ Remote command dropped (%u bytes)\n", length);
+    }
     return;
   }
   
-  lastConnectionAttempt = currentTime;
-  
-  Serial.println("Connecting to MQTT Broker...");
-  
-  // Create unique client ID using the defined prefix
-  String clientId = String(mqtt_client_id) + String(WiFi.macAddress());
-  clientId.replace(":", "");
+  // Anything else is only logged, straight from the PubSubClient buffer
+  Serial.printf("Message arrived [%s] %.*s\n", topic, (int)length, (const char*)payload);
+}
+
+// Runs the next queued command, if any; tare and calibration take the
+// HX711 for a second or two, like their serial counterparts
+bool processRemoteCommand() {
+  RemoteCommand command;
+  if (!remoteCommandNext(&command)) {
+    return false;
+  }
+  STAGE_TIMER("command");
+  
+  StaticJsonDocument<REMOTE_RESPONSE_JSON_CAPACITY> response;
+  response["id"] = command.id;
+  const char* error = command.error;
+  if (command.op != CMD_INVALID) {
+    response["cmd"] = remoteCommandName(command.op);
+    JsonObject result = response.createNestedObject("result");
+    executeRemoteCommand(&command, result, &error);
+    if (error != NULL) {
+      response.remove("result");
+    }
+  }
+  response["ok"] = error == NULL;
+  if (error != NULL) {
+    response["error"] = error;
+  }
   
-  if (mqttClient.connect(clientId.c_str())) {
-    Serial.println("Connected to MQTT Broker");
-    mqttClient.subscribe("weight_count");
-    mqttClient.subscribe(mqtt_topic_data);
-  } else {
-    Serial.print("Failed to connect to MQTT, rc=");
-    Serial.println(mqttClient.state());
-    Serial.println("Will retry in 15 seconds...");
+  Serial.printf("📟 Remote %s [%s]: %s\n", remoteCommandName(command.op), command.id,
+                error != NULL ? error : "ok");
+  publishCommandResponse(&command, response);
+  return true;
+}
+
+void executeRemoteCommand(const RemoteCommand* command, JsonObject result, const char** error) {
+  switch (command->op) {
+    case CMD_TARE: {
+      EventBits_t events = scaleAcquire();
+      bool ready = LOADCELL_HX711.wait_ready_timeout(1000);
+      if (ready) {
+        LOADCELL_HX711.tare();
+      }
+      long offset = LOADCELL_HX711.get_offset();
+      scaleRelease(events & EVENT_WEIGHING);
+      if (!ready) {
+        *error = "HX711 not ready";
+        return;
+      }
+      scale_tared = true;
+      sendScaleEvent(SCALE_ZEROED);
+      result["offset"] = offset;
+      return;
+    }
+    
+    case CMD_CALIBRATE: {
+      // Same factor as the serial P/C sequence: counts above the empty-scale
+      // offset per gram of the reference weight now on the scale
+      long reference_g = command->has_value ? command->value : weight_of_object_for_calibration;
+      if (reference_g <= 0) {
+        *error = "value out of range";
+        return;
+      }
+      if (!scale_tared) {
+        *error = "tare the empty scale first";
+        return;
+      }
+      EventBits_t events = scaleAcquire();
+      if (!LOADCELL_HX711.wait_ready_timeout(1000)) {
+        scaleRelease(events & EVENT_WEIGHING);
+        *error = "HX711 not ready";
+        return;
+      }
+      double counts = LOADCELL_HX711.get_value(15);
+      if (fabs(counts) < REMOTE_CALIBRATION_MIN_COUNTS) {
+        scaleRelease(events & EVENT_WEIGHING);
+        *error = "no load on the scale";
+        return;
+      }
+      
+      CALIBRATION_FACTOR = (float)(counts / reference_g);
+      preferences.putFloat("CFVal", CALIBRATION_FACTOR);
+      LOADCELL_HX711.set_scale(CALIBRATION_FACTOR);
+      xEventGroupSetBits(system_events, EVENT_CALIBRATED);
+      scaleRelease(true);
+      result["factor"] = CALIBRATION_FACTOR;
+      result["reference_g"] = reference_g;
+      return;
+    }
+    
+    case CMD_SET_INTERVAL:
+    case CMD_SET_DEADBAND:
+    case CMD_SET_UNIT_WEIGHT: {
+      DeviceConfigKey key = command->op == CMD_SET_INTERVAL ? CONFIG_PUBLISH_INTERVAL
+                          : command->op == CMD_SET_DEADBAND ? CONFIG_WEIGHT_DEADBAND
+                          : CONFIG_UNIT_WEIGHT;
+      DeviceConfigResult set_result = deviceConfigSet(key, command->value);
+      if (set_result == CONFIG_OUT_OF_RANGE) {
+        *error = "value out of range";
+        return;
+      }
+      
+      // The NFC task applies it to the report policy and the count
+      sendScaleEvent(SCALE_CONFIG_CHANGED);
+      result[deviceConfigKeyName(key)] = command->value;
+      result["saved"] = set_result == CONFIG_OK;
+      return;
+    }
+    
+    case CMD_TRACE: {
+#if EVENT_TRACE
+      int32_t events = command->has_value ? command->value : TRACE_MQTT_EVENTS;
+      if (events <= 0) {
+        *error = "value out of range";
+        return;
+      }
+      uint32_t sent = 0;
+      uint32_t messages = 0;
+      if (!uploadTrace(events, &sent, &messages)) {
+        *error = "trace upload stalled";
+        return;
+      }
+      result["events"] = sent;
+      result["messages"] = messages;
+      result["capacity"] = eventTraceCapacity();
+#else
+      *error = "built without EVENT_TRACE";
+#endif
+      return;
+    }
+    
+    case CMD_REBOOT:
+      reboot_requested_at = millis() | 1;  // Never 0, which means none pending
+      result["in_ms"] = REMOTE_REBOOT_DELAY;
+      return;
+    
+    case CMD_STATS: {
+      DeviceClockStatus clock_status = deviceClockStatus();
+      MqttLinkStats link_stats = mqttLinkStats();
+      const TxQueueStats* queue_stats = txQueueStats();
+      WifiLinkStats wifi_stats = wifiLinkStats();
+      const DeviceConfig* config = deviceConfig();
+      result["uptime_s"] = millis() / 1000;
+      result["boot"] = clock_status.boot_count;
+      result["heap"] = ESP.getFreeHeap();
+      result["heap_min"] = ESP.getMinFreeHeap();
+      result["heap_max_block"] = ESP.getMaxAllocHeap();
+      result["synced"] = clock_status.synced;
+      result["drift_ppm"] = clock_status.drift_ppm;
+      // Counters of the other tasks are single words, read without a lock
+      result["frames"] = frame_sequence;
+      result["suppressed"] = report_policy.suppressed;
+      result["latency_us"] = publish_latency.last_us;
+      result["latency_max_us"] = publish_latency.max_us;
+      result["readings_dropped"] = readings_dropped;
+      result["mqtt_sent"] = link_stats.sent;
+      result["mqtt_lost"] = link_stats.overwritten + link_stats.rejected;
+      result["reconnects"] = link_stats.connects;
+      result["wifi_drops"] = wifi_stats.disconnects;
+      result["wifi_down_s"] = (wifi_stats.total_down_ms + wifi_stats.down_ms) / 1000;
+      result["txq_pending"] = queue_stats->pending;
+      result["txq_resent"] = queue_stats->resent;
+      result["txq_dropped"] = queue_stats->dropped;
+#if SAMPLE_BATCHING
+      result["windows_dropped"] = sample_windows_dropped;
+#endif
+      result["interval"] = config->publish_interval;
+      result["deadband"] = config->weight_deadband;
+      result["unit_weight"] = config->unit_weight_g;
+      return;
+    }
+    
+    default:
+      *error = "unknown cmd";
+      return;
   }
 }
 
-void receviveCallback(char* topic, byte* payload, unsigned int length) {
-  Serial.print("Message arrived [");
-  Serial.print(topic);
-  Serial.print("] ");
+void publishCommandResponse(const RemoteCommand* command, JsonDocument& response) {
+  static char response_text[MQTT_OUTBOX_MAX_PAYLOAD];
   
-  char payloadCharAr[length + 1];
-  for (int i = 0; i < length; i++) {
-    Serial.print((char)payload[i]);
-    payloadCharAr[i] = (char)payload[i];
+  if (measureJson(response) >= sizeof(response_text)) {
+    response.clear();
+    response["id"] = command->id;
+    response["ok"] = false;
+    response["error"] = "response too large";
   }
-  payloadCharAr[length] = '\0';
-  Serial.println();
-}
\ No newline at end of file
+  size_t length = serializeJson(response, response_text, sizeof(response_text));
+  
+  // Responses are never overwritten by telemetry
+  if (!mqttLinkPublish(mqtt_topic_command_response, (const uint8_t*)response_text, length,
+                       MQTT_TRANSACTION)) {
+    Serial.printf("⚠️ Response to [%s] not queued\n", command->id);
+  }
+}
@@ -0,0 +1,76 @@
+/*
+ * NFC duplicate-read suppression cache
+ * Fixed array with timestamps; the least recently seen card is evicted.
+ */
+
+#include "nfc_presence.h"
+
+static NFCPresenceEntry presence_cache[NFC_PRESENCE_SLOTS];
+
+void nfcPresenceBegin() {
+  for (int i = 0; i < NFC_PRESENCE_SLOTS; i++) {
+    presence_cache[i].in_use = false;
+    presence_cache[i].present = false;
+  }
+}
+
+static NFCPresenceEntry* findEntry(const char* uid) {
+  for (int i = 0; i < NFC_PRESENCE_SLOTS; i++) {
+    if (presence_cache[i].in_use && strcmp(presence_cache[i].uid, uid) == 0) {
+      return &presence_cache[i];
+    }
+  }
+  return NULL;
+}
+
+static NFCPresenceEntry* allocateEntry(unsigned long now) {
+  // Prefer a free slot, then the card that left the reader longest ago
+  NFCPresenceEntry* victim = NULL;
+  for (int i = 0; i < NFC_PRESENCE_SLOTS; i++) {
+    NFCPresenceEntry* entry = &presence_cache[i];
+    if (!entry->in_use) {
+      return entry;
+    }
+    if (victim == NULL ||
+        (victim->present && !entry->present) ||
+        (victim->present == entry->present && now - entry->last_seen > now - victim->last_seen)) {
+      victim = entry;
+    }
+  }
+  return victim;
+}
+
+NFCPresenceEvent nfcPresenceSeen(const char* uid, unsigned long now) {
+  NFCPresenceEntry* entry = findEntry(uid);
+
+  if (entry != NULL && entry->present && now - entry->last_seen < NFC_REMOVAL_TIMEOUT) {
+    entry->last_seen = now;
+    entry->reads++;
+    return NFC_CARD_REPEAT;
+  }
+
+  if (entry == NULL) {
+    entry = allocateEntry(now);
+    entry->in_use = true;
+    strncpy(entry->uid, uid, VEHICLE_ID_LENGTH - 1);
+    entry->uid[VEHICLE_ID_LENGTH - 1] = '\0';
+  }
+
+  entry->present = true;
+  entry->arrival_time = now;
+  entry->last_seen = now;
+  entry->reads = 1;
+  return NFC_CARD_PRESENT;
+}
+
+void nfcPresenceExpire(unsigned long now, void (*on_removed)(const char* uid, unsigned long dwell_ms)) {
+  for (int i = 0; i < NFC_PRESENCE_SLOTS; i++) {
+    NFCPresenceEntry* entry = &presence_cache[i];
+    if (entry->in_use && entry->present && now - entry->last_seen >= NFC_REMOVAL_TIMEOUT) {
+      entry->present = false;
+      if (on_removed != NULL) {
+        on_removed(entry->uid, entry->last_seen - entry->arrival_time);
+      }
+    }
+  }
+}
@@ -0,0 +1,175 @@
+/*
+ * Round-robin PN532 reader scheduler
+ */
+
+#include "nfc_readers.h"
+#include "stage_timer.h"
+#include "event_trace.h"
+
+static NFCReader* nfc_readers = NULL;
+static int nfc_reader_count = 0;
+static int next_reader = 0;
+
+static bool initializeReader(NFCReader* reader) {
+  reader->pn532->begin();
+  delay(500);
+
+  for (int attempts = 0; attempts < 3; attempts++) {
+    uint32_t versiondata = reader->pn532->getFirmwareVersion();
+    if (versiondata) {
+      Serial.printf("✅ PN532 [%s] found - chip PN5%X, firmware %d.%d\n", reader->name,
+                    (unsigned int)((versiondata >> 24) & 0xFF),
+                    (int)((versiondata >> 16) & 0xFF), (int)((versiondata >> 8) & 0xFF));
+      reader->pn532->SAMConfig();
+      return true;
+    }
+
+    Serial.printf("❌ PN532 [%s] not found, retrying (%d/3)...\n", reader->name, attempts + 1);
+
+    // Power cycle attempt
+    if (attempts == 1) {
+      delay(2000);
+      reader->pn532->begin();
+    }
+    delay(1000);
+  }
+  return false;
+}
+
+static void armReader(NFCReader* reader) {
+  if (reader->irq_pin == NFC_NO_IRQ) {
+    // Polled readers give up quickly instead of retrying until a card shows
+    reader->pn532->setPassiveActivationRetries(NFC_PASSIVE_RETRIES);
+    reader->detecting = false;
+  } else {
+    reader->detecting = reader->pn532->startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+  }
+}
+
+int nfcReadersBegin(NFCReader* readers, int count) {
+  nfc_readers = readers;
+  nfc_reader_count = min(count, MAX_NFC_READERS);
+  next_reader = 0;
+
+  int found = 0;
+  for (int i = 0; i < nfc_reader_count; i++) {
+    NFCReader* reader = &nfc_readers[i];
+    if (reader->irq_pin != NFC_NO_IRQ) {
+      pinMode(reader->irq_pin, INPUT_PULLUP);
+    }
+
+    reader->available = initializeReader(reader);
+    reader->detecting = false;
+    reader->last_check = millis();
+    reader->last_health_check = millis();
+    reader->cards_read = 0;
+    reader->failures = 0;
+
+    if (reader->available) {
+      armReader(reader);
+      found++;
+    }
+  }
+  return found;
+}
+
+static void formatUID(const uint8_t* uid, uint8_t uid_length, char* vehicle_id) {
+  static const char hex[] = "0123456789ABCDEF";
+  uint8_t length = min(uid_length, (uint8_t)NFC_UID_MAX_LENGTH);
+  for (uint8_t i = 0; i < length; i++) {
+    vehicle_id[i * 2] = hex[uid[i] >> 4];
+    vehicle_id[i * 2 + 1] = hex[uid[i] & 0x0F];
+  }
+  vehicle_id[length * 2] = '\0';
+}
+
+static void checkReaderHealth(NFCReader* reader, unsigned long now) {
+  // Check if the PN532 is still responding; this aborts any armed detection
+  if (now - reader->last_health_check < NFC_HEALTH_CHECK_INTERVAL) {
+    return;
+  }
+  reader->last_health_check = now;
+
+  if (!reader->pn532->getFirmwareVersion()) {
+    Serial.printf("PN532 [%s] communication lost!\n", reader->name);
+    reader->available = false;
+    reader->detecting = false;
+    reader->failures++;
+    reader->last_check = now;
+    return;
+  }
+  armReader(reader);
+}
+
+static bool serviceReader(NFCReader* reader, char* vehicle_id) {
+  unsigned long now = millis();
+
+  // Retry a lost reader every 30 seconds
+  if (!reader->available) {
+    if (now - reader->last_check > NFC_RECONNECT_INTERVAL) {
+      if (reader->pn532->getFirmwareVersion()) {
+        Serial.printf("PN532 [%s] reconnected!\n", reader->name);
+        reader->pn532->SAMConfig();
+        reader->available = true;
+        reader->last_health_check = now;
+        armReader(reader);
+      }
+      reader->last_check = now;
+    }
+    return false;
+  }
+
+  uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0 };
+  uint8_t uidLength = 0;
+  bool success = false;
+
+  if (reader->irq_pin != NFC_NO_IRQ) {
+    // Asynchronous: only talk to the PN532 once it signals a result
+    if (!reader->detecting) {
+      armReader(reader);
+      return false;
+    }
+    if (digitalRead(reader->irq_pin) == LOW) {
+      success = reader->pn532->readDetectedPassiveTargetID(uid, &uidLength);
+      armReader(reader);
+    }
+  } else {
+    success = reader->pn532->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength,
+                                                 NFC_POLL_SLOT_TIMEOUT);
+  }
+
+  if (success && uidLength > 0) {
+    reader->cards_read++;
+    reader->last_health_check = now;
+    formatUID(uid, uidLength, vehicle_id);
+    return true;
+  }
+
+  checkReaderHealth(reader, now);
+  return false;
+}
+
+bool nfcReadersPoll(char* vehicle_id, int* reader_index) {
+  if (nfc_reader_count == 0) {
+    return false;
+  }
+  STAGE_TIMER("nfc_poll");
+  TRACE_SCOPE("nfc_poll");
+
+  int index = next_reader;
+  next_reader = (next_reader + 1) % nfc_reader_count;
+
+  if (serviceReader(&nfc_readers[index], vehicle_id)) {
+    *reader_index = index;
+    return true;
+  }
+  return false;
+}
+
+int nfcReadersAvailableCount() {
+  int count = 0;
+  for (int i = 0; i < nfc_reader_count; i++) {
+    if (nfc_readers[i].available) count++;
+  }
+  return count;
+}
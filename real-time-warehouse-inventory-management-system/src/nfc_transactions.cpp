@@ -0,0 +1,238 @@
+/*
+ * Open NFC transaction table
+ * Fixed array of slots keyed by vehicle UID - no heap allocation.
+ */
+
+#include "nfc_transactions.h"
+#include "weight_history.h"
+
+static NFCTransaction transactions[MAX_OPEN_TRANSACTIONS];
+
+void nfcTransactionsBegin() {
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    transactions[i].state = NFC_IDLE;
+    transactions[i].vehicle_id[0] = '\0';
+  }
+}
+
+bool nfcTransactionIsOpen(const NFCTransaction* tx) {
+  return tx != NULL && (tx->state == NFC_LOAD_READY || tx->state == NFC_UNLOAD_READY);
+}
+
+NFCTransaction* nfcTransactionFind(const char* vehicle_id) {
+  // A vehicle's open entry wins over a completed one still being reported
+  NFCTransaction* found = NULL;
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (tx->state != NFC_IDLE && strcmp(tx->vehicle_id, vehicle_id) == 0) {
+      if (nfcTransactionIsOpen(tx)) {
+        return tx;
+      }
+      found = tx;
+    }
+  }
+  return found;
+}
+
+// Completed entries can be reused once their result has been reported
+static bool isReusable(const NFCTransaction* tx) {
+  return tx->state == NFC_IDLE || (!nfcTransactionIsOpen(tx) && tx->end_resolved);
+}
+
+NFCTransaction* nfcTransactionOpen(const char* vehicle_id, NFCTransactionState state,
+                                   unsigned long tap_time, int bottles) {
+  // Reuse the vehicle's own completed entry, then a free slot, then the
+  // oldest reported entry - open and unreported entries are never evicted
+  NFCTransaction* slot = nfcTransactionFind(vehicle_id);
+  if (slot != NULL && nfcTransactionIsOpen(slot)) {
+    return NULL;
+  }
+  if (slot != NULL && !isReusable(slot)) {
+    slot = NULL;
+  }
+
+  for (int i = 0; slot == NULL && i < MAX_OPEN_TRANSACTIONS; i++) {
+    if (transactions[i].state == NFC_IDLE) {
+      slot = &transactions[i];
+    }
+  }
+
+  if (slot == NULL) {
+    for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+      NFCTransaction* candidate = &transactions[i];
+      if (!isReusable(candidate)) continue;
+      if (slot == NULL || (long)(candidate->resolved_at - slot->resolved_at) < 0) {
+        slot = candidate;
+      }
+    }
+  }
+
+  if (slot == NULL) {
+    return NULL;
+  }
+
+  slot->state = state;
+  strncpy(slot->vehicle_id, vehicle_id, VEHICLE_ID_LENGTH - 1);
+  slot->vehicle_id[VEHICLE_ID_LENGTH - 1] = '\0';
+  slot->start_time = tap_time;
+  slot->last_tap_time = tap_time;
+  slot->end_time = 0;
+  slot->resolved_at = 0;
+  slot->start_bottles = bottles;
+  slot->end_bottles = bottles;
+  slot->attributed_bottles = 0;
+  slot->start_resolved = false;
+  slot->end_resolved = false;
+  slot->overlapped = false;
+
+  // Vehicles working the pallet at the same time share its count changes
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* other = &transactions[i];
+    if (other != slot && nfcTransactionIsOpen(other)) {
+      other->overlapped = true;
+      slot->overlapped = true;
+    }
+  }
+  return slot;
+}
+
+void nfcTransactionClose(NFCTransaction* tx, unsigned long tap_time, int bottles) {
+  tx->state = (tx->state == NFC_UNLOAD_READY) ? NFC_UNLOAD_COMPLETE : NFC_LOAD_COMPLETE;
+  tx->last_tap_time = tap_time;
+  tx->end_time = tap_time;
+  tx->end_bottles = bottles;
+  tx->end_resolved = false;
+}
+
+int nfcTransactionBottleDifference(const NFCTransaction* tx) {
+  bool unloading = (tx->state == NFC_UNLOAD_READY || tx->state == NFC_UNLOAD_COMPLETE);
+  int change = tx->overlapped ? tx->attributed_bottles : tx->end_bottles - tx->start_bottles;
+  return unloading ? change : -change;
+}
+
+void nfcTransactionsResolve(unsigned long now, void (*on_complete)(const NFCTransaction* tx)) {
+  WeightSample sample;
+
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (tx->state == NFC_IDLE) continue;
+
+    // Wait for a sample after the tap so motion right after it can be seen
+    if (!tx->start_resolved && weightHistoryHasSampleAfter(tx->start_time)) {
+      if (weightHistoryStableAt(tx->start_time, &sample)) {
+        tx->start_bottles = sample.bottles;
+      }
+      tx->start_resolved = true;
+    }
+
+    if (nfcTransactionIsOpen(tx) || tx->end_resolved) continue;
+
+    // Give up waiting after TRANSACTION_RESULT_HOLD (e.g. HX711 stalled)
+    bool timed_out = now - tx->end_time >= TRANSACTION_RESULT_HOLD;
+    if (weightHistoryHasSampleAfter(tx->end_time) || timed_out) {
+      if (weightHistoryStableAt(tx->end_time, &sample)) {
+        tx->end_bottles = sample.bottles;
+      }
+      tx->start_resolved = true;
+      tx->end_resolved = true;
+      tx->resolved_at = now;
+      if (on_complete != NULL) on_complete(tx);
+    }
+  }
+}
+
+void nfcTransactionsAttribute(int bottle_delta, unsigned long sample_time) {
+  // A change belongs to a vehicle whose transaction was already open when the
+  // sample was taken. When several are open, prefer one whose direction
+  // matches (LOAD takes bottles off, UNLOAD puts them on), then the vehicle
+  // that tapped most recently.
+  NFCTransaction* best = NULL;
+  bool best_matches = false;
+
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (!nfcTransactionIsOpen(tx)) continue;
+    if ((long)(sample_time - tx->start_time) < 0) continue;
+
+    bool matches = (tx->state == NFC_LOAD_READY) ? (bottle_delta < 0) : (bottle_delta > 0);
+    if (best == NULL ||
+        (matches && !best_matches) ||
+        (matches == best_matches && (long)(tx->last_tap_time - best->last_tap_time) > 0)) {
+      best = tx;
+      best_matches = matches;
+    }
+  }
+
+  if (best != NULL) {
+    best->attributed_bottles += bottle_delta;
+  }
+}
+
+void nfcTransactionsRebase() {
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (!nfcTransactionIsOpen(tx)) continue;
+    tx->overlapped = true;
+    tx->start_resolved = true;
+  }
+}
+
+void nfcTransactionsRescale(long from_unit_g, long to_unit_g) {
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (!nfcTransactionIsOpen(tx)) continue;
+    tx->attributed_bottles = round((float)tx->attributed_bottles * from_unit_g / to_unit_g);
+  }
+  nfcTransactionsRebase();
+}
+
+void nfcTransactionsExpire(unsigned long now, void (*on_timeout)(const NFCTransaction* tx)) {
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (tx->state == NFC_IDLE) continue;
+
+    if (nfcTransactionIsOpen(tx)) {
+      if (now - tx->last_tap_time >= TRANSACTION_TIMEOUT) {
+        if (on_timeout != NULL) on_timeout(tx);
+        tx->state = NFC_IDLE;
+      }
+    } else if (tx->end_resolved && now - tx->resolved_at >= TRANSACTION_RESULT_HOLD) {
+      tx->state = NFC_IDLE;
+    }
+  }
+}
+
+NFCTransaction* nfcTransactionLatest() {
+  NFCTransaction* latest = NULL;
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    NFCTransaction* tx = &transactions[i];
+    if (tx->state == NFC_IDLE) continue;
+    if (latest == NULL || (long)(tx->last_tap_time - latest->last_tap_time) > 0) {
+      latest = tx;
+    }
+  }
+  return latest;
+}
+
+int nfcTransactionsOpenCount() {
+  int count = 0;
+  for (int i = 0; i < MAX_OPEN_TRANSACTIONS; i++) {
+    if (nfcTransactionIsOpen(&transactions[i])) count++;
+  }
+  return count;
+}
+
+const char* nfcStateName(NFCTransactionState state) {
+  switch (state) {
+    case NFC_LOAD_READY: return "load_ready";
+    case NFC_LOAD_COMPLETE: return "load_complete";
+    case NFC_UNLOAD_READY: return "unload_ready";
+    case NFC_UNLOAD_COMPLETE: return "unload_complete";
+    default: return "idle";
+  }
+}
+
+const char* nfcTransactionType(const NFCTransaction* tx) {
+  bool unloading = (tx->state == NFC_UNLOAD_READY || tx->state == NFC_UNLOAD_COMPLETE);
+  return unloading ? "UNLOAD" : "LOAD";
+}
@@ -0,0 +1,115 @@
+/*
+ * Remote command parser - bounded JSON parse on the network task, FreeRTOS
+ * queue to the console task
+ */
+
+#include "remote_commands.h"
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+static const char* const command_names[] = {
+  "invalid", "tare", "calibrate", "set_interval", "set_deadband", "set_unit_weight", "reboot", "stats", "trace"
+};
+static const int command_name_count = sizeof(command_names) / sizeof(command_names[0]);
+
+static QueueHandle_t command_queue = NULL;
+static RemoteCommandStats stats;          // Written by the network task only
+
+void remoteCommandsBegin() {
+  if (command_queue == NULL) {
+    command_queue = xQueueCreate(REMOTE_COMMAND_QUEUE_DEPTH, sizeof(RemoteCommand));
+  }
+  memset(&stats, 0, sizeof(stats));
+}
+
+static RemoteCommandOp lookupCommand(const char* name) {
+  for (int i = 1; i < command_name_count; i++) {
+    if (strcmp(name, command_names[i]) == 0) {
+      return (RemoteCommandOp)i;
+    }
+  }
+  return CMD_INVALID;
+}
+
+// Fills command from the message; returns the error text or NULL
+static const char* parseCommand(const uint8_t* payload, unsigned int length, RemoteCommand* command) {
+  StaticJsonDocument<REMOTE_COMMAND_JSON_CAPACITY> doc;
+  DeserializationError parse_error = deserializeJson(doc, (const char*)payload, length,
+                                                     DeserializationOption::NestingLimit(1));
+  if (parse_error) {
+    return parse_error == DeserializationError::NoMemory ? "message too large" : "malformed JSON";
+  }
+  if (!doc.is<JsonObject>()) {
+    return "expected a JSON object";
+  }
+
+  // The ID comes first so even a rejected command can be answered
+  JsonVariantConst id = doc["id"];
+  if (id.is<const char*>()) {
+    strncpy(command->id, id.as<const char*>(), REMOTE_COMMAND_ID_LENGTH - 1);
+    command->id[REMOTE_COMMAND_ID_LENGTH - 1] = '\0';
+  } else if (id.is<long>()) {
+    snprintf(command->id, REMOTE_COMMAND_ID_LENGTH, "%ld", id.as<long>());
+  }
+
+  const char* name = doc["cmd"];
+  if (name == NULL) {
+    return "missing cmd";
+  }
+  command->op = lookupCommand(name);
+  if (command->op == CMD_INVALID) {
+    return "unknown cmd";
+  }
+
+  JsonVariantConst value = doc["value"];
+  if (!value.isNull()) {
+    if (!value.is<int32_t>()) {
+      return "value must be an integer";
+    }
+    command->has_value = true;
+    command->value = value.as<int32_t>();
+  }
+
+  bool needs_value = command->op == CMD_SET_INTERVAL || command->op == CMD_SET_DEADBAND ||
+                     command->op == CMD_SET_UNIT_WEIGHT;
+  if (needs_value && !command->has_value) {
+    return "missing value";
+  }
+  return NULL;
+}
+
+bool remoteCommandReceive(const uint8_t* payload, unsigned int length) {
+  stats.received++;
+  if (command_queue == NULL || length > REMOTE_COMMAND_MAX_PAYLOAD) {
+    stats.dropped++;
+    return false;
+  }
+
+  RemoteCommand command;
+  memset(&command, 0, sizeof(command));
+  command.error = parseCommand(payload, length, &command);
+  if (command.error != NULL) {
+    command.op = CMD_INVALID;
+    stats.invalid++;
+  }
+
+  // Never block the network task on a busy console
+  if (xQueueSend(command_queue, &command, 0) != pdTRUE) {
+    stats.dropped++;
+    return false;
+  }
+  return true;
+}
+
+bool remoteCommandNext(RemoteCommand* command) {
+  return command_queue != NULL && xQueueReceive(command_queue, command, 0) == pdTRUE;
+}
+
+const char* remoteCommandName(RemoteCommandOp op) {
+  return (int)op < command_name_count ? command_names[op] : "invalid";
+}
+
+RemoteCommandStats remoteCommandStats() {
+  return stats;
+}
@@ -0,0 +1,598 @@
+/*
+ * Store-and-forward transaction queue on LittleFS
+ * Segment files are append-only; only the cursor file is ever rewritten.
+ * Appends and sends run on different tasks; the mutex covers flash access,
+ * the queue position and the in-flight window, never the publish callback.
+ */
+
+#include "transaction_queue.h"
+#include "telemetry_frame.h"
+#include <LittleFS.h>
+
+#define TXQ_CURSOR_PATH TXQ_DIR "/cursor"
+#define TXQ_CURSOR_MAGIC_V1 0x31515854UL  // "TXQ1", before the queue generation
+#define TXQ_CURSOR_MAGIC 0x32515854UL     // "TXQ2"
+#define TXQ_CURSOR_SIZE_V1 20
+#define TXQ_CURSOR_SIZE 24
+#define TXQ_PATH_LENGTH 24
+#define TXQ_RECORD_PACKED 0x80         // Type flag: vehicle UID packed as bytes, epoch time present
+
+static_assert(VEHICLE_ID_LENGTH == 15, "Record layout reserves 15 bytes for the vehicle ID");
+
+static bool txq_ready = false;
+static SemaphoreHandle_t txq_mutex = NULL;  // Appends (NFC task) vs. drains (network task)
+static uint32_t read_segment = 0;      // Oldest segment still holding undrained records
+static uint32_t read_index = 0;        // Next record to publish in read_segment
+static uint32_t write_segment = 0;     // Segment new records are appended to
+static uint32_t write_index = 0;       // Records already in write_segment
+static uint32_t next_sequence = 1;
+static uint32_t generation = 0;        // Makes transaction IDs unique across flash formats
+static TxQueueStats stats;
+
+// Position just past a record
+struct DrainPosition {
+  uint32_t segment;
+  uint32_t index;
+};
+
+// A record sent (or about to be) and not yet acknowledged
+struct InFlight {
+  QueuedTransaction tx;
+  DrainPosition after;                 // Read position once this and all before it are acknowledged
+  unsigned long next_send;             // millis() of the next resend
+  uint32_t retry_delay;
+  bool sent;
+  bool acked;
+};
+
+static InFlight window[TXQ_INFLIGHT_WINDOW];  // Oldest first, contiguous from the read position
+static int window_count = 0;
+static DrainPosition fetch_position;   // Next record to bring into the window
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static void putU32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0xFF;
+  p[3] = value >> 24;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Record: sequence(4) completed_at(4) bottle_count(2) total_bottles(2)
+//         type(1) vehicle(15) crc32(4), little-endian
+// vehicle is either the ID as text (NUL padded), or - with TXQ_RECORD_PACKED
+// set in type - uid_length(1) uid(7) completed_epoch_ms(6) boot_tag(1).
+// Records written before epoch times existed are all text.
+static void encodeRecord(const QueuedTransaction* tx, uint8_t* record) {
+  memset(record, 0, TXQ_RECORD_SIZE);
+  putU32(&record[0], tx->sequence);
+  putU32(&record[4], tx->completed_at);
+  record[8] = (uint16_t)tx->bottle_count & 0xFF;
+  record[9] = (uint16_t)tx->bottle_count >> 8;
+  record[10] = (uint16_t)tx->total_bottles & 0xFF;
+  record[11] = (uint16_t)tx->total_bottles >> 8;
+
+  // Vehicle IDs are UIDs in hex; anything else is kept as text
+  uint8_t uid[TELEMETRY_UID_MAX_LENGTH];
+  char round_trip[TELEMETRY_UID_MAX_LENGTH * 2 + 1];
+  uint8_t uid_length = telemetryParseUID(tx->vehicle_id, uid);
+  telemetryFormatUID(uid, uid_length, round_trip);
+  if (strcmp(round_trip, tx->vehicle_id) == 0) {
+    record[12] = tx->type | TXQ_RECORD_PACKED;
+    record[13] = uid_length;
+    memcpy(&record[14], uid, uid_length);
+    for (int i = 0; i < 6; i++) {
+      record[21 + i] = (uint8_t)(tx->completed_epoch_ms >> (8 * i));
+    }
+    record[27] = tx->boot_tag;
+  } else {
+    record[12] = tx->type;
+    strncpy((char*)&record[13], tx->vehicle_id, VEHICLE_ID_LENGTH);
+  }
+  putU32(&record[28], crc32(record, 28));
+}
+
+static bool decodeRecord(const uint8_t* record, QueuedTransaction* tx) {
+  if (crc32(record, 28) != getU32(&record[28])) {
+    return false;
+  }
+  tx->sequence = getU32(&record[0]);
+  tx->completed_at = getU32(&record[4]);
+  tx->bottle_count = (int16_t)(record[8] | (record[9] << 8));
+  tx->total_bottles = (int16_t)(record[10] | (record[11] << 8));
+  tx->type = record[12] & ~TXQ_RECORD_PACKED;
+  if (record[12] & TXQ_RECORD_PACKED) {
+    telemetryFormatUID(&record[14], record[13], tx->vehicle_id);
+    tx->completed_epoch_ms = 0;
+    for (int i = 0; i < 6; i++) {
+      tx->completed_epoch_ms |= (uint64_t)record[21 + i] << (8 * i);
+    }
+    tx->boot_tag = record[27];
+  } else {
+    memcpy(tx->vehicle_id, &record[13], VEHICLE_ID_LENGTH);
+    tx->vehicle_id[VEHICLE_ID_LENGTH - 1] = '\0';
+    tx->completed_epoch_ms = 0;
+    tx->boot_tag = 0;
+  }
+  return true;
+}
+
+static void segmentPath(uint32_t segment, char* path) {
+  snprintf(path, TXQ_PATH_LENGTH, TXQ_DIR "/%08lx.seg", (unsigned long)segment);
+}
+
+// "0000002a.seg" (with or without a directory prefix) -> 0x2a
+static bool parseSegmentName(const char* name, uint32_t* segment) {
+  const char* base = strrchr(name, '/');
+  base = (base != NULL) ? base + 1 : name;
+  if (strlen(base) != 12 || strcmp(base + 8, ".seg") != 0) {
+    return false;
+  }
+  char* end = NULL;
+  unsigned long value = strtoul(base, &end, 16);
+  if (end != base + 8) {
+    return false;
+  }
+  *segment = (uint32_t)value;
+  return true;
+}
+
+static void saveCursor() {
+  uint8_t cursor[TXQ_CURSOR_SIZE];
+  putU32(&cursor[0], TXQ_CURSOR_MAGIC);
+  putU32(&cursor[4], read_segment);
+  putU32(&cursor[8], read_index);
+  putU32(&cursor[12], next_sequence);
+  putU32(&cursor[16], generation);
+  putU32(&cursor[20], crc32(cursor, 20));
+
+  File file = LittleFS.open(TXQ_CURSOR_PATH, FILE_WRITE);
+  if (file) {
+    file.write(cursor, sizeof(cursor));
+    file.close();
+  }
+}
+
+// A version 1 cursor has no generation; *queue_generation is left at 0
+static bool loadCursor(uint32_t* segment, uint32_t* index, uint32_t* sequence,
+                       uint32_t* queue_generation) {
+  File file = LittleFS.open(TXQ_CURSOR_PATH, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  uint8_t cursor[TXQ_CURSOR_SIZE];
+  size_t length = file.read(cursor, sizeof(cursor));
+  file.close();
+
+  if (length == TXQ_CURSOR_SIZE && getU32(&cursor[0]) == TXQ_CURSOR_MAGIC &&
+      crc32(cursor, 20) == getU32(&cursor[20])) {
+    *queue_generation = getU32(&cursor[16]);
+  } else if (length == TXQ_CURSOR_SIZE_V1 && getU32(&cursor[0]) == TXQ_CURSOR_MAGIC_V1 &&
+             crc32(cursor, 16) == getU32(&cursor[16])) {
+    *queue_generation = 0;
+  } else {
+    return false;
+  }
+  *segment = getU32(&cursor[4]);
+  *index = getU32(&cursor[8]);
+  *sequence = getU32(&cursor[12]);
+  return true;
+}
+
+// Sequence number of the last whole, valid record in a segment file
+static bool lastSequenceIn(uint32_t segment, uint32_t* sequence) {
+  char path[TXQ_PATH_LENGTH];
+  segmentPath(segment, path);
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) {
+    return false;
+  }
+
+  bool found = false;
+  uint8_t record[TXQ_RECORD_SIZE];
+  QueuedTransaction tx;
+  for (long i = (long)(file.size() / TXQ_RECORD_SIZE) - 1; i >= 0 && !found; i--) {
+    if (file.seek(i * TXQ_RECORD_SIZE) && file.read(record, TXQ_RECORD_SIZE) == TXQ_RECORD_SIZE &&
+        decodeRecord(record, &tx)) {
+      *sequence = tx.sequence;
+      found = true;
+    }
+  }
+  file.close();
+  return found;
+}
+
+// Counts every segment behind the write one as full; short and torn ones
+// stop counting once the drain passes them
+static uint32_t computePending() {
+  if (read_segment == write_segment) {
+    return write_index > read_index ? write_index - read_index : 0;
+  }
+  uint32_t first = read_index < TXQ_RECORDS_PER_SEGMENT ? TXQ_RECORDS_PER_SEGMENT - read_index : 0;
+  return first + (write_segment - read_segment - 1) * TXQ_RECORDS_PER_SEGMENT + write_index;
+}
+
+// Queue full: give up the oldest segment so new transactions are kept
+static void dropOldestSegment() {
+  char path[TXQ_PATH_LENGTH];
+  segmentPath(read_segment, path);
+  LittleFS.remove(path);
+
+  uint32_t lost = read_index < TXQ_RECORDS_PER_SEGMENT ? TXQ_RECORDS_PER_SEGMENT - read_index : 0;
+  stats.dropped += lost;
+  Serial.printf("⚠️ Transaction queue full - dropped %lu oldest records\n", (unsigned long)lost);
+
+  read_segment++;
+  read_index = 0;
+
+  // In-flight records from that segment are gone with it
+  int kept = 0;
+  for (int i = 0; i < window_count; i++) {
+    if (window[i].after.segment >= read_segment) {
+      window[kept++] = window[i];
+    }
+  }
+  window_count = kept;
+  if (fetch_position.segment < read_segment) {
+    fetch_position.segment = read_segment;
+    fetch_position.index = 0;
+  }
+  saveCursor();
+}
+
+bool txQueueBegin() {
+  memset(&stats, 0, sizeof(stats));
+  if (txq_mutex == NULL) {
+    txq_mutex = xSemaphoreCreateMutex();
+  }
+
+  if (!LittleFS.begin(true)) {
+    Serial.println("❌ LittleFS mount failed - offline transactions will not be kept");
+    return false;
+  }
+  if (!LittleFS.exists(TXQ_DIR)) {
+    LittleFS.mkdir(TXQ_DIR);
+  }
+
+  // Oldest and newest segment files on flash
+  bool found = false;
+  uint32_t lowest = 0, highest = 0;
+  File dir = LittleFS.open(TXQ_DIR);
+  if (dir && dir.isDirectory()) {
+    File entry = dir.openNextFile();
+    while (entry) {
+      uint32_t segment;
+      if (!entry.isDirectory() && parseSegmentName(entry.name(), &segment)) {
+        if (!found || segment < lowest) lowest = segment;
+        if (!found || segment > highest) highest = segment;
+        found = true;
+      }
+      entry.close();
+      entry = dir.openNextFile();
+    }
+    dir.close();
+  }
+
+  uint32_t cursor_segment = 0, cursor_index = 0, cursor_sequence = 1;
+  generation = 0;
+  bool have_cursor = loadCursor(&cursor_segment, &cursor_index, &cursor_sequence, &generation);
+  next_sequence = have_cursor ? cursor_sequence : 1;
+
+  if (!found) {
+    // Empty queue - keep numbering segments upward from where it left off
+    read_segment = write_segment = have_cursor ? cursor_segment + 1 : 0;
+    read_index = write_index = 0;
+  } else {
+    // Segments deleted before the cursor was saved are skipped
+    bool cursor_valid = have_cursor && cursor_segment >= lowest && cursor_segment <= highest;
+    read_segment = cursor_valid ? cursor_segment : lowest;
+    read_index = cursor_valid ? cursor_index : 0;
+
+    // The newest valid record carries the latest sequence number
+    for (uint32_t segment = highest; ; segment--) {
+      uint32_t last_sequence;
+      if (lastSequenceIn(segment, &last_sequence)) {
+        if ((long)(last_sequence + 1 - next_sequence) > 0) {
+          next_sequence = last_sequence + 1;
+        }
+        break;
+      }
+      if (segment == lowest) break;
+    }
+
+    char path[TXQ_PATH_LENGTH];
+    segmentPath(highest, path);
+    File file = LittleFS.open(path, FILE_READ);
+    size_t size = file ? file.size() : 0;
+    uint32_t whole_records = size / TXQ_RECORD_SIZE;
+    if (file) file.close();
+
+    write_segment = highest;
+    write_index = whole_records;
+    if (size % TXQ_RECORD_SIZE != 0) {
+      // Torn append from a power cut - leave it to be drained, write elsewhere
+      write_segment = highest + 1;
+      write_index = 0;
+    }
+  }
+
+  // A new queue (or one from before generations) gets a fresh generation
+  bool new_generation = !have_cursor || generation == 0;
+  while (generation == 0) {
+    generation = esp_random();
+  }
+  if (new_generation) {
+    saveCursor();
+  }
+
+  window_count = 0;
+  fetch_position.segment = read_segment;
+  fetch_position.index = read_index;
+
+  txq_ready = true;
+  stats.pending = computePending();
+  Serial.printf("✅ Transaction queue ready - %lu pending, next sequence %lu, generation %08lx\n",
+                (unsigned long)stats.pending, (unsigned long)next_sequence,
+                (unsigned long)generation);
+  return true;
+}
+
+static bool appendRecord(QueuedTransaction* tx) {
+  if (write_index >= TXQ_RECORDS_PER_SEGMENT) {
+    write_segment++;
+    write_index = 0;
+  }
+  if (write_segment - read_segment >= TXQ_MAX_SEGMENTS) {
+    dropOldestSegment();
+  }
+
+  tx->sequence = next_sequence;
+  uint8_t record[TXQ_RECORD_SIZE];
+  encodeRecord(tx, record);
+
+  char path[TXQ_PATH_LENGTH];
+  segmentPath(write_segment, path);
+  File file = LittleFS.open(path, FILE_APPEND);
+  if (!file) {
+    return false;
+  }
+  size_t written = file.write(record, TXQ_RECORD_SIZE);
+  file.close();
+
+  if (written != TXQ_RECORD_SIZE) {
+    // Keep later records aligned by starting a fresh segment
+    write_segment++;
+    write_index = 0;
+    return false;
+  }
+
+  next_sequence++;
+  write_index++;
+  stats.appended++;
+  return true;
+}
+
+bool txQueueAppend(QueuedTransaction* tx) {
+  if (!txq_ready) {
+    return false;
+  }
+
+  xSemaphoreTake(txq_mutex, portMAX_DELAY);
+  bool stored = appendRecord(tx);
+  stats.pending = computePending();
+  xSemaphoreGive(txq_mutex);
+  return stored;
+}
+
+// Reads valid records from fetch_position onward into the window until it
+// is full or has caught up with the write position; corrupt records are
+// skipped (and counted) on the way
+static void fillWindow() {
+  DrainPosition* position = &fetch_position;
+  File file;
+  char path[TXQ_PATH_LENGTH];
+
+  while (window_count < TXQ_INFLIGHT_WINDOW) {
+    if (position->segment == write_segment && position->index >= write_index) {
+      break;  // Caught up
+    }
+
+    if (!file) {
+      segmentPath(position->segment, path);
+      file = LittleFS.open(path, FILE_READ);
+      if (file && !file.seek(position->index * TXQ_RECORD_SIZE)) {
+        file.close();
+      }
+    }
+
+    uint8_t record[TXQ_RECORD_SIZE];
+    bool have_record = file && position->index < TXQ_RECORDS_PER_SEGMENT &&
+                       file.read(record, TXQ_RECORD_SIZE) == TXQ_RECORD_SIZE;
+    if (!have_record) {
+      // End of a finished segment (or a missing one): move on to the next
+      if (file) file.close();
+      if (position->segment == write_segment) {
+        break;
+      }
+      position->segment++;
+      position->index = 0;
+      continue;
+    }
+
+    position->index++;
+    InFlight* entry = &window[window_count];
+    if (!decodeRecord(record, &entry->tx)) {
+      stats.corrupt++;
+      continue;
+    }
+    entry->after = *position;
+    entry->next_send = 0;
+    entry->retry_delay = TXQ_ACK_TIMEOUT;
+    entry->sent = false;
+    entry->acked = false;
+    window_count++;
+  }
+
+  if (file) file.close();
+}
+
+static InFlight* findInFlight(uint32_t sequence) {
+  for (int i = 0; i < window_count; i++) {
+    if (window[i].tx.sequence == sequence) {
+      return &window[i];
+    }
+  }
+  return NULL;
+}
+
+// Moves the read position up to position, deleting the segments left behind
+static void advanceReadPosition(DrainPosition position) {
+  if (position.segment == read_segment && position.index == read_index) {
+    return;
+  }
+  char path[TXQ_PATH_LENGTH];
+  while (read_segment < position.segment) {
+    segmentPath(read_segment, path);
+    LittleFS.remove(path);
+    read_segment++;
+  }
+  read_index = position.index;
+
+  // One cursor write per move of the read position
+  saveCursor();
+}
+
+// Moves the read position past the acknowledged prefix of the window
+static void commitAcknowledged() {
+  int done = 0;
+  while (done < window_count && window[done].acked) {
+    done++;
+  }
+  if (done == 0) {
+    return;
+  }
+  DrainPosition position = window[done - 1].after;
+  for (int i = done; i < window_count; i++) {
+    window[i - done] = window[i];
+  }
+  window_count -= done;
+  advanceReadPosition(position);
+}
+
+int txQueueService(bool (*publish)(const QueuedTransaction* tx), unsigned long now_ms) {
+  if (!txq_ready) {
+    return 0;
+  }
+
+  xSemaphoreTake(txq_mutex, portMAX_DELAY);
+  fillWindow();
+  if (window_count == 0) {
+    // Nothing valid was left to fetch: move past the torn, short and corrupt
+    // records on the way so they no longer count as pending
+    advanceReadPosition(fetch_position);
+    stats.pending = computePending();
+  }
+  stats.in_flight = window_count;
+  xSemaphoreGive(txq_mutex);
+
+  int published = 0;
+  for (int i = 0; i < TXQ_INFLIGHT_WINDOW; i++) {
+    QueuedTransaction tx;
+    xSemaphoreTake(txq_mutex, portMAX_DELAY);
+    bool due = i < window_count && !window[i].acked &&
+               (!window[i].sent || (long)(now_ms - window[i].next_send) >= 0);
+    if (due) {
+      tx = window[i].tx;
+    }
+    bool more = i < window_count;
+    xSemaphoreGive(txq_mutex);
+    if (!more) {
+      break;
+    }
+    if (!due) {
+      continue;
+    }
+
+    // Publishing may wait on the network; appends are not held up meanwhile
+    if (!publish(&tx)) {
+      break;
+    }
+    published++;
+
+    xSemaphoreTake(txq_mutex, portMAX_DELAY);
+    InFlight* entry = findInFlight(tx.sequence);  // Gone if an append dropped its segment
+    if (entry != NULL) {
+      if (entry->sent) {
+        stats.resent++;
+        entry->retry_delay *= 2;
+        if (entry->retry_delay > TXQ_ACK_TIMEOUT_MAX) {
+          entry->retry_delay = TXQ_ACK_TIMEOUT_MAX;
+        }
+      }
+      entry->sent = true;
+      entry->next_send = now_ms + entry->retry_delay;
+    }
+    xSemaphoreGive(txq_mutex);
+  }
+  return published;
+}
+
+bool txQueueAck(const char* tx_id) {
+  if (!txq_ready || tx_id == NULL || strlen(tx_id) != TXQ_ID_LENGTH - 1) {
+    return false;
+  }
+  char part[9];
+  memcpy(part, tx_id, 8);
+  part[8] = '\0';
+  char* end = NULL;
+  uint32_t id_generation = (uint32_t)strtoul(part, &end, 16);
+  if (end != part + 8) {
+    return false;
+  }
+  uint32_t sequence = (uint32_t)strtoul(tx_id + 8, &end, 16);
+  if (end != tx_id + 16) {
+    return false;
+  }
+
+  xSemaphoreTake(txq_mutex, portMAX_DELAY);
+  InFlight* entry = id_generation == generation ? findInFlight(sequence) : NULL;
+  bool accepted = entry != NULL && !entry->acked;
+  if (accepted) {
+    entry->acked = true;
+    stats.acknowledged++;
+    commitAcknowledged();
+    stats.in_flight = window_count;
+    stats.pending = computePending();
+  }
+  xSemaphoreGive(txq_mutex);
+  return accepted;
+}
+
+void txQueueTransactionId(uint32_t sequence, char* tx_id) {
+  snprintf(tx_id, TXQ_ID_LENGTH, "%08lx%08lx", (unsigned long)generation, (unsigned long)sequence);
+}
+
+uint32_t txQueuePending() {
+  return stats.pending;
+}
+
+const TxQueueStats* txQueueStats() {
+  return &stats;
+}
+
+const char* txQueueTypeName(uint8_t type) {
+  return type == TXQ_UNLOAD ? "UNLOAD" : "LOAD";
+}
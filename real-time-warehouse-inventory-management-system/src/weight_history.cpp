@@ -0,0 +1,59 @@
+/*
+ * Weight sample history - fixed ring buffer, oldest samples overwritten
+ */
+
+#include "weight_history.h"
+
+static WeightSample history[WEIGHT_HISTORY_SIZE];
+static int history_head = 0;     // Next slot to write
+static int history_count = 0;
+
+// i = 0 is the oldest sample still held
+static const WeightSample* sampleAt(int i) {
+  int start = (history_head - history_count + WEIGHT_HISTORY_SIZE) % WEIGHT_HISTORY_SIZE;
+  return &history[(start + i) % WEIGHT_HISTORY_SIZE];
+}
+
+void weightHistoryAdd(unsigned long timestamp, int weight_g, int bottles) {
+  history[history_head].timestamp = timestamp;
+  history[history_head].weight_g = weight_g;
+  history[history_head].bottles = bottles;
+  history_head = (history_head + 1) % WEIGHT_HISTORY_SIZE;
+  if (history_count < WEIGHT_HISTORY_SIZE) {
+    history_count++;
+  }
+}
+
+bool weightHistoryStableAt(unsigned long t, WeightSample* sample) {
+  // Latest sample taken at or before t
+  int k = history_count - 1;
+  while (k >= 0 && (long)(sampleAt(k)->timestamp - t) > 0) {
+    k--;
+  }
+  if (k < 0) {
+    return false;
+  }
+
+  // Carry it forward while later samples show no motion - the newest of
+  // those is the freshest reading of the weight that was there at t
+  const WeightSample* reference = sampleAt(k);
+  int stable = k;
+  for (int j = k + 1; j < history_count; j++) {
+    if (abs(sampleAt(j)->weight_g - reference->weight_g) > WEIGHT_MOTION_THRESHOLD) {
+      break;
+    }
+    stable = j;
+  }
+
+  *sample = *sampleAt(stable);
+  return true;
+}
+
+bool weightHistoryHasSampleAfter(unsigned long t) {
+  return history_count > 0 && (long)(sampleAt(history_count - 1)->timestamp - t) > 0;
+}
+
+void weightHistoryClear() {
+  history_head = 0;
+  history_count = 0;
+}
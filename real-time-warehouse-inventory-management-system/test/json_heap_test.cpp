@@ -0,0 +1,152 @@
+/*
+ * JSON Payload Heap Test - Free heap must stay flat while publishing
+ * Builds the NFC transaction and bottle-scale/data payloads the same way
+ * the main firmware does, a million times, and checks the free heap, the
+ * minimum free heap watermark and the largest free block before and after.
+ * For comparison, a short run of the old String concatenation shows the
+ * heap churn it used to cause.
+ * Needs no sensors or network - flash it on a bare ESP32 and open the monitor.
+ */
+
+#include <Arduino.h>
+#include "json_template.h"
+#include "pallet_payloads.h"
+#include "telemetry_frame.h"
+
+#define TEST_PUBLISHES 1000000UL
+#define REPORT_EVERY 100000UL
+#define STRING_BASELINE_PUBLISHES 10000UL
+
+// Same schemas as the firmware
+static char nfc_transaction_json[JSON_TEMPLATE_SIZE(nfc_transaction_schema)];
+JsonTemplate nfc_transaction_payload(nfc_transaction_schema, nfc_transaction_json,
+                                     sizeof(nfc_transaction_json));
+
+static char data_json[JSON_TEMPLATE_SIZE(data_schema)];
+JsonTemplate data_payload(data_schema, data_json, sizeof(data_json));
+
+static const char* statuses[] = { "idle", "loading", "unloading" };  // String baseline only
+static const char* vehicles[] = { "04A1B2C3D4E5F6", "DEADBEEF", "" };
+static char current_vehicle_id[15];  // As main.cpp keeps the latest tap
+
+// Stand-in for mqttClient.publish(): touch every byte so nothing is optimized out
+static volatile uint32_t checksum = 0;
+static void consume(const char* payload) {
+  uint32_t sum = 0;
+  for (const char* p = payload; *p != '\0'; p++) sum += (uint8_t)*p;
+  checksum += sum;
+}
+
+static void publishOnce(unsigned long i) {
+  int weight_g = (int)(i % 20000) - 500;
+  int bottles = weight_g / 275;
+  uint8_t status = (uint8_t)(i % 3);
+  snprintf(current_vehicle_id, sizeof(current_vehicle_id), "%s", vehicles[i % 3]);
+
+  data_payload.setInt(DATA_JSON_WEIGHT_G, weight_g);
+  data_payload.setFloat(DATA_JSON_WEIGHT_OZ, weight_g / 28.34952f, 2);
+  data_payload.setInt(DATA_JSON_BOTTLES, bottles);
+  data_payload.setString(DATA_JSON_STATUS, telemetryStatusName(status));
+  data_payload.setString(DATA_JSON_NFC_STATE, "load_ready");
+  data_payload.setString(DATA_JSON_VEHICLE_ID, current_vehicle_id);
+  data_payload.setInt(DATA_JSON_OPEN_TRANSACTIONS, (int)(i % 8));
+  data_payload.setUnsigned(DATA_JSON_TIMESTAMP, millis());
+  data_payload.setUnsigned(DATA_JSON_EPOCH_MS, 1760000000000ULL + millis());
+  data_payload.setUnsigned(DATA_JSON_BOOT, 1);
+  data_payload.setUnsigned(DATA_JSON_SEQUENCE, i);
+  consume(data_payload.c_str());
+
+  char tx_id[PAYLOAD_TX_ID_LENGTH + 1];
+  snprintf(tx_id, sizeof(tx_id), "%08lx%08lx", 0x5eed1234UL, i);
+  nfc_transaction_payload.setString(TX_JSON_DEVICE_ID, "BottleScale_0123456789AB");
+  nfc_transaction_payload.setString(TX_JSON_TX_ID, tx_id);
+  nfc_transaction_payload.setUnsigned(TX_JSON_SEQUENCE, i);
+  nfc_transaction_payload.setString(TX_JSON_VEHICLE_ID, vehicles[i % 3]);
+  nfc_transaction_payload.setString(TX_JSON_TYPE, (i & 1) ? "UNLOAD" : "LOAD");
+  nfc_transaction_payload.setInt(TX_JSON_BOTTLE_COUNT, (int)(i % 40) - 20);
+  nfc_transaction_payload.setInt(TX_JSON_TOTAL_BOTTLES, bottles);
+  nfc_transaction_payload.setUnsigned(TX_JSON_TIMESTAMP, millis());
+  nfc_transaction_payload.setUnsigned(TX_JSON_EPOCH_MS, 1760000000000ULL + millis());
+  consume(nfc_transaction_payload.c_str());
+
+  char oz_text[12];
+  jsonFormatDecimal(oz_text, sizeof(oz_text), weight_g / 28.34952f, 2);
+  consume(oz_text);
+
+  TelemetrySnapshot snapshot = {};
+  snapshot.timestamp_ms = millis();
+  snapshot.weight_g = weight_g;
+  snapshot.bottles = bottles;
+  snapshot.status = status;
+  snapshot.vehicle_uid_length = telemetryParseUID(current_vehicle_id, snapshot.vehicle_uid);
+  uint8_t frame[TELEMETRY_SNAPSHOT_SIZE];
+  checksum += telemetryEncodeSnapshot(&snapshot, frame, sizeof(frame));
+}
+
+static void publishWithString(unsigned long i) {
+  int weight_g = (int)(i % 20000) - 500;
+  String json_payload = "{\"weight_g\":" + String(weight_g) +
+                        ",\"weight_oz\":" + String(weight_g / 28.34952f, 2) +
+                        ",\"bottles\":" + String(weight_g / 275) +
+                        ",\"status\":\"" + String(statuses[i % 3]) + "\"" +
+                        ",\"vehicle_id\":\"" + String(vehicles[i % 3]) + "\"" +
+                        ",\"timestamp\":" + String(millis()) + "}";
+  consume(json_payload.c_str());
+}
+
+static void printHeap(const char* label) {
+  Serial.printf("%-22s free %7u  min %7u  largest block %7u\n", label,
+                ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000);
+  Serial.println("JSON Payload Heap Test Starting...");
+  Serial.printf("data payload: %u bytes, transaction payload: %u bytes\n",
+                (unsigned int)data_payload.length(), (unsigned int)nfc_transaction_payload.length());
+  Serial.println(data_payload.c_str());
+
+  // Warm up once so lazily created system buffers are not counted
+  publishOnce(0);
+  printHeap("Before:");
+  uint32_t free_before = ESP.getFreeHeap();
+  uint32_t min_before = ESP.getMinFreeHeap();
+  uint32_t block_before = ESP.getMaxAllocHeap();
+  unsigned long started = millis();
+
+  for (unsigned long i = 1; i <= TEST_PUBLISHES; i++) {
+    publishOnce(i);
+    if (i % REPORT_EVERY == 0) {
+      char label[24];
+      snprintf(label, sizeof(label), "%lu publishes:", i);
+      printHeap(label);
+      delay(1);  // Let the idle task feed the watchdog
+    }
+  }
+
+  uint32_t free_after = ESP.getFreeHeap();
+  uint32_t min_after = ESP.getMinFreeHeap();
+  uint32_t block_after = ESP.getMaxAllocHeap();
+  Serial.printf("%lu publishes in %lu ms, checksum %lu, overflows %lu\n", TEST_PUBLISHES,
+                millis() - started, (unsigned long)checksum,
+                data_payload.overflows() + nfc_transaction_payload.overflows());
+
+  if (free_after == free_before && min_after == min_before && block_after == block_before) {
+    Serial.println("PASS: free heap, watermark and largest block unchanged");
+  } else {
+    Serial.printf("FAIL: free heap %d bytes, watermark %d bytes, largest block %d bytes\n",
+                  (int)(free_after - free_before), (int)(min_after - min_before),
+                  (int)(block_after - block_before));
+  }
+
+  // Old String payload for comparison
+  for (unsigned long i = 1; i <= STRING_BASELINE_PUBLISHES; i++) {
+    publishWithString(i);
+  }
+  printHeap("String baseline:");
+}
+
+void loop() {
+  delay(1000);
+}
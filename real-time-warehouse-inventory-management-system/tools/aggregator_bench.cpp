@@ -0,0 +1,198 @@
+/*
+ * aggregator_bench - fleet_table throughput and update latency without a
+ * broker
+ *
+ *   aggregator_bench [pallets] [zones] [threads] [seconds]
+ *
+ * Defaults: 10000 pallets in 16 zones, one thread per core, 2 seconds.
+ * Each thread owns a slice of the pallets and sends them frames as fast as
+ * it can: bottle counts and weights random-walk and the status changes now
+ * and then, like pallets being loaded. A frame is encoded first, then the
+ * timed part decodes it and applies it, as pallet_aggregator does per MQTT
+ * message. A publisher thread collects dirty totals meanwhile, and the
+ * time from a change being applied to its collection is reported too.
+ *
+ * At the end every zone's totals and the site totals are checked against
+ * the frames last sent. The exit status is 1 on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "fleet_table.h"
+#include "telemetry_frame.h"
+
+struct PalletSim {
+  char id[FLEET_DEVICE_ID_MAX + 1];
+  int zone;
+  TelemetrySnapshot snapshot;
+};
+
+struct WorkerResult {
+  uint64_t frames;
+  uint64_t applied;
+};
+
+static std::atomic<bool> running(true);
+
+// xorshift32: cheap, and each thread has its own
+static uint32_t nextRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static void runWorker(FleetTable* table, FleetLatency* latency, std::vector<PalletSim>* pallets,
+                      size_t first, size_t step, WorkerResult* result) {
+  uint32_t random = 2463534242U + (uint32_t)first;
+  uint8_t frame[TELEMETRY_SNAPSHOT_SIZE];
+  size_t index = first;
+  result->frames = 0;
+  result->applied = 0;
+  while (running.load(std::memory_order_relaxed)) {
+    PalletSim& pallet = (*pallets)[index];
+    TelemetrySnapshot& next = pallet.snapshot;
+    uint32_t r = nextRandom(&random);
+    int bottles = next.bottles + (int)(r % 3) - 1;
+    next.bottles = (int16_t)(bottles < 0 ? 0 : bottles);
+    next.weight_g = next.bottles * 275 + (int32_t)(r >> 8) % 40 - 20;
+    if ((r & 0xFF) == 0) {
+      next.status = (uint8_t)((r >> 8) % 3);
+    }
+    next.sequence++;
+    next.timestamp_ms += 1000;
+    size_t length = telemetryEncodeSnapshot(&next, frame, sizeof(frame));
+
+    uint64_t start = fleetNowNs();
+    TelemetrySnapshot decoded;
+    if (telemetryDecodeSnapshot(frame, length, &decoded) == TELEMETRY_OK &&
+        fleetTableApply(table, pallet.id, strlen(pallet.id), &decoded, start) == FLEET_APPLIED) {
+      result->applied++;
+    }
+    fleetLatencyRecord(latency, fleetNowNs() - start);
+    result->frames++;
+
+    index += step;
+    if (index >= pallets->size()) index = first;
+  }
+}
+
+static void runPublisher(FleetTable* table, FleetLatency* latency, uint64_t* collections,
+                         uint64_t* updates) {
+  std::vector<FleetTotalsUpdate> collected(fleetTableZoneCount(table) + 1);
+  while (running.load(std::memory_order_relaxed)) {
+    if (!fleetTableWaitDirty(table, 100)) continue;
+    size_t count = fleetTableCollect(table, collected.data(), collected.size());
+    uint64_t now = fleetNowNs();
+    for (size_t i = 0; i < count; i++) {
+      fleetLatencyRecord(latency, now - collected[i].dirty_ns);
+    }
+    (*collections)++;
+    *updates += count;
+  }
+}
+
+static void printLatency(const char* name, const FleetLatency* latency) {
+  printf("%-22s p50 <%7.2f us  p99 <%7.2f us  p99.9 <%7.2f us  max %8.2f us\n", name,
+         fleetLatencyPercentile(latency, 0.5) / 1000.0, fleetLatencyPercentile(latency, 0.99) / 1000.0,
+         fleetLatencyPercentile(latency, 0.999) / 1000.0, fleetLatencyMax(latency) / 1000.0);
+}
+
+static bool sameTotals(const FleetTotals& a, const FleetTotals& b) {
+  return a.pallets == b.pallets && a.loading == b.loading && a.unloading == b.unloading &&
+         a.bottles == b.bottles && a.weight_g == b.weight_g;
+}
+
+int main(int argc, char** argv) {
+  size_t pallet_count = argc > 1 ? (size_t)atol(argv[1]) : 10000;
+  size_t zone_count = argc > 2 ? (size_t)atol(argv[2]) : 16;
+  size_t threads = argc > 3 ? (size_t)atol(argv[3]) : std::thread::hardware_concurrency();
+  double seconds = argc > 4 ? atof(argv[4]) : 2.0;
+  if (threads == 0) threads = 1;
+  if (pallet_count < threads || zone_count == 0) {
+    fprintf(stderr, "usage: %s [pallets] [zones] [threads] [seconds]\n", argv[0]);
+    return 2;
+  }
+
+  FleetTable* table = fleetTableCreate(256);
+  std::vector<PalletSim> pallets(pallet_count);
+  for (size_t i = 0; i < pallet_count; i++) {
+    char zone[32];
+    snprintf(pallets[i].id, sizeof(pallets[i].id), "BottleScale_%012lX", (unsigned long)i);
+    snprintf(zone, sizeof(zone), "zone-%02lu", (unsigned long)(i % zone_count));
+    pallets[i].zone = fleetTableAssign(table, pallets[i].id, zone);
+    memset(&pallets[i].snapshot, 0, sizeof(pallets[i].snapshot));
+    pallets[i].snapshot.boot_count = 1;
+  }
+
+  FleetLatency* apply_latency = fleetLatencyCreate();
+  FleetLatency* collect_latency = fleetLatencyCreate();
+  std::vector<WorkerResult> results(threads);
+  std::vector<std::thread> workers;
+  uint64_t collections = 0;
+  uint64_t updates = 0;
+  std::thread publisher(runPublisher, table, collect_latency, &collections, &updates);
+  for (size_t t = 0; t < threads; t++) {
+    workers.push_back(std::thread(runWorker, table, apply_latency, &pallets, t, threads, &results[t]));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds((long)(seconds * 1000)));
+  running = false;
+  for (size_t t = 0; t < threads; t++) {
+    workers[t].join();
+  }
+  fleetTableWake(table);
+  publisher.join();
+
+  uint64_t frames = 0;
+  uint64_t applied = 0;
+  for (size_t t = 0; t < threads; t++) {
+    frames += results[t].frames;
+    applied += results[t].applied;
+  }
+  printf("%lu pallets, %lu zones, %lu threads, %.1f s\n", (unsigned long)pallet_count,
+         (unsigned long)fleetTableZoneCount(table) - 1, (unsigned long)threads, seconds);
+  printf("frames                 %lu (%.0f/s), %lu changed totals\n", (unsigned long)frames,
+         frames / seconds, (unsigned long)applied);
+  printf("collections            %lu, %.1f zone updates each\n", (unsigned long)collections,
+         collections > 0 ? (double)updates / collections : 0.0);
+  printLatency("decode + apply", apply_latency);
+  printLatency("apply to collection", collect_latency);
+
+  // Every zone and the site must equal the sum of the last frames sent
+  std::vector<FleetTotals> expected(fleetTableZoneCount(table));
+  FleetTotals site;
+  memset(&site, 0, sizeof(site));
+  memset(expected.data(), 0, expected.size() * sizeof(FleetTotals));
+  for (size_t i = 0; i < pallet_count; i++) {
+    const TelemetrySnapshot& last = pallets[i].snapshot;
+    if (last.sequence == 0) continue;      // Never sent
+    FleetTotals* totals[2] = { &expected[pallets[i].zone], &site };
+    for (int k = 0; k < 2; k++) {
+      totals[k]->pallets++;
+      totals[k]->loading += last.status == TELEMETRY_STATUS_LOADING;
+      totals[k]->unloading += last.status == TELEMETRY_STATUS_UNLOADING;
+      totals[k]->bottles += last.bottles;
+      totals[k]->weight_g += last.weight_g;
+    }
+  }
+  bool ok = sameTotals(fleetTableTotals(table, FLEET_SITE), site);
+  for (size_t z = 0; z < expected.size(); z++) {
+    ok = sameTotals(fleetTableTotals(table, (int)z), expected[z]) && ok;
+  }
+  printf("totals                 %s (%lld bottles, %lld g on %d pallets)\n", ok ? "match" : "MISMATCH",
+         (long long)site.bottles, (long long)site.weight_g, site.pallets);
+
+  fleetLatencyDestroy(apply_latency);
+  fleetLatencyDestroy(collect_latency);
+  fleetTableDestroy(table);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,365 @@
+/*
+ * Fleet table - sharded pallet states plus atomic zone and site totals
+ * Each shard is an open-addressing table (FNV-1a, linear probing) behind
+ * one mutex, padded so neighbouring shard locks do not share a cache line.
+ * All atomics use the default sequentially consistent order: a publisher
+ * that clears a dirty mark then reads totals that include every delta
+ * added before the mark was seen set.
+ */
+
+#include "fleet_table.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define SHARD_INITIAL_SLOTS 64
+
+struct PalletEntry {
+  uint64_t hash;
+  char id[FLEET_DEVICE_ID_MAX + 1];
+  uint8_t id_length;                       // 0 for an empty slot
+  uint8_t status;
+  int16_t zone;
+  int16_t bottles;
+  int32_t weight_g;
+  uint32_t boot;
+  uint32_t sequence;
+};
+
+struct Shard {
+  std::mutex mutex;
+  std::vector<PalletEntry> slots;          // Power-of-two size
+  size_t used;
+  char padding[64];                        // Keep the next shard's mutex off this line
+};
+
+struct Zone {
+  std::string name;
+  std::atomic<int32_t> pallets;
+  std::atomic<int32_t> loading;
+  std::atomic<int32_t> unloading;
+  std::atomic<int64_t> bottles;
+  std::atomic<int64_t> weight_g;
+  std::atomic<uint32_t> version;
+  std::atomic<uint64_t> dirty_ns;          // 0 while clean
+
+  explicit Zone(const std::string& zone_name)
+      : name(zone_name), pallets(0), loading(0), unloading(0), bottles(0), weight_g(0),
+        version(0), dirty_ns(0) {}
+};
+
+struct FleetTable {
+  std::unique_ptr<Shard[]> shards;
+  size_t shard_mask;
+  std::vector<std::unique_ptr<Zone> > zones; // Index 0 is FLEET_UNASSIGNED_ZONE
+  Zone site;
+  std::unordered_map<std::string, int> zone_of_device;
+  std::atomic<size_t> pallet_count;
+
+  // Publisher wake-up: dirty_count counts dirty zones, site included
+  std::atomic<int> dirty_count;
+  std::mutex wait_mutex;
+  std::condition_variable wait_signal;
+  bool woken;
+
+  FleetTable() : site("site"), pallet_count(0), dirty_count(0), woken(false) {}
+};
+
+struct FleetLatency {
+  std::atomic<uint64_t> buckets[FLEET_LATENCY_BUCKETS];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> max_ns;
+};
+
+static uint64_t hashId(const char* id, size_t length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)id[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static int findZone(const FleetTable* table, const char* name) {
+  for (size_t i = 0; i < table->zones.size(); i++) {
+    if (table->zones[i]->name == name) return (int)i;
+  }
+  return -1;
+}
+
+FleetTable* fleetTableCreate(size_t shard_count) {
+  size_t shards = 1;
+  while (shards < shard_count) shards <<= 1;
+
+  FleetTable* table = new FleetTable();
+  table->shards.reset(new Shard[shards]);
+  table->shard_mask = shards - 1;
+  for (size_t i = 0; i < shards; i++) {
+    table->shards[i].slots.assign(SHARD_INITIAL_SLOTS, PalletEntry());
+    table->shards[i].used = 0;
+  }
+  table->zones.push_back(std::unique_ptr<Zone>(new Zone(FLEET_UNASSIGNED_ZONE)));
+  return table;
+}
+
+void fleetTableDestroy(FleetTable* table) {
+  delete table;
+}
+
+int fleetTableAssign(FleetTable* table, const char* device_id, const char* zone) {
+  if (strlen(device_id) == 0 || strlen(device_id) > FLEET_DEVICE_ID_MAX) {
+    return -1;
+  }
+  int index = findZone(table, zone);
+  if (index < 0) {
+    index = (int)table->zones.size();
+    table->zones.push_back(std::unique_ptr<Zone>(new Zone(zone)));
+  }
+  table->zone_of_device[device_id] = index;
+  return index;
+}
+
+// Shard lock held: slot of id, or of the empty slot where it belongs
+static size_t probe(const Shard* shard, uint64_t hash, const char* id, size_t length) {
+  size_t mask = shard->slots.size() - 1;
+  size_t slot = (size_t)hash & mask;
+  for (;;) {
+    const PalletEntry& entry = shard->slots[slot];
+    if (entry.id_length == 0 ||
+        (entry.hash == hash && entry.id_length == length && memcmp(entry.id, id, length) == 0)) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+}
+
+// Shard lock held: doubles the slots once they are three quarters used
+static void growIfFull(Shard* shard) {
+  if ((shard->used + 1) * 4 <= shard->slots.size() * 3) {
+    return;
+  }
+  std::vector<PalletEntry> old;
+  old.swap(shard->slots);
+  shard->slots.assign(old.size() * 2, PalletEntry());
+  for (size_t i = 0; i < old.size(); i++) {
+    if (old[i].id_length != 0) {
+      shard->slots[probe(shard, old[i].hash, old[i].id, old[i].id_length)] = old[i];
+    }
+  }
+}
+
+// True if this made the first zone dirty, so the publisher needs waking
+static bool markDirty(FleetTable* table, Zone* zone, uint64_t now_ns) {
+  zone->version++;
+  uint64_t clean = 0;
+  return zone->dirty_ns.compare_exchange_strong(clean, now_ns) && table->dirty_count++ == 0;
+}
+
+static void addTotals(Zone* zone, int32_t pallets, int32_t loading, int32_t unloading,
+                      int64_t bottles, int64_t weight_g) {
+  if (pallets != 0) zone->pallets += pallets;
+  if (loading != 0) zone->loading += loading;
+  if (unloading != 0) zone->unloading += unloading;
+  if (bottles != 0) zone->bottles += bottles;
+  if (weight_g != 0) zone->weight_g += weight_g;
+}
+
+FleetApplyResult fleetTableApply(FleetTable* table, const char* device_id, size_t id_length,
+                                 const TelemetrySnapshot* snapshot, uint64_t now_ns) {
+  if (id_length == 0 || id_length > FLEET_DEVICE_ID_MAX) {
+    return FLEET_BAD_ID;
+  }
+  uint64_t hash = hashId(device_id, id_length);
+  Shard* shard = &table->shards[(size_t)(hash >> 32) & table->shard_mask];
+
+  int32_t pallets = 0;
+  int32_t loading = 0;
+  int32_t unloading = 0;
+  int64_t bottles;
+  int64_t weight_g;
+  int zone;
+  {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    growIfFull(shard);
+    PalletEntry* entry = &shard->slots[probe(shard, hash, device_id, id_length)];
+    if (entry->id_length == 0) {
+      // First frame from this pallet: the only time its ID is copied
+      std::unordered_map<std::string, int>::const_iterator assigned =
+          table->zone_of_device.find(std::string(device_id, id_length));
+      entry->hash = hash;
+      memcpy(entry->id, device_id, id_length);
+      entry->id[id_length] = '\0';
+      entry->id_length = (uint8_t)id_length;
+      entry->zone = (int16_t)(assigned != table->zone_of_device.end() ? assigned->second : 0);
+      entry->status = TELEMETRY_STATUS_IDLE;
+      entry->bottles = 0;
+      entry->weight_g = 0;
+      shard->used++;
+      table->pallet_count++;
+      pallets = 1;
+    } else if (snapshot->sequence != 0 && snapshot->boot_count == entry->boot &&
+               snapshot->sequence <= entry->sequence) {
+      return FLEET_STALE;
+    }
+
+    loading = (snapshot->status == TELEMETRY_STATUS_LOADING) - (entry->status == TELEMETRY_STATUS_LOADING);
+    unloading = (snapshot->status == TELEMETRY_STATUS_UNLOADING) -
+                (entry->status == TELEMETRY_STATUS_UNLOADING);
+    bottles = (int64_t)snapshot->bottles - entry->bottles;
+    weight_g = (int64_t)snapshot->weight_g - entry->weight_g;
+    zone = entry->zone;
+
+    entry->status = snapshot->status;
+    entry->bottles = snapshot->bottles;
+    entry->weight_g = snapshot->weight_g;
+    entry->boot = snapshot->boot_count;
+    entry->sequence = snapshot->sequence;
+  }
+
+  if (pallets == 0 && loading == 0 && unloading == 0 && bottles == 0 && weight_g == 0) {
+    return FLEET_UNCHANGED;
+  }
+  if (now_ns == 0) now_ns = 1;             // 0 means clean
+  addTotals(table->zones[zone].get(), pallets, loading, unloading, bottles, weight_g);
+  addTotals(&table->site, pallets, loading, unloading, bottles, weight_g);
+  // Wake the publisher only once both are marked, so it takes them together
+  bool wake = markDirty(table, table->zones[zone].get(), now_ns);
+  wake = markDirty(table, &table->site, now_ns) || wake;
+  if (wake) {
+    std::lock_guard<std::mutex> lock(table->wait_mutex);
+    table->wait_signal.notify_one();
+  }
+  return FLEET_APPLIED;
+}
+
+bool fleetTableWaitDirty(FleetTable* table, uint32_t timeout_ms) {
+  std::unique_lock<std::mutex> lock(table->wait_mutex);
+  table->wait_signal.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                              [table] { return table->dirty_count > 0 || table->woken; });
+  table->woken = false;
+  return table->dirty_count > 0;
+}
+
+void fleetTableWake(FleetTable* table) {
+  std::lock_guard<std::mutex> lock(table->wait_mutex);
+  table->woken = true;
+  table->wait_signal.notify_all();
+}
+
+static FleetTotals loadTotals(const Zone* zone) {
+  FleetTotals totals;
+  totals.pallets = zone->pallets;
+  totals.loading = zone->loading;
+  totals.unloading = zone->unloading;
+  totals.bottles = zone->bottles;
+  totals.weight_g = zone->weight_g;
+  return totals;
+}
+
+static bool collectZone(FleetTable* table, Zone* zone, int index, FleetTotalsUpdate* update) {
+  if (zone->dirty_ns == 0) {
+    return false;
+  }
+  uint64_t dirty_ns = zone->dirty_ns.exchange(0);
+  if (dirty_ns == 0) {
+    return false;
+  }
+  table->dirty_count--;
+  update->zone = index;
+  update->dirty_ns = dirty_ns;
+  update->version = zone->version;
+  update->totals = loadTotals(zone);
+  return true;
+}
+
+size_t fleetTableCollect(FleetTable* table, FleetTotalsUpdate* updates, size_t capacity) {
+  size_t count = 0;
+  for (size_t i = 0; i < table->zones.size() && count < capacity; i++) {
+    count += collectZone(table, table->zones[i].get(), (int)i, &updates[count]);
+  }
+  // The site last, so it is never older than the zones published with it
+  if (count < capacity) {
+    count += collectZone(table, &table->site, FLEET_SITE, &updates[count]);
+  }
+  return count;
+}
+
+FleetTotals fleetTableTotals(const FleetTable* table, int zone) {
+  return loadTotals(zone == FLEET_SITE ? &table->site : table->zones[zone].get());
+}
+
+size_t fleetTableZoneCount(const FleetTable* table) {
+  return table->zones.size();
+}
+
+const char* fleetTableZoneName(const FleetTable* table, int zone) {
+  return zone == FLEET_SITE ? "site" : table->zones[zone]->name.c_str();
+}
+
+size_t fleetTablePalletCount(const FleetTable* table) {
+  return table->pallet_count;
+}
+
+FleetLatency* fleetLatencyCreate() {
+  FleetLatency* latency = new FleetLatency();
+  fleetLatencyReset(latency);
+  return latency;
+}
+
+void fleetLatencyDestroy(FleetLatency* latency) {
+  delete latency;
+}
+
+void fleetLatencyRecord(FleetLatency* latency, uint64_t ns) {
+  int bucket = 0;
+  while (bucket < FLEET_LATENCY_BUCKETS - 1 && (ns >> bucket) != 0) {
+    bucket++;
+  }
+  latency->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  latency->count.fetch_add(1, std::memory_order_relaxed);
+  uint64_t seen = latency->max_ns.load(std::memory_order_relaxed);
+  while (ns > seen && !latency->max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t fleetLatencyPercentile(const FleetLatency* latency, double fraction) {
+  uint64_t count = latency->count.load(std::memory_order_relaxed);
+  uint64_t wanted = (uint64_t)(count * fraction);
+  uint64_t seen = 0;
+  for (int i = 0; i < FLEET_LATENCY_BUCKETS; i++) {
+    seen += latency->buckets[i].load(std::memory_order_relaxed);
+    if (seen > wanted) {
+      return i == 0 ? 0 : 1ULL << i;
+    }
+  }
+  return latency->max_ns.load(std::memory_order_relaxed);
+}
+
+uint64_t fleetLatencyCount(const FleetLatency* latency) {
+  return latency->count.load(std::memory_order_relaxed);
+}
+
+uint64_t fleetLatencyMax(const FleetLatency* latency) {
+  return latency->max_ns.load(std::memory_order_relaxed);
+}
+
+void fleetLatencyReset(FleetLatency* latency) {
+  for (int i = 0; i < FLEET_LATENCY_BUCKETS; i++) {
+    latency->buckets[i] = 0;
+  }
+  latency->count = 0;
+  latency->max_ns = 0;
+}
+
+uint64_t fleetNowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
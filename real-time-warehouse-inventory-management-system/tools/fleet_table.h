@@ -0,0 +1,105 @@
+/*
+  fleet_table.h - Warehouse-wide totals from per-pallet snapshot frames
+  Every pallet's latest bottles, weight and status live in a hash table
+  split into shards, each behind its own mutex, so threads applying frames
+  from different pallets rarely meet. A frame changes the totals by the
+  difference between it and the pallet's previous frame. Zone and site
+  totals are plain atomics updated with those deltas, so no lock covers
+  more than one pallet.
+
+  Applying a frame marks its zone and the site dirty. A publisher waits
+  for dirty totals and collects them; several frames that land before the
+  collection go out as one update, so a busy zone costs one publish per
+  collection instead of one per frame.
+
+  Frames are matched on (boot, sequence): a frame from the same boot with
+  a sequence no newer than the last one applied is stale (a resend, or
+  reordered between subscribers) and changes nothing.
+
+  Zones are assigned before the table is used; pallets not assigned to a
+  zone count towards FLEET_UNASSIGNED_ZONE. The table itself is portable
+  C++11 with no MQTT dependency.
+*/
+
+#ifndef FLEET_TABLE_H
+#define FLEET_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_frame.h"
+
+#define FLEET_DEVICE_ID_MAX 31             // Longest client ID kept, as in the firmware
+#define FLEET_UNASSIGNED_ZONE "unassigned"
+#define FLEET_SITE -1                      // FleetTotalsUpdate.zone of the site totals
+#define FLEET_LATENCY_BUCKETS 40           // Powers of two of ns, up to ~18 minutes
+
+enum FleetApplyResult {
+  FLEET_APPLIED,                           // Totals changed
+  FLEET_UNCHANGED,                         // Pallet state stored, totals the same
+  FLEET_STALE,                             // Older than the pallet's last frame
+  FLEET_BAD_ID                             // Empty or longer than FLEET_DEVICE_ID_MAX
+};
+
+struct FleetTotals {
+  int32_t pallets;
+  int32_t loading;                         // Pallets reporting TELEMETRY_STATUS_LOADING
+  int32_t unloading;
+  int64_t bottles;
+  int64_t weight_g;
+};
+
+struct FleetTotalsUpdate {
+  int zone;                                // Zone index, or FLEET_SITE
+  FleetTotals totals;
+  uint32_t version;                        // Changes applied to this zone so far
+  uint64_t dirty_ns;                       // When the oldest uncollected change was applied
+};
+
+// log2 histogram of latencies in ns; safe to record from any thread
+struct FleetLatency;
+
+struct FleetTable;
+
+// Builds an empty table; shard_count is rounded up to a power of two
+FleetTable* fleetTableCreate(size_t shard_count);
+void fleetTableDestroy(FleetTable* table);
+
+// Before the first fleetTableApply(): puts device_id in zone (created on
+// first use) and returns the zone index, or -1 if the ID is too long
+int fleetTableAssign(FleetTable* table, const char* device_id, const char* zone);
+
+// Applies one decoded frame from device_id (not NUL terminated, need not
+// outlive the call). now_ns timestamps the change for fleetTableCollect().
+FleetApplyResult fleetTableApply(FleetTable* table, const char* device_id, size_t id_length,
+                                 const TelemetrySnapshot* snapshot, uint64_t now_ns);
+
+// Blocks until some totals are dirty, fleetTableWake() is called or
+// timeout_ms passes; true if totals are dirty
+bool fleetTableWaitDirty(FleetTable* table, uint32_t timeout_ms);
+void fleetTableWake(FleetTable* table);
+
+// Takes every dirty zone (and the site) into updates, clearing its dirty
+// mark; returns how many were written. Zones that do not fit stay dirty.
+size_t fleetTableCollect(FleetTable* table, FleetTotalsUpdate* updates, size_t capacity);
+
+// Current totals, whether dirty or not
+FleetTotals fleetTableTotals(const FleetTable* table, int zone);
+
+size_t fleetTableZoneCount(const FleetTable* table);
+const char* fleetTableZoneName(const FleetTable* table, int zone);
+size_t fleetTablePalletCount(const FleetTable* table);
+
+FleetLatency* fleetLatencyCreate();
+void fleetLatencyDestroy(FleetLatency* latency);
+void fleetLatencyRecord(FleetLatency* latency, uint64_t ns);
+// Upper bound of the bucket holding the given fraction (0.5, 0.99, ...)
+uint64_t fleetLatencyPercentile(const FleetLatency* latency, double fraction);
+uint64_t fleetLatencyCount(const FleetLatency* latency);
+uint64_t fleetLatencyMax(const FleetLatency* latency);
+void fleetLatencyReset(FleetLatency* latency);
+
+// Monotonic clock for now_ns and the latencies
+uint64_t fleetNowNs();
+
+#endif // FLEET_TABLE_H
@@ -0,0 +1,338 @@
+/*
+ * pallet_aggregator - warehouse-wide totals from every pallet's frames
+ *
+ *   pallet_aggregator [-h host] [-p port] [-s site] [-z zones.csv] [-w workers]
+ *                     [-i min_interval_ms]
+ *
+ * Subscribes to bottle-scale/<site>/+/frame on an MQTT broker (a local
+ * mosquitto by default) and keeps every pallet's latest snapshot in a
+ * fleet_table. Whenever totals change it publishes them, retained, as
+ * JSON on
+ *   bottle-scale/<site>/totals           the whole site
+ *   bottle-scale/<site>/totals/<zone>    one zone
+ * e.g. {"zone":"dock-a","pallets":412,"bottles":9051,"weight_g":2488921,
+ *       "loading":3,"unloading":0,"version":1880,"epoch_ms":1760000000000}
+ *
+ * zones.csv has one "<device_id>,<zone>" line per pallet (# starts a
+ * comment); pallets not listed count as "unassigned".
+ *
+ * With -w N > 1 the daemon opens N broker connections sharing one
+ * subscription ($share/pallet_aggregator/...), so the broker spreads the
+ * pallets' frames over N network threads that apply them in parallel.
+ * Frames of one pallet may then be handled out of order; fleet_table
+ * drops the older one by its sequence number.
+ *
+ * Each frame is decoded straight from the library's receive buffer and
+ * the device ID is taken from the topic in place; nothing is copied
+ * except the first time a pallet is seen. -i sets the shortest time
+ * between two publishes of the same totals (default 0: publish as soon
+ * as the publisher thread collects them). Statistics, including apply
+ * and publish latencies, are printed every 10 s.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mosquitto.h>
+
+#include "fleet_table.h"
+#include "telemetry_frame.h"
+
+#define AGGREGATOR_CLIENT_PREFIX "pallet_aggregator"
+#define AGGREGATOR_SHARE_GROUP "pallet_aggregator"
+#define AGGREGATOR_KEEPALIVE 30
+#define AGGREGATOR_SHARDS 256
+#define AGGREGATOR_STATS_INTERVAL 10000    // ms
+#define AGGREGATOR_MAX_WORKERS 64
+
+struct Options {
+  const char* host;
+  int port;
+  const char* site;
+  const char* zones_path;
+  int workers;
+  uint32_t min_interval_ms;
+};
+
+struct Worker {
+  struct mosquitto* client;
+  std::string subscription;
+};
+
+struct Counters {
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> applied;
+  std::atomic<uint64_t> stale;
+  std::atomic<uint64_t> rejected;          // Undecodable frames and bad topics
+  std::atomic<uint64_t> published;
+  std::atomic<uint64_t> publish_failures;
+};
+
+static FleetTable* table = NULL;
+static FleetLatency* apply_latency = NULL;
+static FleetLatency* publish_latency = NULL;
+static Counters counters;
+static std::string topic_prefix;           // bottle-scale/<site>/
+static std::atomic<bool> running(true);
+
+static void onSignal(int) {
+  running = false;
+}
+
+static uint64_t epochMs() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+static bool loadZones(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return false;
+  }
+  char line[256];
+  int line_number = 0;
+  bool ok = true;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    line_number++;
+    line[strcspn(line, "\r\n#")] = '\0';
+    char* comma = strchr(line, ',');
+    if (line[0] == '\0') continue;
+    if (comma == NULL || comma == line || comma[1] == '\0') {
+      fprintf(stderr, "%s:%d: expected <device_id>,<zone>\n", path, line_number);
+      ok = false;
+      continue;
+    }
+    *comma = '\0';
+    if (strpbrk(comma + 1, "/+#\"\\") != NULL) {
+      fprintf(stderr, "%s:%d: zone names cannot contain / + # \" or \\\n", path, line_number);
+      ok = false;
+      continue;
+    }
+    if (fleetTableAssign(table, line, comma + 1) < 0) {
+      fprintf(stderr, "%s:%d: device ID longer than %d characters\n", path, line_number,
+              FLEET_DEVICE_ID_MAX);
+      ok = false;
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+// Network thread of one worker connection
+static void onConnect(struct mosquitto* client, void* user, int result) {
+  Worker* worker = (Worker*)user;
+  if (result != 0) {
+    fprintf(stderr, "connect refused: %s\n", mosquitto_connack_string(result));
+    return;
+  }
+  int rc = mosquitto_subscribe(client, NULL, worker->subscription.c_str(), 0);
+  if (rc != MOSQ_ERR_SUCCESS) {
+    fprintf(stderr, "subscribe %s: %s\n", worker->subscription.c_str(), mosquitto_strerror(rc));
+  }
+}
+
+// Network thread of one worker connection: bottle-scale/<site>/<device>/frame
+static void onMessage(struct mosquitto*, void*, const struct mosquitto_message* message) {
+  uint64_t start = fleetNowNs();
+  counters.frames++;
+
+  const char* topic = message->topic;
+  size_t topic_length = strlen(topic);
+  if (topic_length <= topic_prefix.size() ||
+      memcmp(topic, topic_prefix.data(), topic_prefix.size()) != 0) {
+    counters.rejected++;
+    return;
+  }
+  const char* device_id = topic + topic_prefix.size();
+  const char* device_end = (const char*)memchr(device_id, '/', topic + topic_length - device_id);
+  TelemetrySnapshot snapshot;
+  if (device_end == NULL ||
+      telemetryDecodeSnapshot((const uint8_t*)message->payload, (size_t)message->payloadlen,
+                              &snapshot) != TELEMETRY_OK) {
+    counters.rejected++;
+    return;
+  }
+
+  switch (fleetTableApply(table, device_id, (size_t)(device_end - device_id), &snapshot, start)) {
+    case FLEET_APPLIED: counters.applied++; break;
+    case FLEET_STALE: counters.stale++; break;
+    case FLEET_BAD_ID: counters.rejected++; break;
+    case FLEET_UNCHANGED: break;
+  }
+  fleetLatencyRecord(apply_latency, fleetNowNs() - start);
+}
+
+static void publishTotals(struct mosquitto* client, const FleetTotalsUpdate* update, uint64_t now_ms) {
+  const char* zone = fleetTableZoneName(table, update->zone);
+  std::string topic = topic_prefix + "totals";
+  if (update->zone != FLEET_SITE) {
+    topic += "/";
+    topic += zone;
+  }
+
+  char payload[256];
+  const FleetTotals& totals = update->totals;
+  int length = snprintf(payload, sizeof(payload),
+                        "{\"zone\":\"%s\",\"pallets\":%d,\"bottles\":%lld,\"weight_g\":%lld,"
+                        "\"loading\":%d,\"unloading\":%d,\"version\":%lu,\"epoch_ms\":%llu}",
+                        zone, totals.pallets, (long long)totals.bottles, (long long)totals.weight_g,
+                        totals.loading, totals.unloading, (unsigned long)update->version,
+                        (unsigned long long)now_ms);
+  if (length < 0 || length >= (int)sizeof(payload)) {
+    counters.publish_failures++;
+    return;
+  }
+  int rc = mosquitto_publish(client, NULL, topic.c_str(), length, payload, 0, true);
+  if (rc == MOSQ_ERR_SUCCESS) {
+    counters.published++;
+  } else {
+    counters.publish_failures++;
+  }
+}
+
+// Publisher thread: collects dirty totals and hands them to the first
+// worker's connection, which sends them from its network thread
+static void runPublisher(struct mosquitto* client, uint32_t min_interval_ms) {
+  std::vector<FleetTotalsUpdate> updates(fleetTableZoneCount(table) + 1);
+  while (running) {
+    if (!fleetTableWaitDirty(table, 200)) {
+      continue;
+    }
+    size_t count = fleetTableCollect(table, updates.data(), updates.size());
+    uint64_t now = fleetNowNs();
+    uint64_t now_ms = epochMs();
+    for (size_t i = 0; i < count; i++) {
+      publishTotals(client, &updates[i], now_ms);
+      fleetLatencyRecord(publish_latency, now - updates[i].dirty_ns);
+    }
+    if (min_interval_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(min_interval_ms));
+    }
+  }
+}
+
+// Latencies are reset after each print, so they cover one interval
+static void printStats() {
+  printf("📊 %lu pallets, %lu frames (%lu applied, %lu stale, %lu rejected), %lu totals published"
+         " (%lu failed)\n",
+         (unsigned long)fleetTablePalletCount(table), (unsigned long)counters.frames.load(),
+         (unsigned long)counters.applied.load(), (unsigned long)counters.stale.load(),
+         (unsigned long)counters.rejected.load(), (unsigned long)counters.published.load(),
+         (unsigned long)counters.publish_failures.load());
+  printf("   apply   p50 <%.1f us  p99 <%.1f us  max %.1f us\n",
+         fleetLatencyPercentile(apply_latency, 0.5) / 1000.0,
+         fleetLatencyPercentile(apply_latency, 0.99) / 1000.0, fleetLatencyMax(apply_latency) / 1000.0);
+  printf("   publish p50 <%.1f us  p99 <%.1f us  max %.1f us\n",
+         fleetLatencyPercentile(publish_latency, 0.5) / 1000.0,
+         fleetLatencyPercentile(publish_latency, 0.99) / 1000.0,
+         fleetLatencyMax(publish_latency) / 1000.0);
+  fflush(stdout);
+  fleetLatencyReset(apply_latency);
+  fleetLatencyReset(publish_latency);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-h host] [-p port] [-s site] [-z zones.csv] [-w workers] [-i min_interval_ms]\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  Options options = { "localhost", 1883, "main", NULL, 1, 0 };
+  int opt;
+  while ((opt = getopt(argc, argv, "h:p:s:z:w:i:")) != -1) {
+    switch (opt) {
+      case 'h': options.host = optarg; break;
+      case 'p': options.port = atoi(optarg); break;
+      case 's': options.site = optarg; break;
+      case 'z': options.zones_path = optarg; break;
+      case 'w': options.workers = atoi(optarg); break;
+      case 'i': options.min_interval_ms = (uint32_t)atol(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (options.workers < 1 || options.workers > AGGREGATOR_MAX_WORKERS) {
+    fprintf(stderr, "workers must be 1-%d\n", AGGREGATOR_MAX_WORKERS);
+    return 2;
+  }
+
+  table = fleetTableCreate(AGGREGATOR_SHARDS);
+  apply_latency = fleetLatencyCreate();
+  publish_latency = fleetLatencyCreate();
+  if (options.zones_path != NULL && !loadZones(options.zones_path)) {
+    return 1;
+  }
+  topic_prefix = std::string("bottle-scale/") + options.site + "/";
+  std::string subscription = topic_prefix + "+/frame";
+  if (options.workers > 1) {
+    subscription = "$share/" AGGREGATOR_SHARE_GROUP "/" + subscription;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  mosquitto_lib_init();
+
+  std::vector<Worker> workers(options.workers);
+  for (int i = 0; i < options.workers; i++) {
+    char client_id[64];
+    snprintf(client_id, sizeof(client_id), "%s_%s_%d_%d", AGGREGATOR_CLIENT_PREFIX, options.site,
+             (int)getpid(), i);
+    workers[i].subscription = subscription;
+    workers[i].client = mosquitto_new(client_id, true, &workers[i]);
+    if (workers[i].client == NULL) {
+      fprintf(stderr, "mosquitto_new: %s\n", strerror(errno));
+      return 1;
+    }
+    mosquitto_connect_callback_set(workers[i].client, onConnect);
+    mosquitto_message_callback_set(workers[i].client, onMessage);
+    mosquitto_reconnect_delay_set(workers[i].client, 1, 30, true);
+    // Connects in the network thread, which also retries
+    int rc = mosquitto_connect_async(workers[i].client, options.host, options.port, AGGREGATOR_KEEPALIVE);
+    if (rc == MOSQ_ERR_SUCCESS) {
+      rc = mosquitto_loop_start(workers[i].client);
+    }
+    if (rc != MOSQ_ERR_SUCCESS) {
+      fprintf(stderr, "%s:%d: %s\n", options.host, options.port, mosquitto_strerror(rc));
+      return 1;
+    }
+  }
+  printf("📡 %s on %s:%d, %lu zones, %d worker(s)\n", subscription.c_str(), options.host, options.port,
+         (unsigned long)fleetTableZoneCount(table), options.workers);
+
+  std::thread publisher(runPublisher, workers[0].client, options.min_interval_ms);
+  uint64_t last_stats = fleetNowNs();
+  while (running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    if (fleetNowNs() - last_stats >= AGGREGATOR_STATS_INTERVAL * 1000000ULL) {
+      printStats();
+      last_stats = fleetNowNs();
+    }
+  }
+
+  fleetTableWake(table);
+  publisher.join();
+  for (int i = 0; i < options.workers; i++) {
+    mosquitto_disconnect(workers[i].client);
+    mosquitto_loop_stop(workers[i].client, false);
+    mosquitto_destroy(workers[i].client);
+  }
+  mosquitto_lib_cleanup();
+  printStats();
+  fleetLatencyDestroy(apply_latency);
+  fleetLatencyDestroy(publish_latency);
+  fleetTableDestroy(table);
+  return 0;
+}
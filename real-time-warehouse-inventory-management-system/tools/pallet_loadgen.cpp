@@ -0,0 +1,614 @@
+/*
+ * pallet_loadgen - emulates a fleet of pallets against an MQTT broker
+ *
+ *   pallet_loadgen [-h host] [-p port] [-s site] [-n pallets] [-t threads]
+ *                  [-d seconds] [-i sample_ms] [-b heartbeat_s] [-x tx_per_hour]
+ *
+ * Defaults: 100 pallets on 4 threads for 30 s against localhost:1883, site
+ * "main", a sample every 800 ms, a 300 s heartbeat and 6 NFC transactions
+ * per pallet per hour.
+ *
+ * Every pallet publishes what src/main.cpp publishes, on the same topics:
+ *   <site>/<device>/frame            binary snapshot (telemetry_frame.h), sent
+ *                                    by exception through the firmware's own
+ *                                    report_policy
+ *   <site>/<device>/nfc/vehicle-id   at the end of each transaction
+ *   <site>/<device>/nfc/status       LOAD_COMPLETE / UNLOAD_COMPLETE
+ *   <site>/<device>/nfc/transaction  the transaction JSON (json_template.h),
+ *                                    resent with backoff until acknowledged
+ * and subscribes to its own <site>/<device>/nfc/ack like the firmware.
+ * Device IDs are BottleScale_020000XXXXXX, a locally administered MAC range
+ * that no real ESP32 reports.
+ *
+ * A pallet holds 10-60 bottles at rest. A vehicle arrives at random
+ * (Poisson, -x per hour) to load or unload 5-20 bottles, one every few
+ * samples, with the NFC state and status moving as on a real pallet.
+ *
+ * Two latencies are reported:
+ *   frame  publish to delivery back through the broker, measured by a
+ *          separate client subscribed to <site>/+/frame
+ *   ack    first publish of a transaction to its acknowledgement, the
+ *          round trip through the backend (server.js must be running
+ *          with the same MQTT_SITE)
+ * A generator thread that cannot keep up with its pallets counts late
+ * ticks; add threads until that stays 0. Each thread shares one broker
+ * connection among its pallets, where real pallets have one each.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mosquitto.h>
+
+#include "fleet_table.h"
+#include "json_template.h"
+#include "pallet_payloads.h"
+#include "report_policy.h"
+#include "telemetry_frame.h"
+
+#define LOADGEN_DEVICE_PREFIX "BottleScale_020000"
+#define LOADGEN_KEEPALIVE 30
+#define LOADGEN_REPORT_INTERVAL 5000       // ms between progress lines
+#define LOADGEN_BOTTLE_WEIGHT 275          // g, BOTTLE_WEIGHT in src/main.cpp
+#define LOADGEN_MAX_BOTTLES 60
+#define LOADGEN_VEHICLES 50                // Distinct vehicle UIDs
+#define LOADGEN_SENT_SLOTS 16              // Frame send times kept per pallet
+#define LOADGEN_COMPLETE_HOLD 5000         // ms the *_COMPLETE NFC state is shown
+#define LOADGEN_RESEND_MIN 5000            // Transaction resend backoff, as transaction_queue
+#define LOADGEN_RESEND_MAX 60000
+
+// Firmware constants the emulation follows (src/main.cpp, nfc_transactions.h)
+#define REPORT_WEIGHT_DEADBAND 50
+#define REPORT_MIN_INTERVAL 1000
+#define NFC_UID_MAX_LENGTH 7
+enum { NFC_IDLE, NFC_LOAD_READY, NFC_LOAD_COMPLETE, NFC_UNLOAD_READY, NFC_UNLOAD_COMPLETE };
+
+struct Options {
+  const char* host;
+  int port;
+  const char* site;
+  int pallets;
+  int threads;
+  double seconds;
+  uint32_t sample_ms;
+  uint32_t heartbeat_s;
+  double tx_per_hour;
+};
+
+struct SentFrame {
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint64_t> ns;
+};
+
+struct Pallet {
+  char device_id[32];
+  char topic_frame[96];
+  char topic_vehicle[96];
+  char topic_status[96];
+  char topic_transaction[96];
+  char topic_ack[96];
+  uint32_t boot_offset_ms;                 // millis() at the start of the run
+  uint32_t tx_generation;                  // First half of every tx_id
+  ReportPolicy policy;
+  TelemetrySnapshot snapshot;
+  uint32_t rng;
+
+  // Vehicle at the pallet: bottles still to move (negative: loading)
+  int pending_bottles;
+  int moved_bottles;
+  uint8_t vehicle_uid[NFC_UID_MAX_LENGTH];
+  uint32_t complete_until;
+  int previous_bottles;
+
+  // Transaction awaiting its ack, shared with the network thread
+  uint32_t tx_sequence;
+  bool tx_pending;
+  char tx_id[17];
+  char tx_payload[JSON_TEMPLATE_SIZE(nfc_transaction_schema)];
+  size_t tx_length;
+  uint64_t tx_first_sent_ns;
+  uint32_t tx_next_send_ms;
+  uint32_t tx_backoff_ms;
+
+  SentFrame sent[LOADGEN_SENT_SLOTS];
+};
+
+struct Generator {
+  int index;
+  struct mosquitto* client;
+  std::vector<Pallet*> pallets;
+  std::mutex tx_mutex;                     // Guards the pallets' tx_* fields
+};
+
+struct Counters {
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> nfc_messages;
+  std::atomic<uint64_t> transactions;
+  std::atomic<uint64_t> resends;
+  std::atomic<uint64_t> acks;
+  std::atomic<uint64_t> stray_acks;        // Duplicate or unknown tx_id
+  std::atomic<uint64_t> bytes;
+  std::atomic<uint64_t> publish_failures;
+  std::atomic<uint64_t> late_ticks;
+  std::atomic<uint64_t> frames_received;
+};
+
+static Options options;
+static std::vector<Pallet*> fleet;
+static std::string topic_prefix;           // bottle-scale/<site>/
+static Counters counters;
+static FleetLatency* frame_latency = NULL;
+static FleetLatency* ack_latency = NULL;
+static std::atomic<bool> running(true);
+static uint64_t start_ns = 0;
+
+static void onSignal(int) {
+  running = false;
+}
+
+static uint32_t nextRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static double uniform(uint32_t* state) {
+  return (nextRandom(state) >> 8) / 16777216.0;
+}
+
+static uint64_t epochMs() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+// Run time in ms, the clock every pallet's millis() is offset from
+static uint32_t runMs() {
+  return (uint32_t)((fleetNowNs() - start_ns) / 1000000);
+}
+
+// Pallet index from bottle-scale/<site>/BottleScale_020000XXXXXX/...; -1 if not ours
+static int palletFromTopic(const char* topic) {
+  size_t prefix_length = topic_prefix.size() + strlen(LOADGEN_DEVICE_PREFIX);
+  if (strncmp(topic, topic_prefix.c_str(), topic_prefix.size()) != 0 ||
+      strncmp(topic + topic_prefix.size(), LOADGEN_DEVICE_PREFIX, strlen(LOADGEN_DEVICE_PREFIX)) != 0) {
+    return -1;
+  }
+  char* end;
+  unsigned long index = strtoul(topic + prefix_length, &end, 16);
+  if (end != topic + prefix_length + 6 || *end != '/' || index >= fleet.size()) {
+    return -1;
+  }
+  return (int)index;
+}
+
+static bool publish(Generator* generator, const char* topic, const void* payload, size_t length) {
+  int rc = mosquitto_publish(generator->client, NULL, topic, (int)length, payload, 0, false);
+  if (rc != MOSQ_ERR_SUCCESS) {
+    counters.publish_failures++;
+    return false;
+  }
+  counters.bytes += length;
+  return true;
+}
+
+static void initPallet(Pallet* pallet, int index) {
+  pallet->rng = 2463534242U ^ (uint32_t)(index * 2654435761U);
+  if (pallet->rng == 0) pallet->rng = 1;
+  snprintf(pallet->device_id, sizeof(pallet->device_id), LOADGEN_DEVICE_PREFIX "%06X", index);
+  const char* id = pallet->device_id;
+  snprintf(pallet->topic_frame, sizeof(pallet->topic_frame), "%s%s/frame", topic_prefix.c_str(), id);
+  snprintf(pallet->topic_vehicle, sizeof(pallet->topic_vehicle), "%s%s/nfc/vehicle-id", topic_prefix.c_str(), id);
+  snprintf(pallet->topic_status, sizeof(pallet->topic_status), "%s%s/nfc/status", topic_prefix.c_str(), id);
+  snprintf(pallet->topic_transaction, sizeof(pallet->topic_transaction), "%s%s/nfc/transaction",
+           topic_prefix.c_str(), id);
+  snprintf(pallet->topic_ack, sizeof(pallet->topic_ack), "%s%s/nfc/ack", topic_prefix.c_str(), id);
+
+  pallet->boot_offset_ms = nextRandom(&pallet->rng) % 86400000;
+  pallet->tx_generation = nextRandom(&pallet->rng);
+  reportPolicyBegin(&pallet->policy, REPORT_WEIGHT_DEADBAND, options.heartbeat_s * 1000,
+                    REPORT_MIN_INTERVAL);
+
+  memset(&pallet->snapshot, 0, sizeof(pallet->snapshot));
+  pallet->snapshot.bottles = (int16_t)(10 + nextRandom(&pallet->rng) % 51);
+  pallet->snapshot.boot_count = 1 + nextRandom(&pallet->rng) % 50;
+  pallet->snapshot.clock_age_s = (uint16_t)(nextRandom(&pallet->rng) % 3600);
+  pallet->previous_bottles = pallet->snapshot.bottles;
+  pallet->pending_bottles = 0;
+  pallet->moved_bottles = 0;
+  pallet->complete_until = 0;
+  pallet->tx_sequence = 0;
+  pallet->tx_pending = false;
+  for (int i = 0; i < LOADGEN_SENT_SLOTS; i++) {
+    pallet->sent[i].sequence = 0;
+    pallet->sent[i].ns = 0;
+  }
+}
+
+// Vehicle done: the NFC topics and the transaction, as handleNFCTransactionComplete()
+static void completeTransaction(Generator* generator, Pallet* pallet, uint32_t now_ms) {
+  bool loading = pallet->moved_bottles < 0;
+  TelemetrySnapshot* snapshot = &pallet->snapshot;
+  snapshot->nfc_state = loading ? NFC_LOAD_COMPLETE : NFC_UNLOAD_COMPLETE;
+  pallet->complete_until = now_ms + LOADGEN_COMPLETE_HOLD;
+
+  char vehicle_id[NFC_UID_MAX_LENGTH * 2 + 1];
+  telemetryFormatUID(pallet->vehicle_uid, NFC_UID_MAX_LENGTH, vehicle_id);
+  const char* status = loading ? "LOAD_COMPLETE" : "UNLOAD_COMPLETE";
+  publish(generator, pallet->topic_vehicle, vehicle_id, strlen(vehicle_id));
+  publish(generator, pallet->topic_status, status, strlen(status));
+  counters.nfc_messages += 2;
+
+  std::lock_guard<std::mutex> lock(generator->tx_mutex);
+  if (pallet->tx_pending) {
+    return;                                // Queued behind the unacknowledged one on a real pallet
+  }
+  JsonTemplate payload(nfc_transaction_schema, pallet->tx_payload, sizeof(pallet->tx_payload));
+  pallet->tx_sequence++;
+  snprintf(pallet->tx_id, sizeof(pallet->tx_id), "%08lx%08lx", (unsigned long)pallet->tx_generation,
+           (unsigned long)pallet->tx_sequence);
+  payload.setString(TX_JSON_DEVICE_ID, pallet->device_id);
+  payload.setString(TX_JSON_TX_ID, pallet->tx_id);
+  payload.setUnsigned(TX_JSON_SEQUENCE, pallet->tx_sequence);
+  payload.setString(TX_JSON_VEHICLE_ID, vehicle_id);
+  payload.setString(TX_JSON_TYPE, loading ? "LOAD" : "UNLOAD");
+  payload.setInt(TX_JSON_BOTTLE_COUNT, abs(pallet->moved_bottles));
+  payload.setInt(TX_JSON_TOTAL_BOTTLES, snapshot->bottles);
+  payload.setUnsigned(TX_JSON_TIMESTAMP, pallet->boot_offset_ms + now_ms);
+  payload.setUnsigned(TX_JSON_EPOCH_MS, epochMs());
+  pallet->tx_length = payload.length();
+  pallet->tx_pending = true;
+  pallet->tx_first_sent_ns = fleetNowNs();
+  pallet->tx_backoff_ms = LOADGEN_RESEND_MIN;
+  pallet->tx_next_send_ms = now_ms + LOADGEN_RESEND_MIN;
+  publish(generator, pallet->topic_transaction, pallet->tx_payload, pallet->tx_length);
+  counters.transactions++;
+  counters.nfc_messages++;
+}
+
+// Resends the pending transaction once its backoff has passed
+static void resendTransaction(Generator* generator, Pallet* pallet, uint32_t now_ms) {
+  std::lock_guard<std::mutex> lock(generator->tx_mutex);
+  if (!pallet->tx_pending || (int32_t)(now_ms - pallet->tx_next_send_ms) < 0) {
+    return;
+  }
+  publish(generator, pallet->topic_transaction, pallet->tx_payload, pallet->tx_length);
+  pallet->tx_backoff_ms = pallet->tx_backoff_ms * 2 > LOADGEN_RESEND_MAX ? LOADGEN_RESEND_MAX
+                                                                         : pallet->tx_backoff_ms * 2;
+  pallet->tx_next_send_ms = now_ms + pallet->tx_backoff_ms;
+  counters.resends++;
+  counters.nfc_messages++;
+}
+
+// One weight sample: move the simulation on, then publish by exception
+static void samplePallet(Generator* generator, Pallet* pallet, uint32_t now_ms) {
+  TelemetrySnapshot* snapshot = &pallet->snapshot;
+  double sample_s = options.sample_ms / 1000.0;
+
+  if (pallet->pending_bottles == 0 && snapshot->nfc_state != NFC_LOAD_READY &&
+      snapshot->nfc_state != NFC_UNLOAD_READY &&
+      uniform(&pallet->rng) < options.tx_per_hour * sample_s / 3600.0) {
+    // A vehicle taps in: load from a full pallet, unload onto an empty one
+    int amount = 5 + (int)(nextRandom(&pallet->rng) % 16);
+    bool load = snapshot->bottles > LOADGEN_MAX_BOTTLES / 2 ? uniform(&pallet->rng) < 0.8
+                                                             : uniform(&pallet->rng) < 0.2;
+    if (load && amount > snapshot->bottles) amount = snapshot->bottles;
+    if (!load && amount > LOADGEN_MAX_BOTTLES - snapshot->bottles) amount = LOADGEN_MAX_BOTTLES - snapshot->bottles;
+    if (amount > 0) {
+      pallet->pending_bottles = load ? -amount : amount;
+      pallet->moved_bottles = 0;
+      snapshot->nfc_state = load ? NFC_LOAD_READY : NFC_UNLOAD_READY;
+      uint32_t vehicle = nextRandom(&pallet->rng) % LOADGEN_VEHICLES;
+      pallet->vehicle_uid[0] = 0x04;
+      for (int i = 1; i < NFC_UID_MAX_LENGTH; i++) {
+        pallet->vehicle_uid[i] = (uint8_t)((vehicle * 2654435761U) >> (i * 4));
+      }
+      memcpy(snapshot->vehicle_uid, pallet->vehicle_uid, NFC_UID_MAX_LENGTH);
+      snapshot->vehicle_uid_length = NFC_UID_MAX_LENGTH;
+      snapshot->open_transactions = 1;
+    }
+  } else if (pallet->pending_bottles != 0 && uniform(&pallet->rng) < 0.4) {
+    // A bottle every 2-3 samples
+    int step = pallet->pending_bottles > 0 ? 1 : -1;
+    snapshot->bottles = (int16_t)(snapshot->bottles + step);
+    pallet->pending_bottles -= step;
+    pallet->moved_bottles += step;
+    if (pallet->pending_bottles == 0) {
+      snapshot->open_transactions = 0;
+      completeTransaction(generator, pallet, now_ms);
+    }
+  } else if (pallet->complete_until != 0 && (int32_t)(now_ms - pallet->complete_until) >= 0) {
+    pallet->complete_until = 0;
+    snapshot->nfc_state = NFC_IDLE;
+    snapshot->vehicle_uid_length = 0;
+    memset(snapshot->vehicle_uid, 0, sizeof(snapshot->vehicle_uid));
+  }
+
+  // Status follows the count as updateStatus() does; weight is the count
+  // plus a few grams of load cell noise
+  snapshot->status = snapshot->bottles < pallet->previous_bottles   ? TELEMETRY_STATUS_LOADING
+                     : snapshot->bottles > pallet->previous_bottles ? TELEMETRY_STATUS_UNLOADING
+                                                                    : TELEMETRY_STATUS_IDLE;
+  pallet->previous_bottles = snapshot->bottles;
+  snapshot->weight_g = snapshot->bottles * LOADGEN_BOTTLE_WEIGHT + (int32_t)(nextRandom(&pallet->rng) % 11) - 5;
+  resendTransaction(generator, pallet, now_ms);
+
+  ReportSample sample;
+  sample.weight = snapshot->weight_g;
+  sample.count = snapshot->bottles;
+  sample.status = snapshot->status;
+  sample.nfc_state = snapshot->nfc_state;
+  uint32_t pallet_ms = pallet->boot_offset_ms + now_ms;
+  ReportReason reason = reportCheck(&pallet->policy, &sample, pallet_ms);
+  if (reason == REPORT_NONE) {
+    return;
+  }
+
+  snapshot->timestamp_ms = pallet_ms;
+  snapshot->report_reason = (uint8_t)reason;
+  snapshot->suppressed = pallet->policy.suppressed;
+  snapshot->epoch_ms = epochMs();
+  snapshot->sequence++;
+  uint8_t frame[TELEMETRY_SNAPSHOT_SIZE];
+  size_t length = telemetryEncodeSnapshot(snapshot, frame, sizeof(frame));
+  SentFrame* sent = &pallet->sent[snapshot->sequence % LOADGEN_SENT_SLOTS];
+  sent->ns = fleetNowNs();
+  sent->sequence = snapshot->sequence;
+  if (publish(generator, pallet->topic_frame, frame, length)) {
+    reportSent(&pallet->policy, &sample, reason, pallet_ms);
+    counters.frames++;
+  }
+}
+
+// Generator thread: samples every pallet it owns once per sample interval
+static void runGenerator(Generator* generator) {
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  std::chrono::milliseconds interval(options.sample_ms);
+  while (running) {
+    uint32_t now_ms = runMs();
+    for (size_t i = 0; i < generator->pallets.size() && running; i++) {
+      samplePallet(generator, generator->pallets[i], now_ms);
+    }
+    next += interval;
+    if (std::chrono::steady_clock::now() > next) {
+      counters.late_ticks++;
+      next = std::chrono::steady_clock::now();
+    } else {
+      std::this_thread::sleep_until(next);
+    }
+  }
+}
+
+// Generator network thread: subscribe to the owned pallets' ack topics
+static void onGeneratorConnect(struct mosquitto* client, void* user, int result) {
+  Generator* generator = (Generator*)user;
+  if (result != 0) {
+    fprintf(stderr, "connect refused: %s\n", mosquitto_connack_string(result));
+    return;
+  }
+  for (size_t i = 0; i < generator->pallets.size(); i++) {
+    mosquitto_subscribe(client, NULL, generator->pallets[i]->topic_ack, 0);
+  }
+}
+
+// Generator network thread: the backend acknowledged a transaction
+static void onAck(struct mosquitto*, void* user, const struct mosquitto_message* message) {
+  Generator* generator = (Generator*)user;
+  int index = palletFromTopic(message->topic);
+  if (index < 0) {
+    return;
+  }
+  Pallet* pallet = fleet[index];
+  std::lock_guard<std::mutex> lock(generator->tx_mutex);
+  if (pallet->tx_pending && message->payloadlen == 16 && memcmp(message->payload, pallet->tx_id, 16) == 0) {
+    pallet->tx_pending = false;
+    fleetLatencyRecord(ack_latency, fleetNowNs() - pallet->tx_first_sent_ns);
+    counters.acks++;
+  } else {
+    counters.stray_acks++;
+  }
+}
+
+static void onProbeConnect(struct mosquitto* client, void*, int result) {
+  if (result == 0) {
+    mosquitto_subscribe(client, NULL, (topic_prefix + "+/frame").c_str(), 0);
+  }
+}
+
+// Probe network thread: a frame came back through the broker
+static void onProbeFrame(struct mosquitto*, void*, const struct mosquitto_message* message) {
+  uint64_t now = fleetNowNs();
+  int index = palletFromTopic(message->topic);
+  TelemetrySnapshot snapshot;
+  if (index < 0 || telemetryDecodeSnapshot((const uint8_t*)message->payload, (size_t)message->payloadlen,
+                                           &snapshot) != TELEMETRY_OK) {
+    return;
+  }
+  counters.frames_received++;
+  SentFrame* sent = &fleet[index]->sent[snapshot.sequence % LOADGEN_SENT_SLOTS];
+  uint64_t sent_ns = sent->ns;
+  if (sent->sequence == snapshot.sequence && sent_ns != 0 && now > sent_ns) {
+    fleetLatencyRecord(frame_latency, now - sent_ns);
+  }
+}
+
+static struct mosquitto* connectClient(const char* role, int index, void* user,
+                                       void (*on_connect)(struct mosquitto*, void*, int),
+                                       void (*on_message)(struct mosquitto*, void*,
+                                                          const struct mosquitto_message*)) {
+  char client_id[64];
+  snprintf(client_id, sizeof(client_id), "pallet_loadgen_%d_%s%d", (int)getpid(), role, index);
+  struct mosquitto* client = mosquitto_new(client_id, true, user);
+  if (client == NULL) {
+    fprintf(stderr, "mosquitto_new: %s\n", strerror(errno));
+    return NULL;
+  }
+  mosquitto_connect_callback_set(client, on_connect);
+  mosquitto_message_callback_set(client, on_message);
+  mosquitto_reconnect_delay_set(client, 1, 30, true);
+  int rc = mosquitto_connect_async(client, options.host, options.port, LOADGEN_KEEPALIVE);
+  if (rc == MOSQ_ERR_SUCCESS) {
+    rc = mosquitto_loop_start(client);
+  }
+  if (rc != MOSQ_ERR_SUCCESS) {
+    fprintf(stderr, "%s:%d: %s\n", options.host, options.port, mosquitto_strerror(rc));
+    mosquitto_destroy(client);
+    return NULL;
+  }
+  return client;
+}
+
+static void printLatency(const char* name, const FleetLatency* latency) {
+  if (fleetLatencyCount(latency) == 0) {
+    printf("  %-6s no samples\n", name);
+    return;
+  }
+  printf("  %-6s p50 <%.2f ms  p99 <%.2f ms  p99.9 <%.2f ms  max %.2f ms  (%lu)\n", name,
+         fleetLatencyPercentile(latency, 0.5) / 1e6, fleetLatencyPercentile(latency, 0.99) / 1e6,
+         fleetLatencyPercentile(latency, 0.999) / 1e6, fleetLatencyMax(latency) / 1e6,
+         (unsigned long)fleetLatencyCount(latency));
+}
+
+static void printProgress(double elapsed_s) {
+  uint64_t messages = counters.frames + counters.nfc_messages;
+  printf("%6.1f s  %lu frames, %lu nfc msgs (%.0f msg/s, %.1f kB/s), %lu tx, %lu acked, %lu resent,"
+         " %lu failed, %lu late ticks\n",
+         elapsed_s, (unsigned long)counters.frames.load(), (unsigned long)counters.nfc_messages.load(),
+         messages / elapsed_s, counters.bytes / elapsed_s / 1000.0, (unsigned long)counters.transactions.load(),
+         (unsigned long)counters.acks.load(), (unsigned long)counters.resends.load(),
+         (unsigned long)counters.publish_failures.load(), (unsigned long)counters.late_ticks.load());
+  fflush(stdout);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-h host] [-p port] [-s site] [-n pallets] [-t threads] [-d seconds]\n"
+          "          [-i sample_ms] [-b heartbeat_s] [-x tx_per_hour]\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  options.host = "localhost";
+  options.port = 1883;
+  options.site = "main";
+  options.pallets = 100;
+  options.threads = 4;
+  options.seconds = 30;
+  options.sample_ms = 800;
+  options.heartbeat_s = 300;
+  options.tx_per_hour = 6;
+  int opt;
+  while ((opt = getopt(argc, argv, "h:p:s:n:t:d:i:b:x:")) != -1) {
+    switch (opt) {
+      case 'h': options.host = optarg; break;
+      case 'p': options.port = atoi(optarg); break;
+      case 's': options.site = optarg; break;
+      case 'n': options.pallets = atoi(optarg); break;
+      case 't': options.threads = atoi(optarg); break;
+      case 'd': options.seconds = atof(optarg); break;
+      case 'i': options.sample_ms = (uint32_t)atol(optarg); break;
+      case 'b': options.heartbeat_s = (uint32_t)atol(optarg); break;
+      case 'x': options.tx_per_hour = atof(optarg); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (options.pallets < 1 || options.pallets > 0xFFFFFF || options.threads < 1 ||
+      options.threads > options.pallets || options.sample_ms == 0 || options.seconds <= 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  mosquitto_lib_init();
+  topic_prefix = std::string("bottle-scale/") + options.site + "/";
+  frame_latency = fleetLatencyCreate();
+  ack_latency = fleetLatencyCreate();
+  start_ns = fleetNowNs();
+
+  for (int i = 0; i < options.pallets; i++) {
+    fleet.push_back(new Pallet());
+    initPallet(fleet[i], i);
+  }
+  std::vector<Generator*> generators;
+  for (int t = 0; t < options.threads; t++) {
+    generators.push_back(new Generator());
+    generators[t]->index = t;
+  }
+  for (int i = 0; i < options.pallets; i++) {
+    generators[i % options.threads]->pallets.push_back(fleet[i]);
+  }
+
+  struct mosquitto* probe = connectClient("probe", 0, NULL, onProbeConnect, onProbeFrame);
+  if (probe == NULL) {
+    return 1;
+  }
+  for (int t = 0; t < options.threads; t++) {
+    generators[t]->client = connectClient("gen", t, generators[t], onGeneratorConnect, onAck);
+    if (generators[t]->client == NULL) {
+      return 1;
+    }
+  }
+  printf("🚚 %d pallets on %d threads -> %s:%d, %s+/..., sample %lu ms, heartbeat %lu s, %.1f tx/h\n",
+         options.pallets, options.threads, options.host, options.port, topic_prefix.c_str(),
+         (unsigned long)options.sample_ms, (unsigned long)options.heartbeat_s, options.tx_per_hour);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < options.threads; t++) {
+    threads.push_back(std::thread(runGenerator, generators[t]));
+  }
+  uint64_t last_report = fleetNowNs();
+  while (running && (fleetNowNs() - start_ns) / 1e9 < options.seconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (fleetNowNs() - last_report >= LOADGEN_REPORT_INTERVAL * 1000000ULL) {
+      printProgress((fleetNowNs() - start_ns) / 1e9);
+      last_report = fleetNowNs();
+    }
+  }
+  running = false;
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+  }
+  // Give the last frames and acks time to arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  double elapsed = (fleetNowNs() - start_ns) / 1e9;
+  printProgress(elapsed);
+  printf("  frames received back: %lu of %lu; stray acks: %lu\n", (unsigned long)counters.frames_received.load(),
+         (unsigned long)counters.frames.load(), (unsigned long)counters.stray_acks.load());
+  printLatency("frame", frame_latency);
+  printLatency("ack", ack_latency);
+
+  for (int t = 0; t < options.threads; t++) {
+    mosquitto_disconnect(generators[t]->client);
+    mosquitto_loop_stop(generators[t]->client, false);
+    mosquitto_destroy(generators[t]->client);
+    delete generators[t];
+  }
+  mosquitto_disconnect(probe);
+  mosquitto_loop_stop(probe, false);
+  mosquitto_destroy(probe);
+  mosquitto_lib_cleanup();
+  for (size_t i = 0; i < fleet.size(); i++) {
+    delete fleet[i];
+  }
+  fleetLatencyDestroy(frame_latency);
+  fleetLatencyDestroy(ack_latency);
+  return counters.publish_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+/*
+ * series_bench - compression ratio and cost of the series codec on
+ * recorded data
+ *
+ *   series_bench ../prototype/analysis/latex_data_20250929_211553.csv ...
+ *
+ * Every weight column (weight_g, measured_weight) is quantised to 0.1 g
+ * and every raw column (raw_reading, hx711_raw) to whole HX711 counts.
+ * Each column is paired with the "timestamp" column and encoded into
+ * SERIES_BENCH_BLOCK_SIZE-byte blocks, the size of one MQTT batch.
+ * The results are compared with two baselines:
+ *   text - "<ms>,<value>\n" per sample, the decimal text the firmware
+ *          publishes today
+ *   raw  - 8 bytes per sample (uint32 ms + int32 value)
+ * Every block is decoded again and checked against the input. The exit
+ * status is 1 on any mismatch.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "sample_window.h"
+#include "series_codec.h"
+
+#define SERIES_BENCH_BLOCK_SIZE 256
+#define SERIES_BENCH_MIN_SECONDS 0.2   // Repeat the timing loops at least this long
+
+struct Column {
+  const char* name;
+  uint8_t unit;
+  double scale;                        // CSV value to fixed-point integer
+};
+
+static const Column bench_columns[] = {
+  { "weight_g", SAMPLE_UNIT_DECIGRAM, 10.0 },
+  { "measured_weight", SAMPLE_UNIT_DECIGRAM, 10.0 },
+  { "raw_reading", SAMPLE_UNIT_RAW, 1.0 },
+  { "hx711_raw", SAMPLE_UNIT_RAW, 1.0 },
+};
+
+static std::vector<std::string> splitCsv(const std::string& line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  for (;;) {
+    size_t comma = line.find(',', start);
+    fields.push_back(line.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+    if (comma == std::string::npos) break;
+    start = comma + 1;
+  }
+  return fields;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static long daysFromCivil(long y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = (unsigned)(y - era * 400);
+  unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (long)doe - 719468;
+}
+
+// "YYYY-MM-DD HH:MM:SS[.ffffff]" to Unix ms; false if malformed
+static bool parseTimestamp(const std::string& text, long long* ms) {
+  int year, month, day, hour, minute;
+  double second;
+  if (sscanf(text.c_str(), "%d-%d-%d %d:%d:%lf", &year, &month, &day, &hour, &minute, &second) != 6) {
+    return false;
+  }
+  long long seconds = daysFromCivil(year, (unsigned)month, (unsigned)day) * 86400LL +
+                      hour * 3600LL + minute * 60LL;
+  *ms = seconds * 1000LL + (long long)llround(second * 1000.0);
+  return true;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Encodes the whole series into blocks; returns the block lengths
+static std::vector<std::vector<uint8_t> > encodeSeries(const std::vector<uint32_t>& times,
+                                                       const std::vector<int32_t>& values,
+                                                       uint8_t unit) {
+  std::vector<std::vector<uint8_t> > blocks;
+  uint8_t buffer[SERIES_BENCH_BLOCK_SIZE];
+  SeriesEncoder encoder;
+  seriesEncoderBegin(&encoder, buffer, sizeof(buffer), 0, unit);
+  for (size_t i = 0; i < times.size(); i++) {
+    if (!seriesEncoderAdd(&encoder, times[i], values[i])) {
+      size_t length = seriesEncoderFinish(&encoder);
+      blocks.push_back(std::vector<uint8_t>(buffer, buffer + length));
+      seriesEncoderBegin(&encoder, buffer, sizeof(buffer), (uint32_t)blocks.size(), unit);
+      seriesEncoderAdd(&encoder, times[i], values[i]);
+    }
+  }
+  size_t length = seriesEncoderFinish(&encoder);
+  if (length > 0) {
+    blocks.push_back(std::vector<uint8_t>(buffer, buffer + length));
+  }
+  return blocks;
+}
+
+static bool benchColumn(const char* path, const Column& column, const std::vector<uint32_t>& times,
+                        const std::vector<int32_t>& values) {
+  size_t n = times.size();
+  size_t text_bytes = 0;
+  char text[32];
+  for (size_t i = 0; i < n; i++) {
+    text_bytes += (size_t)snprintf(text, sizeof(text), "%lu,%ld\n", (unsigned long)times[i], (long)values[i]);
+  }
+
+  std::vector<std::vector<uint8_t> > blocks = encodeSeries(times, values, column.unit);
+  size_t encoded_bytes = 0;
+  for (size_t b = 0; b < blocks.size(); b++) {
+    encoded_bytes += blocks[b].size();
+  }
+
+  // Round trip
+  std::vector<uint32_t> decoded_times(n);
+  std::vector<int32_t> decoded_values(n);
+  size_t position = 0;
+  for (size_t b = 0; b < blocks.size(); b++) {
+    SeriesBlockInfo info;
+    TelemetryDecodeResult result = seriesDecode(blocks[b].data(), blocks[b].size(), &info,
+                                                &decoded_times[position], &decoded_values[position],
+                                                n - position);
+    if (result != TELEMETRY_OK) {
+      fprintf(stderr, "%s %s: block %lu: %s\n", path, column.name, (unsigned long)b,
+              telemetryDecodeResultName(result));
+      return false;
+    }
+    position += info.count;
+  }
+  if (position != n || decoded_times != times || decoded_values != values) {
+    fprintf(stderr, "%s %s: round trip mismatch\n", path, column.name);
+    return false;
+  }
+
+  // Encode and decode cost per sample, repeated until the clock is reliable
+  long repeats = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  do {
+    encodeSeries(times, values, column.unit);
+    repeats++;
+  } while (secondsSince(start) < SERIES_BENCH_MIN_SECONDS);
+  double encode_ns = secondsSince(start) * 1e9 / (double)(repeats * (long)n);
+
+  repeats = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    size_t offset = 0;
+    for (size_t b = 0; b < blocks.size(); b++) {
+      SeriesBlockInfo info;
+      seriesDecode(blocks[b].data(), blocks[b].size(), &info, &decoded_times[offset],
+                   &decoded_values[offset], n - offset);
+      offset += info.count;
+    }
+    repeats++;
+  } while (secondsSince(start) < SERIES_BENCH_MIN_SECONDS);
+  double decode_ns = secondsSince(start) * 1e9 / (double)(repeats * (long)n);
+
+  const char* name = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+  printf("%-38s %-16s %6lu %6lu %8lu %8lu %8lu %7.2fx %7.2fx %6.2f %8.1f %8.1f\n", name, column.name,
+         (unsigned long)n, (unsigned long)blocks.size(), (unsigned long)text_bytes,
+         (unsigned long)(n * 8), (unsigned long)encoded_bytes, (double)text_bytes / encoded_bytes,
+         (double)(n * 8) / encoded_bytes, encoded_bytes * 8.0 / n, encode_ns, decode_ns);
+  return true;
+}
+
+static bool benchFile(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+
+  std::vector<std::vector<std::string> > rows;
+  char line[1024];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    std::string text(line);
+    while (!text.empty() && (text[text.size() - 1] == '\n' || text[text.size() - 1] == '\r')) {
+      text.erase(text.size() - 1);
+    }
+    if (!text.empty()) rows.push_back(splitCsv(text));
+  }
+  fclose(file);
+  if (rows.size() < 2) {
+    fprintf(stderr, "%s: no data rows\n", path);
+    return false;
+  }
+
+  const std::vector<std::string>& header = rows[0];
+  int time_index = -1;
+  for (size_t c = 0; c < header.size(); c++) {
+    if (header[c] == "timestamp") time_index = (int)c;
+  }
+  if (time_index < 0) {
+    fprintf(stderr, "%s: no timestamp column\n", path);
+    return false;
+  }
+
+  // millis()-style timestamps: ms since the first row
+  std::vector<uint32_t> times;
+  long long first_ms = 0;
+  for (size_t r = 1; r < rows.size(); r++) {
+    long long ms;
+    if ((int)rows[r].size() <= time_index || !parseTimestamp(rows[r][time_index], &ms)) {
+      fprintf(stderr, "%s: line %lu: bad timestamp\n", path, (unsigned long)(r + 1));
+      return false;
+    }
+    if (r == 1) first_ms = ms;
+    times.push_back((uint32_t)(ms - first_ms));
+  }
+
+  bool ok = true;
+  for (size_t k = 0; k < sizeof(bench_columns) / sizeof(bench_columns[0]); k++) {
+    for (size_t c = 0; c < header.size(); c++) {
+      if (header[c] != bench_columns[k].name) continue;
+      std::vector<int32_t> values;
+      for (size_t r = 1; r < rows.size(); r++) {
+        double value = c < rows[r].size() ? atof(rows[r][c].c_str()) : 0.0;
+        values.push_back((int32_t)llround(value * bench_columns[k].scale));
+      }
+      ok = benchColumn(path, bench_columns[k], times, values) && ok;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s file.csv...\n", argv[0]);
+    return 2;
+  }
+
+  printf("%-38s %-16s %6s %6s %8s %8s %8s %8s %8s %6s %8s %8s\n", "file", "column", "n", "blocks",
+         "text_B", "raw_B", "coded_B", "vs_text", "vs_raw", "bits", "enc_ns", "dec_ns");
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    ok = benchFile(argv[i]) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/*
+ * telemetry_decode - prints frame and samples payloads and series blocks
+ * as JSON lines
+ *
+ * Reads one message per line as hex, which is what
+ *   mosquitto_sub -h broker.hivemq.com -t 'bottle-scale/+/+/frame' -F %x
+ * prints. Snapshot frames come out with the same fields the legacy
+ * bottle-scale/data topic carried, sample windows with their statistics
+ * and the unpacked samples, series blocks (series_codec.h) as timestamp
+ * and value arrays. Lines that fail to decode are reported on stderr.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "report_policy.h"
+#include "sample_window.h"
+#include "series_codec.h"
+#include "telemetry_frame.h"
+
+#define MAX_FRAME_BYTES 1024
+#define MAX_SERIES_SAMPLES (1 + (MAX_FRAME_BYTES - SERIES_BLOCK_HEADER_SIZE) * 8 / 2)
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Hex line to bytes; whitespace between bytes is ignored
+static size_t parseHexLine(const char* line, uint8_t* out, size_t capacity) {
+  size_t length = 0;
+  int high = -1;
+  for (const char* p = line; *p != '\0' && length < capacity; p++) {
+    int value = hexValue(*p);
+    if (value < 0) continue;
+    if (high < 0) {
+      high = value;
+    } else {
+      out[length++] = (uint8_t)((high << 4) | value);
+      high = -1;
+    }
+  }
+  return length;
+}
+
+static TelemetryDecodeResult printSnapshot(const uint8_t* frame, size_t length) {
+  TelemetrySnapshot snapshot;
+  TelemetryDecodeResult result = telemetryDecodeSnapshot(frame, length, &snapshot);
+  if (result != TELEMETRY_OK) {
+    return result;
+  }
+
+  char vehicle_id[TELEMETRY_UID_MAX_LENGTH * 2 + 1];
+  telemetryFormatUID(snapshot.vehicle_uid, snapshot.vehicle_uid_length, vehicle_id);
+
+  printf("{\"weight_g\":%ld,\"weight_oz\":%.2f,\"bottles\":%d,\"status\":\"%s\","
+         "\"nfc_state\":\"%s\",\"vehicle_id\":\"%s\",\"open_transactions\":%u,"
+         "\"report_reason\":\"%s\",\"suppressed\":%lu,\"timestamp\":%lu,\"epoch_ms\":%llu,"
+         "\"boot\":%lu,\"sequence\":%lu,\"clock_age_s\":%u,\"drift_ppm\":%d}\n",
+         (long)snapshot.weight_g, snapshot.weight_g / 28.34952, (int)snapshot.bottles,
+         telemetryStatusName(snapshot.status), telemetryNFCStateName(snapshot.nfc_state),
+         vehicle_id, (unsigned int)snapshot.open_transactions,
+         reportReasonName((ReportReason)snapshot.report_reason),
+         (unsigned long)snapshot.suppressed, (unsigned long)snapshot.timestamp_ms,
+         (unsigned long long)snapshot.epoch_ms, (unsigned long)snapshot.boot_count,
+         (unsigned long)snapshot.sequence, (unsigned int)snapshot.clock_age_s,
+         (int)snapshot.drift_ppm);
+  return TELEMETRY_OK;
+}
+
+static TelemetryDecodeResult printSampleWindow(const uint8_t* frame, size_t length) {
+  SampleWindowStats stats;
+  int32_t samples[SAMPLE_WINDOW_MAX_SAMPLES];
+  TelemetryDecodeResult result = sampleWindowDecode(frame, length, &stats, samples,
+                                                    SAMPLE_WINDOW_MAX_SAMPLES);
+  if (result != TELEMETRY_OK) {
+    return result;
+  }
+
+  printf("{\"boot\":%lu,\"window\":%lu,\"start_ms\":%lu,\"start_epoch_ms\":%llu,\"span_ms\":%u,"
+         "\"count\":%u,\"unit\":\"%s\",\"min\":%ld,\"max\":%ld,\"mean\":%.2f,\"variance\":%.2f,"
+         "\"samples\":[",
+         (unsigned long)stats.boot_count, (unsigned long)stats.sequence, (unsigned long)stats.start_ms,
+         (unsigned long long)stats.start_epoch_ms,
+         (unsigned int)stats.span_ms, (unsigned int)stats.count, sampleUnitName(stats.unit),
+         (long)stats.min, (long)stats.max, stats.mean, stats.variance);
+  unsigned int printed = stats.count < SAMPLE_WINDOW_MAX_SAMPLES ? stats.count : SAMPLE_WINDOW_MAX_SAMPLES;
+  for (unsigned int i = 0; i < printed; i++) {
+    printf(i == 0 ? "%ld" : ",%ld", (long)samples[i]);
+  }
+  printf("]}\n");
+  return TELEMETRY_OK;
+}
+
+static TelemetryDecodeResult printSeriesBlock(const uint8_t* frame, size_t length) {
+  static uint32_t timestamps[MAX_SERIES_SAMPLES];
+  static int32_t values[MAX_SERIES_SAMPLES];
+  SeriesBlockInfo info;
+  TelemetryDecodeResult result = seriesDecode(frame, length, &info, timestamps, values,
+                                              MAX_SERIES_SAMPLES);
+  if (result != TELEMETRY_OK) {
+    return result;
+  }
+
+  printf("{\"block\":%lu,\"count\":%u,\"unit\":\"%s\",\"first_ms\":%lu,\"last_ms\":%lu,\"timestamps\":[",
+         (unsigned long)info.sequence, (unsigned int)info.count, sampleUnitName(info.unit),
+         (unsigned long)info.first_ms, (unsigned long)info.last_ms);
+  unsigned int printed = info.count < MAX_SERIES_SAMPLES ? info.count : MAX_SERIES_SAMPLES;
+  for (unsigned int i = 0; i < printed; i++) {
+    printf(i == 0 ? "%lu" : ",%lu", (unsigned long)timestamps[i]);
+  }
+  printf("],\"values\":[");
+  for (unsigned int i = 0; i < printed; i++) {
+    printf(i == 0 ? "%ld" : ",%ld", (long)values[i]);
+  }
+  printf("]}\n");
+  return TELEMETRY_OK;
+}
+
+int main() {
+  char line[MAX_FRAME_BYTES * 3 + 2];
+  uint8_t frame[MAX_FRAME_BYTES];
+  unsigned long line_number = 0;
+  unsigned long failures = 0;
+
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    line_number++;
+    size_t length = parseHexLine(line, frame, sizeof(frame));
+    if (length == 0) continue;
+
+    TelemetryDecodeResult result;
+    switch (frame[0]) {
+      case TELEMETRY_SCHEMA_SAMPLE_WINDOW: result = printSampleWindow(frame, length); break;
+      case TELEMETRY_SCHEMA_SERIES_BLOCK: result = printSeriesBlock(frame, length); break;
+      default: result = printSnapshot(frame, length); break;
+    }
+    if (result != TELEMETRY_OK) {
+      fprintf(stderr, "line %lu: %s (%u bytes, schema 0x%02X)\n", line_number,
+              telemetryDecodeResultName(result), (unsigned int)length, frame[0]);
+      failures++;
+      continue;
+    }
+    fflush(stdout);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/*
+ * trace_to_chrome - turns event trace dumps into Chrome trace JSON
+ *
+ * Reads the TR, lines of lib/EventTrace dumps from stdin, as printed on the
+ * serial console ('T') or published on <site>/<device>/trace, e.g.
+ *   mosquitto_sub -h broker.hivemq.com -t 'bottle-scale/main/+/trace' > pallet.trace
+ *   trace_to_chrome < pallet.trace > pallet.json
+ * and writes one JSON object for ui.perfetto.dev or chrome://tracing. Each
+ * dump becomes a process and each firmware task a thread; the core an event
+ * ran on is in its args. Timestamps are the device's micros(), unwrapped
+ * across its 32-bit rollover. Other lines are skipped.
+ *
+ * The ring drops its oldest events, so a dump can start inside a scope:
+ * end events without a begin on the same task are left out. Begin events
+ * still open at the end of a dump stay open and run to the end of the view.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 256
+#define MAX_IDS 256                        // Name and task ids are one byte on the device
+#define MAX_NAME 32
+#define MAX_DEPTH 16                       // Nested scopes per task
+
+struct Dump {
+  unsigned int number;
+  char names[MAX_IDS][MAX_NAME];
+  uint8_t open[MAX_IDS][MAX_DEPTH];        // Begin events not ended yet, per task
+  uint8_t depth[MAX_IDS];
+  bool thread_named[MAX_IDS];
+  bool have_time;
+  uint32_t last_us;
+  uint64_t epoch_us;                       // Added to the device time after each rollover
+  unsigned long events;
+  unsigned long unmatched;
+  bool ended;                              // Summary printed
+};
+
+static bool first_event = true;
+
+static void printJsonString(const char* text) {
+  putchar('"');
+  for (const char* p = text; *p != '\0'; p++) {
+    if (*p == '"' || *p == '\\') {
+      printf("\\%c", *p);
+    } else if ((unsigned char)*p < 0x20) {
+      printf("\\u%04x", (unsigned char)*p);
+    } else {
+      putchar(*p);
+    }
+  }
+  putchar('"');
+}
+
+static void beginEvent() {
+  printf(first_event ? "\n" : ",\n");
+  first_event = false;
+}
+
+static void printMetadata(const char* kind, unsigned int pid, unsigned int tid, const char* name) {
+  beginEvent();
+  printf("{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", kind, pid, tid);
+  printJsonString(name);
+  printf("}}");
+}
+
+// Copies the text after the nth comma of line, up to the next comma or the
+// end of the line
+static bool field(const char* line, int n, char* out, size_t size) {
+  const char* p = line;
+  for (int i = 0; i < n; i++) {
+    p = strchr(p, ',');
+    if (p == NULL) return false;
+    p++;
+  }
+  size_t length = strcspn(p, ",\r\n");
+  if (length == 0 || length >= size) return false;
+  memcpy(out, p, length);
+  out[length] = '\0';
+  return true;
+}
+
+static bool numberField(const char* line, int n, unsigned long* value) {
+  char text[24];
+  if (!field(line, n, text, sizeof(text))) return false;
+  char* end;
+  *value = strtoul(text, &end, 10);
+  return *end == '\0';
+}
+
+static void endDump(Dump* dump) {
+  if (dump->number == 0 || dump->ended) return;
+  dump->ended = true;
+  fprintf(stderr, "dump %u: %lu events", dump->number, dump->events);
+  if (dump->unmatched > 0) {
+    fprintf(stderr, ", %lu ends without a begin left out", dump->unmatched);
+  }
+  fprintf(stderr, "\n");
+}
+
+// An aborted dump has no end line; its summary comes with the next header
+static void startDump(Dump* dump, const char* line) {
+  endDump(dump);
+  unsigned int number = dump->number + 1;
+  memset(dump, 0, sizeof(Dump));
+  dump->number = number;
+
+  unsigned long capacity = 0, recorded = 0, overwritten = 0, missed = 0;
+  numberField(line, 2, &capacity);
+  numberField(line, 3, &recorded);
+  numberField(line, 4, &overwritten);
+  numberField(line, 5, &missed);
+  char title[96];
+  snprintf(title, sizeof(title), "pallet dump %u (%lu of %lu recorded, %lu overwritten)",
+           number, recorded < capacity ? recorded : capacity, recorded, overwritten);
+  printMetadata("process_name", number, 0, title);
+  if (missed > 0) {
+    fprintf(stderr, "dump %u: %lu events missed during earlier dumps\n", number, missed);
+  }
+}
+
+static void addEvent(Dump* dump, const char* line, unsigned long line_number) {
+  unsigned long time_us, name, task, core;
+  char phase[4];
+  if (!numberField(line, 2, &time_us) || !field(line, 3, phase, sizeof(phase)) ||
+      !numberField(line, 4, &name) || !numberField(line, 5, &task) ||
+      !numberField(line, 6, &core) || name >= MAX_IDS || task >= MAX_IDS) {
+    fprintf(stderr, "line %lu: malformed event\n", line_number);
+    return;
+  }
+
+  // The ring is in time order, so a step back of more than half the
+  // range is micros() wrapping
+  uint32_t now = (uint32_t)time_us;
+  if (dump->have_time && now < dump->last_us && dump->last_us - now > 0x80000000UL) {
+    dump->epoch_us += 0x100000000ULL;
+  }
+  dump->have_time = true;
+  dump->last_us = now;
+  unsigned long long ts = dump->epoch_us + now;
+
+  if (!dump->thread_named[task]) {
+    char thread[24];
+    snprintf(thread, sizeof(thread), "task %lu", task);
+    printMetadata("thread_name", dump->number, (unsigned int)task, thread);
+    dump->thread_named[task] = true;
+  }
+  const char* event_name = dump->names[name][0] != '\0' ? dump->names[name] : "?";
+
+  char ph = phase[0];
+  if (ph == 'E') {
+    uint8_t depth = dump->depth[task];
+    if (depth == 0 || dump->open[task][depth - 1] != name) {
+      dump->unmatched++;
+      return;
+    }
+    dump->depth[task]--;
+  } else if (ph == 'B') {
+    if (dump->depth[task] == MAX_DEPTH) {
+      dump->unmatched++;
+      return;
+    }
+    dump->open[task][dump->depth[task]++] = (uint8_t)name;
+  } else if (ph != 'i') {
+    fprintf(stderr, "line %lu: unknown phase %s\n", line_number, phase);
+    return;
+  }
+
+  beginEvent();
+  printf("{\"name\":");
+  printJsonString(event_name);
+  printf(",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%u,\"tid\":%lu", ph, ts, dump->number, task);
+  if (ph == 'i') {
+    printf(",\"s\":\"t\"");
+  }
+  if (ph != 'E') {
+    printf(",\"args\":{\"core\":%lu}", core);
+  }
+  printf("}");
+  dump->events++;
+}
+
+int main() {
+  static Dump dump;
+  char line[MAX_LINE];
+  unsigned long line_number = 0;
+
+  printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    line_number++;
+    // Serial output of other tasks can share the line
+    const char* record = strstr(line, "TR,");
+    if (record == NULL || record[3] == '\0' || record[4] != ',') {
+      if (record != NULL && record[3] == 'Z') {
+        endDump(&dump);
+      }
+      continue;
+    }
+
+    unsigned long id;
+    switch (record[3]) {
+      case 'H':
+        startDump(&dump, record);
+        break;
+      case 'N':
+        if (dump.number > 0 && numberField(record, 2, &id) && id < MAX_IDS &&
+            !field(record, 3, dump.names[id], MAX_NAME)) {
+          fprintf(stderr, "line %lu: malformed name\n", line_number);
+        }
+        break;
+      case 'T':
+        if (dump.number > 0 && numberField(record, 2, &id) && id < MAX_IDS) {
+          char task_name[MAX_NAME];
+          if (field(record, 3, task_name, sizeof(task_name))) {
+            printMetadata("thread_name", dump.number, (unsigned int)id, task_name);
+            dump.thread_named[id] = true;
+          }
+        }
+        break;
+      case 'E':
+        if (dump.number > 0) {
+          addEvent(&dump, record, line_number);
+        }
+        break;
+    }
+  }
+  printf("\n]}\n");
+  endDump(&dump);
+
+  if (dump.number == 0) {
+    fprintf(stderr, "no trace dump found\n");
+    return 1;
+  }
+  return 0;
+}